@@ -0,0 +1,453 @@
+/*
+**      PJL Library
+**      src/hash_map.h
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PJL_HASH_MAP_H
+#define PJL_HASH_MAP_H
+
+// local
+#include "hash_table.h"
+
+// standard
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace PJL {
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A %hash_map is a type-safe front-end for a #HT_ENGINE_CHAINED hash_table
+ * having an interface like `std::unordered_map`.
+ *
+ * @remarks Unlike using hash_table directly, the hash and equality functions
+ * are template parameters so calls to them are inlined; chains are walked
+ * comparing cached hash values first, so \a Equal is called only on a hash
+ * match; and values are constructed in place (rather than copied into an
+ * entry by the caller after insertion).  Growing doesn't need \a Hash at all
+ * since every entry caches its hash value.
+ *
+ * @remarks As with hash_table, elements never move, so pointers and
+ * references to them remain valid until erased.
+ *
+ * @tparam K The key type.
+ * @tparam V The mapped type.
+ * @tparam Hash The hash function type.
+ * @tparam Equal The key equality function type.
+ */
+template<typename K,typename V,typename Hash = std::hash<K>,
+         typename Equal = std::equal_to<K>>
+class hash_map {
+public:
+  typedef K                       key_type;
+  typedef V                       mapped_type;
+  typedef std::pair<K const,V>    value_type;
+  typedef std::size_t             size_type;
+  typedef Hash                    hasher;
+  typedef Equal                   key_equal;
+  typedef value_type&             reference;
+  typedef value_type const&       const_reference;
+
+  static_assert( alignof(value_type) <= alignof(std::max_align_t),
+                 "value_type is over-aligned" );
+
+  /**
+   * A forward iterator over a %hash_map.
+   *
+   * @tparam Const If `true`, it's a `const_iterator`.
+   */
+  template<bool Const>
+  class iterator_base {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::ptrdiff_t            difference_type;
+    typedef typename hash_map::value_type value_type;
+    typedef std::conditional_t<Const,value_type const,value_type>* pointer;
+    typedef std::conditional_t<Const,value_type const,value_type>& reference;
+
+    iterator_base() noexcept : it_{ }, entry_{ nullptr } { }
+
+    /**
+     * Converting constructor from a non-`const` iterator.
+     */
+    template<bool C = Const,typename = std::enable_if_t<C>>
+    iterator_base( iterator_base<false> const &i ) noexcept :
+      it_{ i.it_ }, entry_{ i.entry_ }
+    {
+    }
+
+    reference operator*() const noexcept {
+      return *value_of( entry_ );
+    }
+
+    pointer operator->() const noexcept {
+      return value_of( entry_ );
+    }
+
+    iterator_base& operator++() noexcept {
+      entry_ = ht_iterator_next( &it_ );
+      return *this;
+    }
+
+    iterator_base operator++(int) noexcept {
+      iterator_base const temp{ *this };
+      ++*this;
+      return temp;
+    }
+
+    friend bool operator==( iterator_base const &i,
+                            iterator_base const &j ) noexcept {
+      return i.entry_ == j.entry_;
+    }
+
+    friend bool operator!=( iterator_base const &i,
+                            iterator_base const &j ) noexcept {
+      return i.entry_ != j.entry_;
+    }
+
+  private:
+    /**
+     * Constructs an iterator positioned at the first element of \a table.
+     */
+    explicit iterator_base( hash_table_t *table ) noexcept {
+      ht_iterator_init( &it_, table );
+      entry_ = ht_iterator_next( &it_ );
+    }
+
+    /**
+     * Constructs an iterator positioned at \a entry.  Incrementing it is
+     * valid only if \a table isn't incremental, i.e., each bucket is only
+     * ever in one array, so the iterator can resume after \a entry.
+     */
+    iterator_base( hash_table_t *table, ht_entry_t *entry ) noexcept :
+      entry_{ entry }
+    {
+      ht_iterator_init( &it_, table );
+      it_.bucket_idx = ht_bucket_idx( entry->hash, table->n_buckets,
+                                      table->shift );
+      it_.next = entry->next;
+    }
+
+    ht_iterator_t it_;
+    ht_entry_t   *entry_;
+
+    template<bool> friend class iterator_base;
+    friend class hash_map;
+  };
+
+  typedef iterator_base<false>  iterator;
+  typedef iterator_base<true>   const_iterator;
+
+  /**
+   * Constructs a %hash_map.
+   *
+   * @param est_size The estimated number of elements.
+   * @param max_lf The maximum load factor.
+   * @param sizing The bucket sizing policy.  Power-of-2 sizing avoids an
+   * integer division per operation, but should only be used if \a Hash
+   * produces well-distributed high bits.
+   */
+  explicit hash_map( size_type est_size = 0, double max_lf = 1.0,
+                     ht_sizing_t sizing = HT_SIZING_PRIME ) {
+    ht_options_t opt{ };
+    opt.engine = HT_ENGINE_CHAINED;
+    opt.sizing = sizing;
+    ht_init_opt( &table_, max_lf, est_size, &cmp_fn, &hash_fn, &opt );
+  }
+
+  hash_map( hash_map const &that ) :
+    hash_map{ that.size(), that.table_.max_lf,
+              that.table_.shift != 0 ? HT_SIZING_POW2 : HT_SIZING_PRIME }
+  {
+    for ( auto const &value : that )
+      try_emplace( value.first, value.second );
+  }
+
+  hash_map( hash_map &&that ) noexcept : table_( that.table_ ) {
+    that.table_ = hash_table_t{ };
+  }
+
+  ~hash_map() noexcept {
+    destroy_all();
+    ht_cleanup( &table_, nullptr );
+  }
+
+  hash_map& operator=( hash_map const &that ) {
+    if ( &that != this )
+      *this = hash_map{ that };
+    return *this;
+  }
+
+  hash_map& operator=( hash_map &&that ) noexcept {
+    if ( &that != this ) {
+      destroy_all();
+      ht_cleanup( &table_, nullptr );
+      table_ = that.table_;
+      that.table_ = hash_table_t{ };
+    }
+    return *this;
+  }
+
+  ////////// iterators ////////////////////////////////////////////////////////
+
+  iterator begin() noexcept {
+    return iterator{ &table_ };
+  }
+
+  const_iterator begin() const noexcept {
+    return const_iterator{ const_cast<hash_table_t*>( &table_ ) };
+  }
+
+  const_iterator cbegin() const noexcept {
+    return begin();
+  }
+
+  iterator end() noexcept {
+    return iterator{ };
+  }
+
+  const_iterator end() const noexcept {
+    return const_iterator{ };
+  }
+
+  const_iterator cend() const noexcept {
+    return end();
+  }
+
+  ////////// capacity /////////////////////////////////////////////////////////
+
+  bool empty() const noexcept {
+    return ht_empty( &table_ );
+  }
+
+  size_type size() const noexcept {
+    return table_.size;
+  }
+
+  ////////// hash policy //////////////////////////////////////////////////////
+
+  void reserve( size_type n ) {
+    ht_reserve( &table_, n );
+  }
+
+  void shrink_to_fit() {
+    ht_shrink_to_fit( &table_ );
+  }
+
+  ////////// lookup ///////////////////////////////////////////////////////////
+
+  mapped_type& at( key_type const &key ) {
+    ht_entry_t *const entry = find_entry( key, hash( key ) );
+    if ( entry == nullptr )
+      throw std::out_of_range{ "hash_map::at(): key not found" };
+    return value_of( entry )->second;
+  }
+
+  mapped_type const& at( key_type const &key ) const {
+    return const_cast<hash_map*>( this )->at( key );
+  }
+
+  bool contains( key_type const &key ) const {
+    return find_entry( key, hash( key ) ) != nullptr;
+  }
+
+  size_type count( key_type const &key ) const {
+    return contains( key ) ? 1 : 0;
+  }
+
+  iterator find( key_type const &key ) {
+    ht_entry_t *const entry = find_entry( key, hash( key ) );
+    return entry == nullptr ? end() : iterator{ &table_, entry };
+  }
+
+  const_iterator find( key_type const &key ) const {
+    return const_cast<hash_map*>( this )->find( key );
+  }
+
+  mapped_type& operator[]( key_type const &key ) {
+    return try_emplace( key ).first->second;
+  }
+
+  mapped_type& operator[]( key_type &&key ) {
+    return try_emplace( std::move( key ) ).first->second;
+  }
+
+  ////////// modifiers ////////////////////////////////////////////////////////
+
+  /**
+   * Removes all elements.
+   */
+  void clear() noexcept {
+    destroy_all();
+    ht_clear( &table_, nullptr );
+  }
+
+  template<typename... Args>
+  std::pair<iterator,bool> emplace( Args&&... args ) {
+    // Not value_type: its key is const and so couldn't be moved from.
+    std::pair<K,V> value( std::forward<Args>( args )... );
+    return try_emplace( std::move( value.first ), std::move( value.second ) );
+  }
+
+  std::pair<iterator,bool> insert( value_type const &value ) {
+    return try_emplace( value.first, value.second );
+  }
+
+  std::pair<iterator,bool> insert( value_type &&value ) {
+    // The key is const, so it can only be copied.
+    return try_emplace( value.first, std::move( value.second ) );
+  }
+
+  template<typename M>
+  std::pair<iterator,bool> insert_or_assign( key_type const &key, M &&obj ) {
+    auto rv = try_emplace( key, std::forward<M>( obj ) );
+    if ( !rv.second )
+      rv.first->second = std::forward<M>( obj );
+    return rv;
+  }
+
+  /**
+   * If \a key isn't present, inserts a new element whose value is constructed
+   * in place from \a args; otherwise does nothing.
+   *
+   * @param key The key.
+   * @param args The arguments to forward to the mapped type's constructor.
+   * @return Returns a pair of an iterator positioned at either the new or the
+   * existing element and `true` only if inserted.
+   */
+  template<typename KK,typename... Args>
+  std::pair<iterator,bool> try_emplace( KK &&key, Args&&... args ) {
+    ht_hash_val_t const h = hash( key );
+    if ( ht_entry_t *const entry = find_entry( key, h ) )
+      return { iterator{ &table_, entry }, false };
+
+    ht_entry_t *const entry = ht_insert_new( &table_, h, sizeof(value_type) );
+    try {
+      new( HT_DINT( entry ) ) value_type(
+        std::piecewise_construct,
+        std::forward_as_tuple( std::forward<KK>( key ) ),
+        std::forward_as_tuple( std::forward<Args>( args )... )
+      );
+    }
+    catch ( ... ) {
+      ht_delete( &table_, entry );
+      throw;
+    }
+    return { iterator{ &table_, entry }, true };
+  }
+
+  /**
+   * Erases the element at \a pos.
+   *
+   * @param pos The position of the element to erase.
+   * @return Returns an iterator positioned at the element after the erased
+   * one.
+   */
+  iterator erase( const_iterator pos ) {
+    iterator next;
+    next.it_ = pos.it_;
+    next.entry_ = pos.entry_;
+    ++next;
+    destroy( pos.entry_ );
+    ht_delete( &table_, pos.entry_ );
+    return next;
+  }
+
+  size_type erase( key_type const &key ) {
+    ht_entry_t *const entry = find_entry( key, hash( key ) );
+    if ( entry == nullptr )
+      return 0;
+    destroy( entry );
+    ht_delete( &table_, entry );
+    return 1;
+  }
+
+  void swap( hash_map &that ) noexcept {
+    std::swap( table_, that.table_ );
+  }
+
+private:
+  hash_table_t table_;
+
+  /**
+   * Gets a pointer to the value in \a entry.
+   */
+  static value_type* value_of( ht_entry_t const *entry ) noexcept {
+    return std::launder(
+      static_cast<value_type*>( HT_DINT( const_cast<ht_entry_t*>( entry ) ) )
+    );
+  }
+
+  template<typename KK>
+  static ht_hash_val_t hash( KK const &key ) {
+    return static_cast<ht_hash_val_t>( Hash{}( key ) );
+  }
+
+  /**
+   * Finds the entry for \a key having hash value \a h.  Only entries whose
+   * cached hash equals \a h are compared.
+   */
+  template<typename KK>
+  ht_entry_t* find_entry( KK const &key, ht_hash_val_t h ) const {
+    for ( ht_entry_t *entry = ht_bucket( &table_, h )->next; entry != nullptr;
+          entry = entry->next ) {
+      if ( entry->hash == h && Equal{}( value_of( entry )->first, key ) )
+        return entry;
+    } // for
+    return nullptr;
+  }
+
+  static void destroy( ht_entry_t *entry ) noexcept {
+    value_of( entry )->~value_type();
+  }
+
+  void destroy_all() noexcept {
+    if constexpr ( !std::is_trivially_destructible_v<value_type> ) {
+      if ( table_.size == 0 )
+        return;
+      ht_iterator_t it;
+      ht_iterator_init( &it, &table_ );
+      while ( ht_entry_t *const entry = ht_iterator_next( &it ) )
+        destroy( entry );
+    }
+  }
+
+  // These are given to the underlying hash_table only so it's complete; the
+  // hash_map itself never causes them to be called.
+  static int cmp_fn( void const *i_data, void const *j_data ) {
+    return Equal{}( static_cast<value_type const*>( i_data )->first,
+                    static_cast<value_type const*>( j_data )->first ) ? 0 : 1;
+  }
+
+  static ht_hash_val_t hash_fn( void const *data ) {
+    return hash( static_cast<value_type const*>( data )->first );
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+} // namespace PJL
+#endif /* PJL_HASH_MAP_H */
+/* vim:set et sw=2 ts=2: */
@@ -23,177 +23,3298 @@
 
 // standard
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>                      /* for open(2) */
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>                   /* for mmap(2) */
+#include <sys/stat.h>                   /* for fstat(2) */
+#include <unistd.h>                     /* for close(2) */
 
-#define ARRAY_SIZE(ARRAY)         (sizeof((ARRAY)) / sizeof((ARRAY)[0]))
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__ */
+
+#ifdef HT_STATS
+#include <time.h>                       /* for clock_gettime(2) */
+#endif /* HT_STATS */
+
+#ifdef __GNUC__
+# define likely(EXPR)             __builtin_expect( !!(EXPR), 1 )
+# define prefetch(ADDR)           __builtin_prefetch( (ADDR) )
+# define unlikely(EXPR)           __builtin_expect( !!(EXPR), 0 )
+#else
+# define likely(EXPR)             (EXPR)
+# define prefetch(ADDR)           ((void)(ADDR))
+# define unlikely(EXPR)           (EXPR)
+#endif /* __GNUC__ */
+
+/**
+ * Expands to its arguments only if `HT_STATS` is defined; otherwise expands
+ * to nothing.
+ */
+#ifdef HT_STATS
+# define HT_STATS_ONLY(...)       __VA_ARGS__
+#else
+# define HT_STATS_ONLY(...)       /* nothing */
+#endif /* HT_STATS */
 
 ////////// local constants ////////////////////////////////////////////////////
 
-static unsigned const HT_PRIME[] = {
-       53,      97,     193,      389,      769,
-     1543,    3079,    6151,    12289,    24593,
-    49157,   98317,  196613,   393241,   786433,
-  1572869, 3145739, 6291469, 12582917, 25165843
+/**
+ * Minimum number of buckets for #HT_SIZING_PRIME.
+ */
+#define HT_PRIME_MIN              53u
+
+/**
+ * Base-2 logarithm of the minimum number of buckets for #HT_SIZING_POW2.
+ */
+#define HT_POW2_LOG2_MIN          6u
+
+/**
+ * Base-2 logarithm of the maximum number of buckets for #HT_SIZING_POW2.
+ */
+#define HT_POW2_LOG2_MAX          62u
+
+/**
+ * Number of control bytes probed at a time by the open engine.
+ */
+#define HT_GROUP_WIDTH            16u
+
+/**
+ * Maximum load factor of the open engine.
+ */
+#define HT_OPEN_MAX_LF            (7 / 8.0)
+
+/**
+ * Maximum load factor of the dense engine.  It's lower than that of the open
+ * engine since its indices are probed one at a time.
+ */
+#define HT_DENSE_MAX_LF           (2 / 3.0)
+
+/**
+ * Number of work items (chunks of records and partitions of buckets) per
+ * thread for ht_build() and ht_for_each_parallel() so that threads that
+ * finish early can take more.
+ */
+#define HT_BUILD_ITEMS_PER_THREAD 8u
+
+/**
+ * Minimum number of records (or entries) per thread for ht_build() (or
+ * ht_for_each_parallel()).
+ */
+#define HT_BUILD_N_PER_THREAD     4096u
+
+/**
+ * Magic number at the start of a file written by ht_save().
+ */
+#define HT_FILE_MAGIC             "PJLHTBL"
+
+/**
+ * Version of the format of a file written by ht_save().
+ */
+#define HT_FILE_VERSION           1u
+
+/**
+ * Slot index meaning "no slot."
+ */
+#define HT_SLOT_NONE              ((size_t)-1)
+
+/**
+ * Control byte for a slot that has never been used.
+ */
+#define HT_CTRL_EMPTY             ((uint8_t)0x80)
+
+/**
+ * Control byte for a slot whose entry was deleted.
+ */
+#define HT_CTRL_DELETED           ((uint8_t)0xFE)
+
+/**
+ * Number of keys ht_find_batch() and ht_insert_batch() hash and prefetch at a
+ * time.  It should be enough to cover memory latency, but not so many that
+ * prefetched lines are evicted before they're used.
+ */
+#define HT_BATCH_N                16u
+
+/**
+ * Maximum size of an entry (including its data) that is allocated from a
+ * pool; larger entries are individually allocated.
+ */
+#define HT_POOL_ENTRY_SIZE_MAX    1024u
+
+/**
+ * Number of old buckets migrated per ht_insert() while an incremental table is
+ * being resized.
+ */
+#define HT_MIGRATE_N              8u
+
+/**
+ * Number of entries in a pool's first slab.  Each subsequent slab for the
+ * same pool doubles in size up to #HT_SLAB_SIZE_MAX so small tables stay
+ * small and large tables need few slabs.
+ */
+#define HT_SLAB_N_MIN             16u
+
+/**
+ * Maximum size in bytes of a slab.
+ */
+#define HT_SLAB_SIZE_MAX          (1u << 20)
+
+/**
+ * Size in bytes of a filter block: one cache line.
+ */
+#define HT_FILTER_BLOCK_SIZE      64u
+
+/**
+ * Number of 4-bit counters per filter block.
+ */
+#define HT_FILTER_BLOCK_N         (HT_FILTER_BLOCK_SIZE * 2)
+
+/**
+ * Number of filter counters per entry.  With #HT_FILTER_K, this gives a
+ * false-positive rate of about 1%.
+ */
+#define HT_FILTER_PER_ENTRY       12u
+
+/**
+ * Number of filter counters each hash value increments.
+ */
+#define HT_FILTER_K               4u
+
+/**
+ * Maximum value of a filter counter.  A counter that reaches it is never
+ * decremented since how many hash values incremented it is no longer known.
+ */
+#define HT_FILTER_COUNTER_MAX     15u
+
+/**
+ * Size in bytes of a huge page.  Allocations by #ht_allocator_huge at least
+ * this large are mapped and aligned to it.
+ */
+#define HT_HUGE_PAGE_SIZE         ((size_t)2 << 20)
+
+////////// local types ////////////////////////////////////////////////////////
+
+typedef struct ht_build_job   ht_build_job_t;
+typedef struct ht_build_part  ht_build_part_t;
+typedef struct ht_file_header ht_file_header_t;
+typedef struct ht_visit_job   ht_visit_job_t;
+typedef struct ht_visit_thread ht_visit_thread_t;
+
+/**
+ * A phase of ht_build().
+ */
+enum ht_build_phase {
+  HT_BUILD_HASH,                        ///< Hash and count per partition.
+  HT_BUILD_SCATTER,                     ///< Group records by partition.
+  HT_BUILD_LINK                         ///< Link partitions into buckets.
+};
+typedef enum ht_build_phase ht_build_phase_t;
+
+/**
+ * A partition of buckets of ht_build() and the result of linking it.
+ */
+struct ht_build_part {
+  size_t        begin;                  ///< First index into \ref perm.
+  size_t        end;                    ///< One past last index into perm.
+  size_t        n_inserted;             ///< Number of records inserted.
+  size_t        n_large;                ///< Number of those not pooled.
+  ht_entry_t   *free_head;              ///< Unused slab entries, if any.
+  ht_entry_t   *free_tail;              ///< Last of \ref free_head list.
+};
+
+/**
+ * State shared by all threads of ht_build().
+ */
+struct ht_build_job {
+  hash_table_t     *table;              ///< Table being built.
+  char const       *records;            ///< Records.
+  size_t            record_size;        ///< Size of each record.
+  size_t            n;                  ///< Number of records.
+  size_t            entry_size;         ///< Size of each entry.
+  ht_slab_t        *slab;               ///< Slab for entries or NULL.
+  ht_hash_val_t    *hashes;             ///< Hash of each record.
+  size_t           *perm;               ///< Record indices by partition.
+  size_t           *offsets;            ///< [chunk][part] counts/offsets.
+  ht_build_part_t  *parts;              ///< Partitions.
+  unsigned          n_chunks;           ///< Number of chunks of records.
+  unsigned          n_parts;            ///< Number of partitions.
+  size_t            part_n_buckets;     ///< Number of buckets per partition.
+  ht_build_phase_t  phase;              ///< Current phase.
+  atomic_uint       next_item;          ///< Next chunk or partition.
+};
+
+/**
+ * The header of a file written by ht_save().  All offsets are from the start
+ * of the file.
+ */
+struct ht_file_header {
+  char      magic[8];                   ///< #HT_FILE_MAGIC.
+  uint32_t  version;                    ///< #HT_FILE_VERSION.
+  uint32_t  entry_size;                 ///< `sizeof(ht_entry_t)`.
+  uint32_t  shift;                      ///< Fibonacci shift.
+  uint32_t  unused;                     ///< Unused; 0.
+  uint64_t  size;                       ///< Number of entries.
+  uint64_t  n_buckets;                  ///< Number of buckets; power of 2.
+  uint64_t  buckets_off;                ///< Offset of bucket offsets.
+  uint64_t  entries_off;                ///< Offset of the first entry.
+  uint64_t  file_size;                  ///< Size of the file.
+};
+
+/**
+ * State shared by all threads of ht_for_each_parallel().
+ */
+struct ht_visit_job {
+  hash_table_t     *table;              ///< Table being visited.
+  ht_visit_fn_t     visit_fn;           ///< Function to call for each entry.
+  void             *arg;                ///< Argument for \ref visit_fn.
+  unsigned          n_parts;            ///< Number of parts of the table.
+  atomic_uint       next_part;          ///< Next part to visit.
+};
+
+/**
+ * A thread of ht_for_each_parallel().
+ */
+struct ht_visit_thread {
+  ht_visit_job_t   *job;                ///< The shared job.
+  unsigned          idx;                ///< Index of this thread.
+  pthread_t         thread;             ///< This thread.
+};
+
+/**
+ * A counting blocked Bloom filter of the hash values of a hash table's
+ * entries.  Each block is one cache line of #HT_FILTER_BLOCK_N 4-bit
+ * counters; a hash value selects one block and increments #HT_FILTER_K
+ * counters within it.
+ */
+struct ht_filter {
+  size_t        n_blocks;               ///< Number of blocks.
+  size_t        n;                      ///< Number of hash values added.
+  alignas(HT_FILTER_BLOCK_SIZE)
+  uint64_t      blocks[][ HT_FILTER_BLOCK_SIZE / sizeof(uint64_t) ];
+};
+
+/**
+ * A pool of entries that are all the same size.
+ */
+struct ht_pool {
+  size_t        entry_size;             ///< Size of every entry in the pool.
+  ht_entry_t   *free;                   ///< Free list linked via `next`.
+  char         *next;                   ///< Next never-used entry, if any.
+  char         *end;                    ///< End of the current slab.
+  size_t        slab_n;                 ///< Number of entries in next slab.
+  ht_slab_t    *spare;                  ///< Unused slabs kept by ht_clear().
+};
+
+/**
+ * A slab of memory from which a pool carves entries.
+ */
+struct ht_slab {
+  ht_slab_t    *next;                   ///< Next slab, if any.
+  size_t        entry_size;             ///< Size of entries carved from it.
+  size_t        size;                   ///< Size of \ref mem.
+  alignas(max_align_t) char mem[];      ///< Entries.
 };
 
 ////////// local functions ////////////////////////////////////////////////////
 
 /**
- * Grows a hash table.
+ * Counts the number of trailing zero bits of \a n.
+ *
+ * @param n The number to count the trailing zero bits of.  It must not be 0.
+ * @return Returns said number of bits.
+ */
+static inline unsigned ctz( unsigned n ) {
+  assert( n != 0 );
+#ifdef __GNUC__
+  return (unsigned)__builtin_ctz( n );
+#else
+  unsigned count = 0;
+  for ( ; (n & 1) == 0; n >>= 1 )
+    ++count;
+  return count;
+#endif /* __GNUC__ */
+}
+
+/**
+ * Counts the number of trailing zero bits of \a n.
+ *
+ * @param n The number to count the trailing zero bits of.  It must not be 0.
+ * @return Returns said number of bits.
+ */
+static inline unsigned ctz64( uint64_t n ) {
+  assert( n != 0 );
+#ifdef __GNUC__
+  return (unsigned)__builtin_ctzll( n );
+#else
+  unsigned count = 0;
+  for ( ; (n & 1) == 0; n >>= 1 )
+    ++count;
+  return count;
+#endif /* __GNUC__ */
+}
+
+/**
+ * Counts the number of 1 bits of \a n.
+ *
+ * @param n The number to count the 1 bits of.
+ * @return Returns said number of bits.
+ */
+static inline unsigned popcount64( uint64_t n ) {
+#ifdef __GNUC__
+  return (unsigned)__builtin_popcountll( n );
+#else
+  unsigned count = 0;
+  for ( ; n != 0; n &= n - 1 )
+    ++count;
+  return count;
+#endif /* __GNUC__ */
+}
+
+#ifdef HT_STATS
+/**
+ * Gets the counters of a hash table, even a `const` one.
+ *
+ * @param table The hash table.
+ * @return Returns said counters.
+ */
+static inline ht_counters_t* ht_counters( hash_table_t const *table ) {
+  return &((hash_table_t*)table)->counters;
+}
+
+/**
+ * Counts a lookup.
+ *
+ * @param table The hash table.
+ * @param is_insert If `true`, the lookup was by an insert.
+ * @param probes The number of probes.
+ */
+static void ht_count_lookup( hash_table_t const *table, bool is_insert,
+                             size_t probes ) {
+  ht_counters_t *const c = ht_counters( table );
+  ht_probe_stats_t *const ps = is_insert ? &c->inserts : &c->finds;
+  ++ps->n;
+  ps->probes += probes;
+  if ( probes > ps->probes_max )
+    ps->probes_max = probes;
+}
+
+/**
+ * Gets the current time.
+ *
+ * @return Returns said time in nanoseconds from an arbitrary start.
+ */
+static uint64_t ht_now_ns( void ) {
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Counts a grow of a hash table.
+ *
+ * @param table The hash table.
+ * @param start_ns When the grow started.
+ *
+ * @sa ht_now_ns()
+ */
+static void ht_count_grow( hash_table_t *table, uint64_t start_ns ) {
+  ++table->counters.n_grows;
+  table->counters.grow_ns += ht_now_ns() - start_ns;
+}
+
+/**
+ * Counts a lookup that didn't find an entry: if the table has a filter, it
+ * was a false positive.
+ *
+ * @param table The hash table.
+ */
+static void ht_count_filter_fp( hash_table_t const *table ) {
+  if ( table->filter != NULL )
+    ++ht_counters( table )->n_filter_fps;
+}
+#endif /* HT_STATS */
+
+/**
+ * Checks whether \a entry has data equal to \a data.
+ *
+ * @param table The hash table \a entry belongs to.
+ * @param cmp_fn The comparison function to use: either the table's \ref
+ * hash_table::cmp_fn "cmp_fn" or one given to ht_find_key().
+ * @param entry The entry to check.
+ * @param hash The hash of \a data.
+ * @param data The data to check.
+ * @return Returns `true` only if equal.
+ */
+static inline bool ht_entry_eq( hash_table_t const *table, ht_cmp_fn_t cmp_fn,
+                                ht_entry_t const *entry, ht_hash_val_t hash,
+                                void const *data ) {
+  (void)table;
+  if ( entry->hash != hash )
+    return false;
+#ifdef HT_STATS
+  ht_counters_t *const c = ht_counters( table );
+  ++c->n_cmps;
+  if ( (*cmp_fn)( data, entry->data ) != 0 ) {
+    ++c->n_cmp_fails;
+    return false;
+  }
+  return true;
+#else
+  return (*cmp_fn)( data, entry->data ) == 0;
+#endif /* HT_STATS */
+}
+
+/**
+ * Allocates memory for the buckets (or slots) or entries of a hash table using
+ * its \ref hash_table::allocator "allocator", if any.
+ *
+ * @param table The hash table.
+ * @param size The number of bytes to allocate.
+ * @param zero If `true`, zero the memory.
+ * @return Returns a pointer to the memory.
+ *
+ * @sa ht_free()
+ */
+static void* ht_alloc( hash_table_t const *table, size_t size, bool zero ) {
+  ht_allocator_t const *const allocator = table->allocator;
+  if ( allocator != NULL )
+    return (*allocator->alloc_fn)( size, zero, allocator->ctx );
+  return zero ? calloc( 1, size ) : malloc( size );
+}
+
+/**
+ * Frees memory allocated by ht_alloc().
+ *
+ * @param table The hash table.
+ * @param p A pointer to the memory or NULL.
+ * @param size The number of bytes \a p was allocated with.
+ *
+ * @sa ht_alloc()
+ */
+static void ht_free( hash_table_t const *table, void *p, size_t size ) {
+  ht_allocator_t const *const allocator = table->allocator;
+  if ( allocator == NULL )
+    free( p );
+  else if ( p != NULL )
+    (*allocator->free_fn)( p, size, allocator->ctx );
+}
+
+/**
+ * Gets the size of an entry including its data, rounded up so that
+ * consecutive entries in a slab are all properly aligned.
+ *
+ * @param data_size The size of the entry's data.
+ * @return Returns said size.
+ */
+static inline size_t ht_entry_size( size_t data_size ) {
+  return (sizeof(ht_entry_t) + data_size + alignof(ht_entry_t) - 1)
+         & ~(alignof(ht_entry_t) - 1);
+}
+
+/**
+ * Gets the entry at an offset within a #HT_ENGINE_MAPPED table's file.
+ * Offsets come from the file so, rather than trust them, this checks that the
+ * whole entry lies within the entries part of the mapping.
+ *
+ * @param table The hash table.
+ * @param off The offset of the entry.
+ * @return Returns a pointer to the entry or NULL if \a off is 0 or invalid.
+ */
+static ht_entry_t* ht_map_entry( hash_table_t const *table, uint64_t off ) {
+  if ( off < table->map_entries || off % alignof(ht_entry_t) != 0 ||
+       off > table->map_size - sizeof(ht_entry_t) ) {
+    return NULL;
+  }
+  ht_entry_t *const entry = (ht_entry_t*)(table->map + off);
+  if ( entry->data_size > table->map_size - off - sizeof(ht_entry_t) )
+    return NULL;
+  return entry;
+}
+
+/**
+ * Gets the pool for entries of a given size, creating it if necessary.
+ *
+ * @param table The hash table.
+ * @param entry_size The size of the entries.
+ * @return Returns said pool.
+ */
+static ht_pool_t* ht_pool_get( hash_table_t *table, size_t entry_size ) {
+  for ( unsigned i = 0; i < table->n_pools; ++i ) {
+    if ( likely( table->pools[i].entry_size == entry_size ) )
+      return &table->pools[i];
+  } // for
+
+  table->pools =
+    realloc( table->pools, (table->n_pools + 1) * sizeof(ht_pool_t) );
+  ht_pool_t *const pool = &table->pools[ table->n_pools++ ];
+  *pool = (ht_pool_t){
+    .entry_size = entry_size,
+    // A small table's first slab need hold no more than it can.
+    .slab_n = table->engine == HT_ENGINE_SMALL ? HT_SMALL_N : HT_SLAB_N_MIN
+  };
+  return pool;
+}
+
+/**
+ * Adds a slab to a pool: one of its spare slabs, if any; otherwise a new one.
+ *
+ * @param table The hash table.
+ * @param pool The pool to add a slab to.
+ */
+static void ht_pool_grow( hash_table_t *table, ht_pool_t *pool ) {
+  ht_slab_t *slab = pool->spare;
+  if ( slab != NULL ) {
+    pool->spare = slab->next;
+  }
+  else {
+    size_t const slab_size = pool->slab_n * pool->entry_size;
+    slab = ht_alloc( table, sizeof(ht_slab_t) + slab_size, false );
+    slab->entry_size = pool->entry_size;
+    slab->size = slab_size;
+    if ( pool->slab_n * 2 * pool->entry_size <= HT_SLAB_SIZE_MAX )
+      pool->slab_n *= 2;
+  }
+  slab->next = table->slabs;
+  table->slabs = slab;
+
+  pool->next = slab->mem;
+  pool->end = slab->mem + slab->size;
+}
+
+/**
+ * Frees a list of slabs.
+ *
+ * @param table The hash table the slabs belong to.
+ * @param slab The first slab of the list, if any.
+ */
+static void ht_slab_list_free( hash_table_t const *table, ht_slab_t *slab ) {
+  for ( ht_slab_t *next; slab != NULL; slab = next ) {
+    next = slab->next;
+    ht_free( table, slab, sizeof(ht_slab_t) + slab->size );
+  } // for
+}
+
+/**
+ * Creates a new entry.
+ *
+ * @param table The hash table the entry will belong to.
+ * @param hash The hash of the entry's data.
+ * @param data_size The size of the entry's data.
+ * @return Returns a pointer to a new entry.
+ *
+ * @sa ht_entry_free()
+ */
+static ht_entry_t* ht_entry_new( hash_table_t *table, ht_hash_val_t hash,
+                                 size_t data_size ) {
+  assert( data_size <= UINT32_MAX );
+  size_t const entry_size = ht_entry_size( data_size );
+  ht_entry_t *entry;
+
+  if ( unlikely( entry_size > HT_POOL_ENTRY_SIZE_MAX ) ) {
+    entry = ht_alloc( table, entry_size, false );
+    ++table->n_large;
+  }
+  else {
+    ht_pool_t *const pool = ht_pool_get( table, entry_size );
+    if ( pool->free != NULL ) {
+      entry = pool->free;
+      pool->free = entry->next;
+    }
+    else {
+      if ( unlikely( pool->next == pool->end ) )
+        ht_pool_grow( table, pool );
+      entry = (ht_entry_t*)pool->next;
+      pool->next += entry_size;
+    }
+  }
+
+  *entry = (ht_entry_t){ .hash = hash, .data_size = (uint32_t)data_size };
+  return entry;
+}
+
+/**
+ * Frees an entry by returning it to its pool.
+ *
+ * @param table The hash table the entry belongs to.
+ * @param entry The entry to free.
+ *
+ * @sa ht_entry_new()
+ */
+static void ht_entry_free( hash_table_t *table, ht_entry_t *entry ) {
+  size_t const entry_size = ht_entry_size( entry->data_size );
+
+  if ( unlikely( entry_size > HT_POOL_ENTRY_SIZE_MAX ) ) {
+    ht_free( table, entry, entry_size );
+    --table->n_large;
+  }
+  else {
+    ht_pool_t *const pool = ht_pool_get( table, entry_size );
+    entry->next = pool->free;
+    pool->free = entry;
+  }
+}
+
+/**
+ * Frees all slabs (hence all pooled entries) and pools of a hash table.
+ *
+ * @param table The hash table.
+ */
+static void ht_slabs_free( hash_table_t *table ) {
+  ht_slab_list_free( table, table->slabs );
+  for ( unsigned i = 0; i < table->n_pools; ++i )
+    ht_slab_list_free( table, table->pools[i].spare );
+  free( table->pools );
+}
+
+/**
+ * Makes all slabs of a hash table spare so their memory is reused for new
+ * entries.  The table must have no pooled entries.
+ *
+ * @param table The hash table.
+ */
+static void ht_slabs_reuse( hash_table_t *table ) {
+  for ( unsigned i = 0; i < table->n_pools; ++i ) {
+    ht_pool_t *const pool = &table->pools[i];
+    pool->free = NULL;
+    pool->next = pool->end = NULL;
+  } // for
+  for ( ht_slab_t *slab = table->slabs, *next; slab != NULL; slab = next ) {
+    next = slab->next;
+    ht_pool_t *const pool = ht_pool_get( table, slab->entry_size );
+    slab->next = pool->spare;
+    pool->spare = slab;
+  } // for
+  table->slabs = NULL;
+}
+
+/**
+ * Checks whether \a n is prime.
+ *
+ * @param n The number to check.  It must be odd and at least 3.
+ * @return Returns `true` only if \a n is prime.
+ */
+static bool is_prime( size_t n ) {
+  assert( n >= 3 && (n & 1) == 1 );
+  if ( n % 3 == 0 )
+    return n == 3;
+  // Every prime > 3 is of the form 6k +/- 1.
+  for ( size_t d = 5; d <= n / d; d += 6 ) {
+    if ( n % d == 0 || n % (d + 2) == 0 )
+      return false;
+  } // for
+  return true;
+}
+
+/**
+ * Gets the smallest prime that is at least \a n.
+ *
+ * @remarks Trial division is slow in general, but this is called only when a
+ * table is initialized or grows, and then costs only O(sqrt(\a n)) per
+ * candidate, which is negligible compared to rehashing \a n entries.
+ *
+ * @param n The number to get the next prime of.
+ * @return Returns said prime.
+ */
+static size_t next_prime( size_t n ) {
+  if ( n <= 3 )
+    return n <= 2 ? 2 : 3;
+  n |= 1;
+  while ( !is_prime( n ) )
+    n += 2;
+  return n;
+}
+
+/**
+ * Allocates the \ref hash_table::occupied "occupied" bits for buckets.
+ *
+ * @param n_buckets The number of buckets.
+ * @return Returns said bits, all clear.
+ */
+static inline uint64_t* ht_occupied_new( size_t n_buckets ) {
+  return calloc( (n_buckets + 63) / 64, sizeof(uint64_t) );
+}
+
+/**
+ * Gets the first occupied bucket of a #HT_ENGINE_CHAINED hash table in [\a b,
+ * \a end), skipping 64 empty buckets at a time.
+ *
+ * @param table The hash table.
+ * @param b The first bucket to check; must be less than \a end.
+ * @param end One past the last bucket to check; must be at most \ref
+ * hash_table::n_buckets "n_buckets".
+ * @return Returns said bucket or \a end if none.
+ */
+static size_t ht_occupied_next( hash_table_t const *table, size_t b,
+                                size_t end ) {
+  assert( b < end );
+  assert( end <= table->n_buckets );
+  size_t w = b / 64;
+  uint64_t word = table->occupied[w] & (~(uint64_t)0 << (b % 64));
+  while ( word == 0 ) {
+    if ( ++w * 64 >= end )
+      return end;
+    word = table->occupied[w];
+  } // while
+  b = w * 64 + ctz64( word );
+  return b < end ? b : end;
+}
+
+/**
+ * Marks a bucket of a #HT_ENGINE_CHAINED hash table as occupied.
+ *
+ * @param table The hash table.
+ * @param b The bucket.
+ */
+static inline void ht_occupied_set( hash_table_t *table, size_t b ) {
+  table->occupied[ b / 64 ] |= (uint64_t)1 << (b % 64);
+}
+
+/**
+ * Updates the occupied bit of a bucket of a #HT_ENGINE_CHAINED hash table
+ * after an entry was linked after or unlinked from \a head.
+ *
+ * @param table The hash table.
+ * @param head Either the head of one of the table's buckets or an entry.
+ * Since only the table's current buckets have occupied bits, nothing is done
+ * if it's an entry or the head of an old bucket.
+ */
+static inline void ht_occupied_update( hash_table_t *table,
+                                       ht_entry_t const *head ) {
+  size_t const b = ((uintptr_t)head - (uintptr_t)table->buckets) /
+                   sizeof(ht_entry_t);
+  if ( b >= table->n_buckets )
+    return;
+  if ( head->next != NULL )
+    ht_occupied_set( table, b );
+  else
+    table->occupied[ b / 64 ] &= ~((uint64_t)1 << (b % 64));
+}
+
+/**
+ * Migrates up to \a n buckets from a table's old buckets to its new buckets.
+ * When all have been migrated, the old buckets are freed.
+ *
+ * @param table The hash table.
+ * @param n The maximum number of buckets to migrate.
+ */
+static void ht_migrate( hash_table_t *table, size_t n ) {
+  assert( table != NULL );
+  assert( table->old_buckets != NULL );
+
+  size_t const end = table->old_n_buckets - table->migrate_idx > n ?
+    table->migrate_idx + n : table->old_n_buckets;
+
+  for ( size_t b = table->migrate_idx; b < end; ++b ) {
+    for ( ht_entry_t *entry = table->old_buckets[b].next, *next;
+          entry != NULL; entry = next ) {
+      size_t const new_b =
+        ht_bucket_idx( entry->hash, table->n_buckets, table->shift );
+      ht_entry_t *const new_head = &table->buckets[ new_b ];
+      ht_occupied_set( table, new_b );
+
+      next = entry->next;
+      entry->next = new_head->next;
+      entry->prev = new_head;
+
+      if ( new_head->next != NULL )
+        new_head->next->prev = entry;
+      new_head->next = entry;
+    } // for
+  } // for
+
+  table->migrate_idx = end;
+  if ( end == table->old_n_buckets ) {
+    ht_free(
+      table, table->old_buckets, table->old_n_buckets * sizeof(ht_entry_t)
+    );
+    table->old_buckets = NULL;
+  }
+}
+
+/**
+ * Gets the number of buckets a #HT_ENGINE_CHAINED table should have.
+ *
+ * @param sizing The bucket sizing.
+ * @param n The minimum number of buckets.
+ * @param shift Set to the Fibonacci shift for #HT_SIZING_POW2 or 0.
+ * @return Returns said number of buckets.
+ */
+static size_t ht_n_buckets( ht_sizing_t sizing, size_t n, unsigned *shift ) {
+  switch ( sizing ) {
+    case HT_SIZING_POW2: {
+      unsigned log2 = HT_POW2_LOG2_MIN;
+      while ( log2 < HT_POW2_LOG2_MAX && ((size_t)1 << log2) < n )
+        ++log2;
+      *shift = 64 - log2;
+      return (size_t)1 << log2;
+    }
+    case HT_SIZING_PRIME:
+    default:
+      *shift = 0;
+      return next_prime( n < HT_PRIME_MIN ? HT_PRIME_MIN : n );
+  } // switch
+}
+
+/**
+ * Resizes the buckets of a #HT_ENGINE_CHAINED hash table.  If \a incremental,
+ * only the new buckets are allocated; entries are migrated a few buckets at a
+ * time by subsequent calls to ht_insert() and ht_delete().
+ *
+ * @param table The hash table to resize.
+ * @param n The minimum number of buckets.
+ * @param incremental If `true`, resize incrementally.
+ */
+static void ht_resize( hash_table_t *table, size_t n, bool incremental ) {
+  assert( table != NULL );
+
+  unsigned shift;
+  size_t const n_buckets = ht_n_buckets(
+    table->shift != 0 ? HT_SIZING_POW2 : HT_SIZING_PRIME, n, &shift
+  );
+
+  if ( table->old_buckets != NULL )     // previous resize still in progress
+    ht_migrate( table, table->old_n_buckets );
+  if ( n_buckets == table->n_buckets )
+    return;
+
+  table->old_buckets = table->buckets;
+  table->old_n_buckets = table->n_buckets;
+  table->old_shift = table->shift;
+  table->migrate_idx = 0;
+
+  table->n_buckets = n_buckets;
+  table->shift = shift;
+  table->buckets =
+    ht_alloc( table, table->n_buckets * sizeof(ht_entry_t), true );
+  // Old buckets have no occupied bits: they're iterated over one by one.
+  free( table->occupied );
+  table->occupied = ht_occupied_new( table->n_buckets );
+
+  if ( !incremental )
+    ht_migrate( table, table->old_n_buckets );
+}
+
+/**
+ * Grows a hash table to about twice its number of buckets.
+ *
+ * @param table The hash table to grow.
+ */
+static void ht_grow( hash_table_t *table ) {
+  HT_STATS_ONLY( uint64_t const start_ns = ht_now_ns(); )
+  ht_resize( table, table->n_buckets * 2, table->incremental );
+  HT_STATS_ONLY( ht_count_grow( table, start_ns ); )
+}
+
+/**
+ * Gets the number of buckets (or slots) needed to hold \a n entries at a load
+ * factor of at most \a lf.
+ *
+ * @param n The number of entries.
+ * @param lf The load factor.
+ * @return Returns said number.
+ */
+static inline size_t ht_n_needed( size_t n, double lf ) {
+  return (size_t)(n / lf) + 1;
+}
+
+////////// filter ///////////////////////////////////////////////////////////
+
+/**
+ * Mixes a hash value so that the filter block it selects doesn't correlate
+ * with its bucket even when a table's \ref hash_table::hash_fn "hash_fn" is
+ * weak.
+ *
+ * @param hash The hash value to mix.
+ * @return Returns the mixed hash value: its high 32 bits select a block and
+ * its low bits select counters.
+ */
+static inline uint64_t ht_filter_mix( ht_hash_val_t hash ) {
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDull;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53ull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+/**
+ * Gets the filter block for a mixed hash value.
+ *
+ * @param filter The filter.
+ * @param mix The mixed hash value.
+ * @return Returns said block.
+ */
+static inline uint64_t* ht_filter_block( ht_filter_t const *filter,
+                                         uint64_t mix ) {
+  return (uint64_t*)filter->blocks[ ((mix >> 32) * filter->n_blocks) >> 32 ];
+}
+
+/**
+ * Gets the number of hash values a filter holds before it's rebuilt.
+ *
+ * @param filter The filter.
+ * @return Returns said number.
+ */
+static inline size_t ht_filter_capacity( ht_filter_t const *filter ) {
+  return filter->n_blocks * HT_FILTER_BLOCK_N / HT_FILTER_PER_ENTRY;
+}
+
+/**
+ * Adds a hash value to a filter.
+ *
+ * @param filter The filter.
+ * @param hash The hash value to add.
+ *
+ * @sa ht_filter_remove()
+ */
+static void ht_filter_inc( ht_filter_t *filter, ht_hash_val_t hash ) {
+  uint64_t const mix = ht_filter_mix( hash );
+  uint64_t *const block = ht_filter_block( filter, mix );
+  for ( unsigned i = 0; i < HT_FILTER_K; ++i ) {
+    unsigned const c = (mix >> (7 * i)) & (HT_FILTER_BLOCK_N - 1);
+    unsigned const shift = (c & 15) * 4;
+    if ( ((block[ c >> 4 ] >> shift) & 15) < HT_FILTER_COUNTER_MAX )
+      block[ c >> 4 ] += (uint64_t)1 << shift;
+  } // for
+  ++filter->n;
+}
+
+/**
+ * Creates a new, empty filter.
+ *
+ * @param n The number of hash values it should hold before being rebuilt.
+ * @return Returns said filter.
+ *
+ * @sa ht_filter_rebuild()
+ */
+static ht_filter_t* ht_filter_new( size_t n ) {
+  size_t n_blocks =
+    (n * HT_FILTER_PER_ENTRY + HT_FILTER_BLOCK_N - 1) / HT_FILTER_BLOCK_N;
+  if ( n_blocks == 0 )
+    n_blocks = 1;
+  assert( n_blocks <= UINT32_MAX );
+  size_t const size = sizeof(ht_filter_t) + n_blocks * HT_FILTER_BLOCK_SIZE;
+  ht_filter_t *const filter = aligned_alloc( HT_FILTER_BLOCK_SIZE, size );
+  memset( filter, 0, size );
+  filter->n_blocks = n_blocks;
+  return filter;
+}
+
+/**
+ * Replaces a hash table's filter with a new one for the hash values of all
+ * its entries.
+ *
+ * @param table The hash table.
+ * @param n The number of hash values the new filter should hold before being
+ * rebuilt; if less than the table's size, the size is used.
+ */
+static void ht_filter_rebuild( hash_table_t *table, size_t n ) {
+  free( table->filter );
+  table->filter = ht_filter_new( n > table->size ? n : table->size );
+  ht_iterator_t it;
+  ht_iterator_init( &it, table );
+  for ( ht_entry_t const *entry; (entry = ht_iterator_next( &it )) != NULL; )
+    ht_filter_inc( table->filter, entry->hash );
+}
+
+/**
+ * Adds a hash value to a hash table's filter, first rebuilding it twice as
+ * large if it's full.  The table must have a filter.
+ *
+ * @param table The hash table.
+ * @param hash The hash value to add.
+ */
+static void ht_filter_add( hash_table_t *table, ht_hash_val_t hash ) {
+  if ( unlikely( table->filter->n >= ht_filter_capacity( table->filter ) ) )
+    ht_filter_rebuild( table, 2 * (table->filter->n + 1) );
+  ht_filter_inc( table->filter, hash );
+}
+
+/**
+ * Removes a hash value from a filter.
+ *
+ * @param filter The filter.
+ * @param hash The hash value to remove.  It must have been added.
+ *
+ * @sa ht_filter_inc()
+ */
+static void ht_filter_remove( ht_filter_t *filter, ht_hash_val_t hash ) {
+  uint64_t const mix = ht_filter_mix( hash );
+  uint64_t *const block = ht_filter_block( filter, mix );
+  for ( unsigned i = 0; i < HT_FILTER_K; ++i ) {
+    unsigned const c = (mix >> (7 * i)) & (HT_FILTER_BLOCK_N - 1);
+    unsigned const shift = (c & 15) * 4;
+    unsigned const count = (block[ c >> 4 ] >> shift) & 15;
+    assert( count > 0 );
+    if ( count < HT_FILTER_COUNTER_MAX )
+      block[ c >> 4 ] -= (uint64_t)1 << shift;
+  } // for
+  --filter->n;
+}
+
+/**
+ * Tests whether a hash value may have been added to a hash table's filter.
+ *
+ * @param table The hash table.
+ * @param hash The hash value to test.
+ * @return Returns `false` only if \a hash definitely wasn't added; returns
+ * `true` if it may have been or the table has no filter.
+ */
+static inline bool ht_filter_test( hash_table_t const *table,
+                                   ht_hash_val_t hash ) {
+  if ( table->filter == NULL )
+    return true;
+  uint64_t const mix = ht_filter_mix( hash );
+  uint64_t const *const block = ht_filter_block( table->filter, mix );
+  for ( unsigned i = 0; i < HT_FILTER_K; ++i ) {
+    unsigned const c = (mix >> (7 * i)) & (HT_FILTER_BLOCK_N - 1);
+    if ( ((block[ c >> 4 ] >> ((c & 15) * 4)) & 15) == 0 ) {
+      HT_STATS_ONLY( ++ht_counters( table )->n_filter_negs; )
+      return false;
+    }
+  } // for
+  return true;
+}
+
+////////// small engine ///////////////////////////////////////////////////////
+
+/**
+ * Gets the bits of a hash value a #HT_ENGINE_SMALL table keeps per entry.
+ *
+ * @param hash The hash value.
+ * @return Returns said bits.
+ */
+static inline uint16_t ht_small_tag( ht_hash_val_t hash ) {
+  return (uint16_t)(hash >> 48);
+}
+
+/**
+ * Converts a #HT_ENGINE_SMALL hash table to #HT_ENGINE_CHAINED.
+ *
+ * @param table The hash table to convert.
+ * @param n The number of entries the table should have buckets for.
+ */
+static void ht_small_to_chained( hash_table_t *table, size_t n ) {
+  assert( table->engine == HT_ENGINE_SMALL );
+
+  // The entries are in the same union as the chained fields, so copy them.
+  ht_entry_t *small[ HT_SMALL_N ];
+  memcpy( small, table->small, table->size * sizeof(ht_entry_t*) );
+  ht_sizing_t const sizing = table->small_sizing;
+  bool const incremental = table->small_incremental;
+
+  table->engine = HT_ENGINE_CHAINED;
+  table->n_buckets = ht_n_buckets(
+    sizing, ht_n_needed( n, table->max_lf ), &table->shift
+  );
+  table->buckets =
+    ht_alloc( table, table->n_buckets * sizeof(ht_entry_t), true );
+  table->occupied = ht_occupied_new( table->n_buckets );
+  table->incremental = incremental;
+  table->old_buckets = NULL;
+  table->old_n_buckets = 0;
+  table->old_shift = 0;
+  table->migrate_idx = 0;
+
+  for ( size_t i = 0; i < table->size; ++i ) {
+    ht_entry_t *const entry = small[i];
+    ht_entry_t *const head = ht_bucket( table, entry->hash );
+    entry->next = head->next;
+    entry->prev = head;
+    if ( head->next != NULL )
+      head->next->prev = entry;
+    head->next = entry;
+    ht_occupied_update( table, head );
+  } // for
+}
+
+////////// open engine ////////////////////////////////////////////////////////
+
+/**
+ * Mixes a hash value so that both its low and high bits are usable for the
+ * open engine even when a table's \ref hash_table::hash_fn "hash_fn" is weak.
+ *
+ * @param hash The hash value to mix.
+ * @return Returns the mixed hash value.
+ */
+static inline uint64_t ht_open_mix( ht_hash_val_t hash ) {
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+/**
+ * Gets the 7-bit hash fragment stored in a control byte.
+ *
+ * @param mix The mixed hash value.
+ * @return Returns said fragment.
+ */
+static inline uint8_t ht_open_h2( uint64_t mix ) {
+  return (uint8_t)(mix & 0x7F);
+}
+
+/**
+ * Gets the index of the first group to probe.
+ *
+ * @param table The hash table.
+ * @param mix The mixed hash value.
+ * @return Returns said index.
+ */
+static inline size_t ht_open_group( hash_table_t const *table,
+                                    uint64_t mix ) {
+  return (size_t)(mix >> 7) & (table->n_slots / HT_GROUP_WIDTH - 1);
+}
+
+/**
+ * Gets the index of the next group to probe.  Triangular probing visits every
+ * group exactly once since the number of groups is a power of 2.
+ *
+ * @param table The hash table.
+ * @param g The index of the current group.
+ * @param i The 1-based probe number.
+ * @return Returns said index.
+ */
+static inline size_t ht_open_group_next( hash_table_t const *table,
+                                         size_t g, size_t i ) {
+  return (g + i) & (table->n_slots / HT_GROUP_WIDTH - 1);
+}
+
+#ifdef __SSE2__
+/**
+ * Gets a bitmask of the control bytes in a group that equal \a byte.
+ *
+ * @param ctrl A pointer to the group's first control byte.
+ * @param byte The byte to match.
+ * @return Returns a bitmask where bit _i_ is set only if `ctrl[i] == byte`.
+ */
+static inline unsigned ht_group_match( uint8_t const *ctrl, uint8_t byte ) {
+  __m128i const group = _mm_load_si128( (__m128i const*)ctrl );
+  return (unsigned)_mm_movemask_epi8(
+    _mm_cmpeq_epi8( group, _mm_set1_epi8( (char)byte ) )
+  );
+}
+
+/**
+ * Gets a bitmask of the control bytes in a group that are either empty or
+ * deleted.
+ *
+ * @param ctrl A pointer to the group's first control byte.
+ * @return Returns a bitmask where bit _i_ is set only if `ctrl[i]` is free.
+ */
+static inline unsigned ht_group_match_free( uint8_t const *ctrl ) {
+  return (unsigned)_mm_movemask_epi8(
+    _mm_load_si128( (__m128i const*)ctrl )
+  );
+}
+#else
+static inline unsigned ht_group_match( uint8_t const *ctrl, uint8_t byte ) {
+  unsigned mask = 0;
+  for ( unsigned i = 0; i < HT_GROUP_WIDTH; ++i )
+    mask |= (unsigned)(ctrl[i] == byte) << i;
+  return mask;
+}
+
+static inline unsigned ht_group_match_free( uint8_t const *ctrl ) {
+  unsigned mask = 0;
+  for ( unsigned i = 0; i < HT_GROUP_WIDTH; ++i )
+    mask |= (unsigned)(ctrl[i] >> 7) << i;
+  return mask;
+}
+#endif /* __SSE2__ */
+
+/**
+ * Gets a bitmask of the control bytes in a group that are full.
+ *
+ * @param ctrl A pointer to the group's first control byte.
+ * @return Returns a bitmask where bit _i_ is set only if `ctrl[i]` is full.
+ */
+static inline unsigned ht_group_match_full( uint8_t const *ctrl ) {
+  return ~ht_group_match_free( ctrl ) & ((1u << HT_GROUP_WIDTH) - 1);
+}
+
+/**
+ * Allocates the control bytes and slots of an open table.
+ *
+ * @param table The hash table.
+ * @param n_slots The number of slots.  It must be a power of 2 that is at
+ * least #HT_GROUP_WIDTH.
+ */
+static void ht_open_alloc( hash_table_t *table, size_t n_slots ) {
+  assert( n_slots >= HT_GROUP_WIDTH );
+  assert( (n_slots & (n_slots - 1)) == 0 );
+
+  // Any allocator's memory is aligned enough for a group.
+  table->ctrl = table->allocator == NULL ?
+    aligned_alloc( HT_GROUP_WIDTH, n_slots ) :
+    ht_alloc( table, n_slots, false );
+  memset( table->ctrl, HT_CTRL_EMPTY, n_slots );
+  table->slots = ht_alloc( table, n_slots * sizeof(ht_entry_t*), false );
+  table->n_slots = n_slots;
+  table->n_deleted = 0;
+}
+
+/**
+ * Gets the index of the first free slot for \a hash.
+ *
+ * @param table The hash table.
+ * @param mix The mixed hash value.
+ * @return Returns said index.
+ */
+static size_t ht_open_find_free( hash_table_t const *table, uint64_t mix ) {
+  size_t g = ht_open_group( table, mix );
+  for ( size_t i = 1; ; ++i ) {
+    unsigned const bits =
+      ht_group_match_free( table->ctrl + g * HT_GROUP_WIDTH );
+    if ( bits != 0 )
+      return g * HT_GROUP_WIDTH + ctz( bits );
+    g = ht_open_group_next( table, g, i );
+  } // for
+}
+
+/**
+ * Sets the slot at index \a s of an open table to \a entry.
+ *
+ * @param table The hash table.
+ * @param s The slot index.
+ * @param mix The mixed hash value of \a entry.
+ * @param entry The entry.
+ */
+static inline void ht_open_set( hash_table_t *table, size_t s, uint64_t mix,
+                                ht_entry_t *entry ) {
+  if ( table->ctrl[s] == HT_CTRL_DELETED )
+    --table->n_deleted;
+  table->ctrl[s] = ht_open_h2( mix );
+  table->slots[s] = entry;
+}
+
+/**
+ * Rehashes an open table into \a n_slots slots.  This both grows the table
+ * and purges deleted slots.
+ *
+ * @param table The hash table.
+ * @param n_slots The new number of slots.
+ */
+static void ht_open_rehash( hash_table_t *table, size_t n_slots ) {
+  uint8_t *const old_ctrl = table->ctrl;
+  ht_entry_t **const old_slots = table->slots;
+  size_t const old_n_slots = table->n_slots;
+
+  ht_open_alloc( table, n_slots );
+
+  for ( size_t g = 0; g < old_n_slots; g += HT_GROUP_WIDTH ) {
+    for ( unsigned bits = ht_group_match_full( old_ctrl + g ); bits != 0;
+          bits &= bits - 1 ) {
+      ht_entry_t *const entry = old_slots[ g + ctz( bits ) ];
+      uint64_t const mix = ht_open_mix( entry->hash );
+      ht_open_set( table, ht_open_find_free( table, mix ), mix, entry );
+    } // for
+  } // for
+
+  ht_free( table, old_ctrl, old_n_slots );
+  ht_free( table, old_slots, old_n_slots * sizeof(ht_entry_t*) );
+}
+
+/**
+ * Gets the number of slots an open table needs for \a n entries.
+ *
+ * @param n The number of entries.
+ * @param max_lf The maximum load factor.
+ * @return Returns said number of slots.
+ */
+static size_t ht_open_n_slots( size_t n, double max_lf ) {
+  size_t n_slots = HT_GROUP_WIDTH;
+  while ( n_slots * max_lf < n )
+    n_slots <<= 1;
+  return n_slots;
+}
+
+/**
+ * Gets the index of the slot containing the entry equal to \a data.
+ *
+ * @param table The hash table.
+ * @param cmp_fn The comparison function to use.
+ * @param hash The hash of \a data.
+ * @param data The data to search for.
+ * @param is_insert If `true`, the lookup is by an insert.  (Used only for
+ * statistics.)
+ * @param free_s If not NULL and not found, set to the index of the first free
+ * slot in the probe sequence, i.e., where ht_open_find_free() would put it.
+ * @return Returns said index or #HT_SLOT_NONE if not found.
+ */
+static size_t ht_open_find( hash_table_t const *table, ht_cmp_fn_t cmp_fn,
+                            ht_hash_val_t hash, void const *data,
+                            bool is_insert, size_t *free_s ) {
+  (void)is_insert;
+  uint64_t const mix = ht_open_mix( hash );
+  uint8_t const h2 = ht_open_h2( mix );
+  size_t g = ht_open_group( table, mix );
+  if ( free_s != NULL )
+    *free_s = HT_SLOT_NONE;
+
+  for ( size_t i = 1; ; ++i ) {
+    uint8_t const *const ctrl = table->ctrl + g * HT_GROUP_WIDTH;
+    for ( unsigned bits = ht_group_match( ctrl, h2 ); bits != 0;
+          bits &= bits - 1 ) {
+      size_t const s = g * HT_GROUP_WIDTH + ctz( bits );
+      if ( ht_entry_eq( table, cmp_fn, table->slots[s], hash, data ) ) {
+        HT_STATS_ONLY( ht_count_lookup( table, is_insert, i ); )
+        return s;
+      }
+    } // for
+    if ( free_s != NULL && *free_s == HT_SLOT_NONE ) {
+      unsigned const free_bits = ht_group_match_free( ctrl );
+      if ( free_bits != 0 )
+        *free_s = g * HT_GROUP_WIDTH + ctz( free_bits );
+    }
+    if ( ht_group_match( ctrl, HT_CTRL_EMPTY ) != 0 ) {
+      HT_STATS_ONLY( ht_count_lookup( table, is_insert, i ); )
+      return HT_SLOT_NONE;
+    }
+    g = ht_open_group_next( table, g, i );
+  } // for
+}
+
+/**
+ * Gets the index of the slot containing \a entry.
+ *
+ * @param table The hash table.
+ * @param entry The entry to search for.  It must be in \a table.
+ * @return Returns said index.
+ */
+static size_t ht_open_find_entry( hash_table_t const *table,
+                                  ht_entry_t const *entry ) {
+  uint64_t const mix = ht_open_mix( entry->hash );
+  uint8_t const h2 = ht_open_h2( mix );
+  size_t g = ht_open_group( table, mix );
+
+  for ( size_t i = 1; ; ++i ) {
+    uint8_t const *const ctrl = table->ctrl + g * HT_GROUP_WIDTH;
+    for ( unsigned bits = ht_group_match( ctrl, h2 ); bits != 0;
+          bits &= bits - 1 ) {
+      size_t const s = g * HT_GROUP_WIDTH + ctz( bits );
+      if ( table->slots[s] == entry )
+        return s;
+    } // for
+    assert( ht_group_match( ctrl, HT_CTRL_EMPTY ) == 0 );
+    g = ht_open_group_next( table, g, i );
+  } // for
+}
+
+////////// dense engine ///////////////////////////////////////////////////////
+
+/**
+ * Gets the index of the first index slot to probe for \a hash in a
+ * #HT_ENGINE_DENSE table.
+ *
+ * @param table The hash table.
+ * @param hash The hash value.
+ * @return Returns said index.
+ */
+static inline size_t ht_dense_slot( hash_table_t const *table,
+                                    ht_hash_val_t hash ) {
+  return (size_t)ht_open_mix( hash ) & (table->dense_n_index - 1);
+}
+
+/**
+ * Allocates the index and entry array of a #HT_ENGINE_DENSE table.
+ *
+ * @param table The hash table.
+ * @param n_index The number of index slots.  It must be a power of 2 that is
+ * at least #HT_GROUP_WIDTH.
+ */
+static void ht_dense_alloc( hash_table_t *table, size_t n_index ) {
+  assert( n_index >= HT_GROUP_WIDTH );
+  assert( (n_index & (n_index - 1)) == 0 );
+
+  table->dense_n_index = n_index;
+  table->dense_index = ht_alloc( table, n_index * sizeof(uint32_t), true );
+  // Since each entry ever added uses an index slot, the array need only be as
+  // large as the number of slots that can be used.
+  table->dense_cap = (size_t)(n_index * table->max_lf);
+  if ( table->dense_cap == 0 )          // a tiny max_lf
+    table->dense_cap = 1;
+  table->dense = ht_alloc( table, table->dense_cap * sizeof(ht_entry_t*),
+                           false );
+  table->dense_n = 0;
+}
+
+/**
+ * Frees the index and entry array of a #HT_ENGINE_DENSE table.
+ *
+ * @param table The hash table.
+ */
+static void ht_dense_free( hash_table_t *table ) {
+  ht_free(
+    table, table->dense_index, table->dense_n_index * sizeof(uint32_t)
+  );
+  ht_free( table, table->dense, table->dense_cap * sizeof(ht_entry_t*) );
+}
+
+/**
+ * Appends \a entry to the entry array of a #HT_ENGINE_DENSE table.
+ *
+ * @param table The hash table.
+ * @param s The index slot for \a entry.  It must be empty.
+ * @param entry The entry.
+ */
+static inline void ht_dense_append( hash_table_t *table, size_t s,
+                                    ht_entry_t *entry ) {
+  assert( table->dense_n < table->dense_cap );
+  assert( table->dense_n < UINT32_MAX );
+  assert( table->dense_index[s] == 0 );
+  table->dense[ table->dense_n++ ] = entry;
+  table->dense_index[s] = (uint32_t)table->dense_n;
+}
+
+/**
+ * Gets the index of the first empty index slot for \a hash.
+ *
+ * @param table The hash table.
+ * @param hash The hash value.
+ * @return Returns said index.
+ */
+static size_t ht_dense_find_empty( hash_table_t const *table,
+                                   ht_hash_val_t hash ) {
+  size_t const mask = table->dense_n_index - 1;
+  size_t s = ht_dense_slot( table, hash );
+  while ( table->dense_index[s] != 0 )
+    s = (s + 1) & mask;
+  return s;
+}
+
+/**
+ * Rebuilds a #HT_ENGINE_DENSE table with \a n_index index slots.  The entry
+ * array is compacted: deleted entries' holes are removed, but the order of the
+ * remaining entries is kept.
+ *
+ * @param table The hash table.
+ * @param n_index The new number of index slots.
+ */
+static void ht_dense_rehash( hash_table_t *table, size_t n_index ) {
+  uint32_t *const old_index = table->dense_index;
+  size_t const old_n_index = table->dense_n_index;
+  ht_entry_t **const old_dense = table->dense;
+  size_t const old_n = table->dense_n;
+  size_t const old_cap = table->dense_cap;
+
+  ht_dense_alloc( table, n_index );
+  for ( size_t i = 0; i < old_n; ++i ) {
+    ht_entry_t *const entry = old_dense[i];
+    if ( entry != NULL )
+      ht_dense_append(
+        table, ht_dense_find_empty( table, entry->hash ), entry
+      );
+  } // for
+
+  ht_free( table, old_index, old_n_index * sizeof(uint32_t) );
+  ht_free( table, old_dense, old_cap * sizeof(ht_entry_t*) );
+}
+
+/**
+ * Gets the index in the entry array of the entry equal to \a data.
+ *
+ * @param table The hash table.
+ * @param cmp_fn The comparison function to use.
+ * @param hash The hash of \a data.
+ * @param data The data to search for.
+ * @param is_insert If `true`, the lookup is by an insert.  (Used only for
+ * statistics.)
+ * @param empty_s If not NULL and not found, set to the index of the empty
+ * index slot the probe ended at, i.e., where ht_dense_find_empty() would.
+ * @return Returns said index or #HT_SLOT_NONE if not found.
+ */
+static size_t ht_dense_find( hash_table_t const *table, ht_cmp_fn_t cmp_fn,
+                             ht_hash_val_t hash, void const *data,
+                             bool is_insert, size_t *empty_s ) {
+  (void)is_insert;
+  size_t const mask = table->dense_n_index - 1;
+  size_t s = ht_dense_slot( table, hash );
+
+  for ( size_t probes = 1; ; ++probes ) {
+    uint32_t const i = table->dense_index[s];
+    if ( i == 0 ) {
+      HT_STATS_ONLY( ht_count_lookup( table, is_insert, probes ); )
+      if ( empty_s != NULL )
+        *empty_s = s;
+      return HT_SLOT_NONE;
+    }
+    // A deleted entry's slot stays in use (pointing at NULL) until a rehash.
+    ht_entry_t const *const entry = table->dense[ i - 1 ];
+    if ( entry != NULL && ht_entry_eq( table, cmp_fn, entry, hash, data ) ) {
+      HT_STATS_ONLY( ht_count_lookup( table, is_insert, probes ); )
+      return i - 1;
+    }
+    s = (s + 1) & mask;
+  } // for
+}
+
+/**
+ * Gets the index in the entry array of \a entry.
+ *
+ * @param table The hash table.
+ * @param entry The entry to search for.  It must be in \a table.
+ * @return Returns said index.
+ */
+static size_t ht_dense_find_entry( hash_table_t const *table,
+                                   ht_entry_t const *entry ) {
+  size_t const mask = table->dense_n_index - 1;
+  for ( size_t s = ht_dense_slot( table, entry->hash ); ;
+        s = (s + 1) & mask ) {
+    uint32_t const i = table->dense_index[s];
+    assert( i != 0 );
+    if ( table->dense[ i - 1 ] == entry )
+      return i - 1;
+  } // for
+}
+
+////////// all engines ////////////////////////////////////////////////////////
+
+/**
+ * Looks up a block of at most #HT_BATCH_N keys with their memory accesses
+ * overlapped: all keys are hashed and their buckets prefetched up front, then
+ * the chains are walked in lockstep, one entry per key per round, prefetching
+ * each key's next entry so that its latency is hidden behind the other keys'
+ * work.
+ *
+ * @param table The hash table to search.
+ * @param data The data to search for.
+ * @param n The number of \a data; must be at most #HT_BATCH_N.
+ * @param hash Set to the hash value of each of \a data.
+ * @param found Set to the entry containing each of \a data or NULL if not
+ * found.
+ * @return Returns the number of \a data found.
+ */
+static size_t ht_find_block( hash_table_t const *table,
+                             void const *const data[], size_t n,
+                             ht_hash_val_t hash[], ht_entry_t *found[] ) {
+  assert( n <= HT_BATCH_N );
+  size_t n_found = 0;
+  bool maybe[ HT_BATCH_N ];
+
+  for ( size_t i = 0; i < n; ++i ) {
+    hash[i] = (*table->hash_fn)( data[i] );
+    found[i] = NULL;
+    // Other engines test the filter in ht_find_hash() below.
+    maybe[i] = table->engine != HT_ENGINE_CHAINED ||
+               ht_filter_test( table, hash[i] );
+    if ( !maybe[i] )
+      continue;                         // don't fetch its bucket for nothing
+    switch ( table->engine ) {
+      case HT_ENGINE_CHAINED:
+        prefetch( ht_bucket( table, hash[i] ) );
+        break;
+      case HT_ENGINE_OPEN: {
+        size_t const g = ht_open_group( table, ht_open_mix( hash[i] ) );
+        prefetch( table->ctrl + g * HT_GROUP_WIDTH );
+        prefetch( table->slots + g * HT_GROUP_WIDTH );
+        break;
+      }
+      case HT_ENGINE_SMALL:             // entry pointers are in table
+        break;
+      case HT_ENGINE_DENSE:
+        prefetch( &table->dense_index[ ht_dense_slot( table, hash[i] ) ] );
+        break;
+      case HT_ENGINE_MAPPED:
+        prefetch( &table->map_buckets[
+          ht_bucket_idx( hash[i], table->map_n_buckets, table->map_shift )
+        ] );
+        break;
+    } // switch
+  } // for
+
+  if ( table->engine != HT_ENGINE_CHAINED ) {
+    for ( size_t i = 0; i < n; ++i ) {
+      found[i] = ht_find_hash( table, data[i], hash[i] );
+      n_found += found[i] != NULL;
+    } // for
+    return n_found;
+  }
+
+  ht_entry_t *cur[ HT_BATCH_N ];
+  HT_STATS_ONLY( size_t probes[ HT_BATCH_N ] = { 0 }; )
+  for ( size_t i = 0; i < n; ++i ) {
+    cur[i] = maybe[i] ? ht_bucket( table, hash[i] )->next : NULL;
+    if ( cur[i] != NULL )
+      prefetch( cur[i] );
+  } // for
+
+  for ( size_t n_active = n; n_active > 0; ) {
+    n_active = 0;
+    for ( size_t i = 0; i < n; ++i ) {
+      ht_entry_t *const entry = cur[i];
+      if ( entry == NULL )
+        continue;
+      HT_STATS_ONLY( ++probes[i]; )
+      if ( ht_entry_eq( table, table->cmp_fn, entry, hash[i], data[i] ) ) {
+        found[i] = entry;
+        cur[i] = NULL;
+        ++n_found;
+        continue;
+      }
+      cur[i] = entry->next;
+      if ( cur[i] != NULL ) {
+        prefetch( cur[i] );
+        ++n_active;
+      }
+    } // for
+  } // for
+
+  HT_STATS_ONLY(
+    for ( size_t i = 0; i < n; ++i ) {
+      if ( !maybe[i] )
+        continue;
+      ht_count_lookup( table, /*is_insert=*/false, probes[i] );
+      if ( found[i] == NULL )
+        ht_count_filter_fp( table );
+    } // for
+  )
+  return n_found;
+}
+
+/**
+ * Gets the partition of ht_build() for \a hash.
+ *
+ * @param job The build job.
+ * @param hash The hash value.
+ * @return Returns said partition index.
+ */
+static inline unsigned ht_build_part_idx( ht_build_job_t const *job,
+                                          ht_hash_val_t hash ) {
+  hash_table_t const *const table = job->table;
+  return (unsigned)(
+    ht_bucket_idx( hash, table->n_buckets, table->shift ) /
+    job->part_n_buckets
+  );
+}
+
+/**
+ * Links the records of one partition into their buckets.  Records are in
+ * increasing order so, as with ht_insert(), the first of equal records wins.
+ *
+ * @param job The build job.
+ * @param part The partition.
+ */
+static void ht_build_link( ht_build_job_t *job, ht_build_part_t *part ) {
+  hash_table_t *const table = job->table;
+
+  for ( size_t k = part->begin; k < part->end; ++k ) {
+    size_t const i = job->perm[k];
+    char const *const record = job->records + i * job->record_size;
+    ht_hash_val_t const hash = job->hashes[i];
+    size_t const b = ht_bucket_idx( hash, table->n_buckets, table->shift );
+    ht_entry_t *const head = &table->buckets[b];
+
+    bool dup = false;
+    for ( ht_entry_t const *entry = head->next; entry != NULL;
+          entry = entry->next ) {
+      if ( entry->hash == hash &&
+           (*table->cmp_fn)( record, entry->data ) == 0 ) {
+        dup = true;
+        break;
+      }
+    } // for
+
+    // A record's entry, if pooled, is at the record's index in the slab.
+    ht_entry_t *entry = job->slab == NULL ? NULL :
+      (ht_entry_t*)(job->slab->mem + i * job->entry_size);
+
+    if ( dup ) {
+      if ( entry != NULL ) {            // give its slab entry to the pool
+        entry->next = NULL;
+        if ( part->free_tail == NULL )
+          part->free_head = entry;
+        else
+          part->free_tail->next = entry;
+        part->free_tail = entry;
+      }
+      continue;
+    }
+
+    if ( entry == NULL ) {
+      entry = ht_alloc( table, job->entry_size, false );
+      ++part->n_large;
+    }
+    *entry = (ht_entry_t){
+      .next = head->next,
+      .prev = head,
+      .hash = hash,
+      .data_size = (uint32_t)job->record_size
+    };
+    memcpy( entry->data, record, job->record_size );
+    if ( head->next != NULL )
+      head->next->prev = entry;
+    head->next = entry;
+    ht_occupied_set( table, b );
+    ++part->n_inserted;
+  } // for
+}
+
+/**
+ * Thread main for ht_build(): does the current phase's work items until none
+ * remain.
+ *
+ * @param arg A pointer to the ht_build_job.
+ * @return Always returns NULL.
+ */
+static void* ht_build_thread( void *arg ) {
+  ht_build_job_t *const job = arg;
+  unsigned const n_items =
+    job->phase == HT_BUILD_LINK ? job->n_parts : job->n_chunks;
+
+  for ( unsigned w; (w = atomic_fetch_add( &job->next_item, 1 )) < n_items; ) {
+    if ( job->phase == HT_BUILD_LINK ) {
+      ht_build_link( job, &job->parts[w] );
+      continue;
+    }
+
+    size_t const begin = job->n * w / job->n_chunks;
+    size_t const end = job->n * (w + 1) / job->n_chunks;
+    size_t *const offsets = job->offsets + (size_t)w * job->n_parts;
+
+    if ( job->phase == HT_BUILD_HASH ) {
+      for ( size_t i = begin; i < end; ++i ) {
+        ht_hash_val_t const hash =
+          (*job->table->hash_fn)( job->records + i * job->record_size );
+        job->hashes[i] = hash;
+        ++offsets[ ht_build_part_idx( job, hash ) ];
+      } // for
+    } else {
+      for ( size_t i = begin; i < end; ++i ) {
+        unsigned const p = ht_build_part_idx( job, job->hashes[i] );
+        job->perm[ offsets[p]++ ] = i;
+      } // for
+    }
+  } // for
+
+  return NULL;
+}
+
+/**
+ * Runs a phase of ht_build() on \a n_threads threads, the calling thread
+ * being one of them.
+ *
+ * @param job The build job.
+ * @param phase The phase to run.
+ * @param n_threads The number of threads.
+ */
+static void ht_build_run( ht_build_job_t *job, ht_build_phase_t phase,
+                          unsigned n_threads ) {
+  job->phase = phase;
+  atomic_store( &job->next_item, 0 );
+
+  pthread_t *const threads = malloc( n_threads * sizeof(pthread_t) );
+  unsigned n_started = 0;
+  for ( ; n_started < n_threads - 1; ++n_started ) {
+    if ( pthread_create( &threads[ n_started ], NULL, &ht_build_thread,
+                         job ) != 0 ) {
+      break;                            // the remaining threads do the work
+    }
+  } // for
+  ht_build_thread( job );
+  for ( unsigned i = 0; i < n_started; ++i )
+    pthread_join( threads[i], NULL );
+  free( threads );
+}
+
+/**
+ * Thread main for ht_for_each_parallel(): visits the entries of parts of the
+ * table until none remain.
+ *
+ * @param arg A pointer to the ht_visit_thread.
+ * @return Always returns NULL.
+ */
+static void* ht_visit_thread( void *arg ) {
+  ht_visit_thread_t const *const thread = arg;
+  ht_visit_job_t *const job = thread->job;
+  unsigned const n_parts = job->n_parts;
+
+  for ( unsigned p; (p = atomic_fetch_add( &job->next_part, 1 )) < n_parts; ) {
+    ht_iterator_t it;
+    ht_iterator_init_range( &it, job->table, p, n_parts );
+    for ( ht_entry_t *entry; (entry = ht_iterator_next( &it )) != NULL; )
+      (*job->visit_fn)( entry, thread->idx, job->arg );
+  } // for
+
+  return NULL;
+}
+
+/**
+ * Adds a chain to the chain statistics.
+ *
+ * @param stats The statistics.
+ * @param len The length of the chain (or number of probes).
+ */
+static void ht_stats_add_chain( ht_stats_t *stats, size_t len ) {
+  ++stats->chain_hist[ len < HT_STATS_CHAIN_N ? len : HT_STATS_CHAIN_N - 1 ];
+  if ( len > stats->chain_max )
+    stats->chain_max = len;
+}
+
+/**
+ * Adds an entry to the byte statistics.  Entries too large to be pooled are
+ * counted individually; pooled entries are counted by slab.
+ *
+ * @param stats The statistics.
+ * @param entry The entry.
+ */
+static void ht_stats_add_entry( ht_stats_t *stats, ht_entry_t const *entry ) {
+  size_t const entry_size = ht_entry_size( entry->data_size );
+  stats->data_bytes += entry->data_size;
+  if ( entry_size > HT_POOL_ENTRY_SIZE_MAX )
+    stats->entry_bytes += entry_size;
+}
+
+/**
+ * Looks up \a data in a hash table.
+ *
+ * @param table The hash table to search.
+ * @param cmp_fn The comparison function to use.
+ * @param data The data to search for.
+ * @param hash The hash of \a data.
+ * @param is_insert If `true`, the lookup is by an insert.  (Used only for
+ * statistics.)
+ * @return Returns a pointer to the entry containing \a data or NULL if not
+ * found.
+ */
+static inline ht_entry_t* ht_lookup( hash_table_t const *table,
+                                     ht_cmp_fn_t cmp_fn, void const *data,
+                                     ht_hash_val_t hash, bool is_insert ) {
+  (void)is_insert;
+  HT_STATS_ONLY( size_t probes = 0; )
+
+  if ( table->filter != NULL ) {
+    // Overlap fetching the bucket with testing the filter in case it passes.
+    if ( table->engine == HT_ENGINE_CHAINED )
+      prefetch( ht_bucket( table, hash ) );
+    if ( !ht_filter_test( table, hash ) )
+      return NULL;
+  }
+
+  switch ( table->engine ) {
+    case HT_ENGINE_CHAINED:
+      for ( ht_entry_t *entry = ht_bucket( table, hash )->next; entry != NULL;
+            entry = entry->next ) {
+        HT_STATS_ONLY( ++probes; )
+        if ( ht_entry_eq( table, cmp_fn, entry, hash, data ) ) {
+          HT_STATS_ONLY( ht_count_lookup( table, is_insert, probes ); )
+          return entry;
+        }
+      } // for
+      break;
+
+    case HT_ENGINE_OPEN: {
+      size_t const s = ht_open_find(
+        table, cmp_fn, hash, data, is_insert, /*free_s=*/NULL
+      );
+      if ( s != HT_SLOT_NONE )
+        return table->slots[s];
+      HT_STATS_ONLY( ht_count_filter_fp( table ); )
+      return NULL;
+    }
+
+    case HT_ENGINE_SMALL: {
+      uint16_t const tag = ht_small_tag( hash );
+      for ( size_t i = 0; i < table->size; ++i ) {
+        if ( table->small_tags[i] != tag )
+          continue;
+        HT_STATS_ONLY( ++probes; )
+        if ( ht_entry_eq( table, cmp_fn, table->small[i], hash, data ) ) {
+          HT_STATS_ONLY( ht_count_lookup( table, is_insert, probes ); )
+          return table->small[i];
+        }
+      } // for
+      break;
+    }
+
+    case HT_ENGINE_DENSE: {
+      size_t const i = ht_dense_find(
+        table, cmp_fn, hash, data, is_insert, /*empty_s=*/NULL
+      );
+      if ( i != HT_SLOT_NONE )
+        return table->dense[i];
+      HT_STATS_ONLY( ht_count_filter_fp( table ); )
+      return NULL;
+    }
+
+    case HT_ENGINE_MAPPED: {
+      size_t const b =
+        ht_bucket_idx( hash, table->map_n_buckets, table->map_shift );
+      //
+      // ht_save() writes each chain in increasing offset order, so requiring
+      // that also guarantees a corrupt file can't make a chain loop.
+      //
+      ht_entry_t *entry;
+      for ( uint64_t off = table->map_buckets[b], prev_off = 0;
+            off > prev_off && (entry = ht_map_entry( table, off )) != NULL;
+            prev_off = off, off = (uintptr_t)entry->next ) {
+        HT_STATS_ONLY( ++probes; )
+        if ( ht_entry_eq( table, cmp_fn, entry, hash, data ) ) {
+          HT_STATS_ONLY( ht_count_lookup( table, is_insert, probes ); )
+          return entry;
+        }
+      } // for
+      break;
+    }
+  } // switch
+
+  HT_STATS_ONLY(
+    ht_count_lookup( table, is_insert, probes );
+    ht_count_filter_fp( table );
+  )
+  return NULL;
+}
+
+/**
+ * Creates a new entry and links it into a bucket of a #HT_ENGINE_CHAINED hash
+ * table.
+ *
+ * @param table The hash table.
+ * @param head The head of the bucket for \a hash.
+ * @param hash The hash value of the entry's data.
+ * @param data_size The size of the entry's data.
+ * @return Returns a pointer to the new entry.
+ */
+static ht_entry_t* ht_chain_new( hash_table_t *table, ht_entry_t *head,
+                                 ht_hash_val_t hash, size_t data_size ) {
+  ht_entry_t *const entry = ht_entry_new( table, hash, data_size );
+  entry->next = head->next;
+  entry->prev = head;
+  if ( head->next != NULL )
+    head->next->prev = entry;
+  head->next = entry;
+  ht_occupied_update( table, head );
+  return entry;
+}
+
+/**
+ * Looks up \a data in a hash table and, if not found, inserts a new entry for
+ * it.  In the common case of neither growing nor migrating, the new entry goes
+ * where the lookup ended, so the table is probed only once.
+ *
+ * @param table The hash table.
+ * @param data The data to look up.
+ * @param data_size The size of \a data.
+ * @param hash The hash value of \a data.
+ * @return Returns the same as ht_insert().
+ */
+static ht_insert_rv_t ht_lookup_insert( hash_table_t *table, void const *data,
+                                        size_t data_size,
+                                        ht_hash_val_t hash ) {
+  bool const one_probe = table->engine == HT_ENGINE_OPEN ||
+    table->engine == HT_ENGINE_DENSE ||
+    (table->engine == HT_ENGINE_CHAINED && table->old_buckets == NULL);
+
+  if ( !one_probe ) {
+    ht_entry_t *const entry =
+      ht_lookup( table, table->cmp_fn, data, hash, /*is_insert=*/true );
+    if ( entry != NULL )
+      return (ht_insert_rv_t){ entry, .inserted = false };
+  }
+  else if ( ht_filter_test( table, hash ) ) {
+    ht_entry_t *entry;
+    if ( table->engine == HT_ENGINE_OPEN ) {
+      size_t free_s;
+      size_t const s = ht_open_find(
+        table, table->cmp_fn, hash, data, /*is_insert=*/true, &free_s
+      );
+      if ( s != HT_SLOT_NONE )
+        return (ht_insert_rv_t){ table->slots[s], .inserted = false };
+      HT_STATS_ONLY( ht_count_filter_fp( table ); )
+      if ( table->size + table->n_deleted + 1 <=
+           table->n_slots * table->max_lf ) {
+        if ( table->filter != NULL )
+          ht_filter_add( table, hash );
+        entry = ht_entry_new( table, hash, data_size );
+        ht_open_set( table, free_s, ht_open_mix( hash ), entry );
+        ++table->size;
+        return (ht_insert_rv_t){ entry, .inserted = true };
+      }
+    }
+    else if ( table->engine == HT_ENGINE_DENSE ) {
+      size_t empty_s;
+      size_t const i = ht_dense_find(
+        table, table->cmp_fn, hash, data, /*is_insert=*/true, &empty_s
+      );
+      if ( i != HT_SLOT_NONE )
+        return (ht_insert_rv_t){ table->dense[i], .inserted = false };
+      HT_STATS_ONLY( ht_count_filter_fp( table ); )
+      if ( table->dense_n < table->dense_cap ) {
+        if ( table->filter != NULL )
+          ht_filter_add( table, hash );
+        entry = ht_entry_new( table, hash, data_size );
+        ht_dense_append( table, empty_s, entry );
+        ++table->size;
+        return (ht_insert_rv_t){ entry, .inserted = true };
+      }
+    }
+    else {
+      HT_STATS_ONLY( size_t probes = 0; )
+      ht_entry_t *const head = ht_bucket( table, hash );
+      for ( entry = head->next; entry != NULL; entry = entry->next ) {
+        HT_STATS_ONLY( ++probes; )
+        if ( ht_entry_eq( table, table->cmp_fn, entry, hash, data ) ) {
+          HT_STATS_ONLY( ht_count_lookup( table, true, probes ); )
+          return (ht_insert_rv_t){ entry, .inserted = false };
+        }
+      } // for
+      HT_STATS_ONLY(
+        ht_count_lookup( table, true, probes );
+        ht_count_filter_fp( table );
+      )
+      if ( (table->size + 1) / (double)table->n_buckets < table->max_lf ) {
+        if ( table->filter != NULL )
+          ht_filter_add( table, hash );
+        ++table->size;
+        entry = ht_chain_new( table, head, hash, data_size );
+        return (ht_insert_rv_t){ entry, .inserted = true };
+      }
+    }
+  }
+
+  // Not found, but the table must grow (or the filter said it isn't there).
+  return (ht_insert_rv_t){
+    ht_insert_new( table, hash, data_size ),
+    .inserted = true
+  };
+}
+
+/**
+ * Frees the data of all entries of a hash table and all entries too large to
+ * have been pooled.  Pooled entries themselves are not freed.
+ *
+ * @param table The hash table.
+ * @param free_fn A pointer to a function used to free data associated with
+ * each entry or NULL if unnecessary.
+ */
+static void ht_entries_free( hash_table_t *table, ht_free_fn_t free_fn ) {
+  //
+  // Pooled entries are freed a whole slab at a time, so individual entries
+  // need to be visited only if either their data needs to be freed or some
+  // were too large to be pooled.
+  //
+  if ( table->size > 0 && (free_fn != NULL || table->n_large > 0) ) {
+    ht_iterator_t it;
+    ht_iterator_init( &it, table );
+    for ( ht_entry_t *entry = ht_iterator_next( &it ), *next; entry != NULL;
+          entry = next ) {
+      next = ht_iterator_next( &it );
+      if ( free_fn != NULL )
+        (*free_fn)( entry->data );
+      size_t const entry_size = ht_entry_size( entry->data_size );
+      if ( entry_size > HT_POOL_ENTRY_SIZE_MAX )
+        ht_free( table, entry, entry_size );
+    } // for
+  }
+  table->n_large = 0;
+}
+
+/**
+ * Shrinks the buckets (or slots) of a hash table so that its load factor is
+ * at most \a lf, if that's fewer.
+ *
+ * @param table The hash table to shrink.
+ * @param lf The load factor.
+ */
+static void ht_shrink( hash_table_t *table, double lf ) {
+  switch ( table->engine ) {
+    case HT_ENGINE_CHAINED:
+      ht_resize( table, ht_n_needed( table->size, lf ), /*incremental=*/false );
+      break;
+    case HT_ENGINE_OPEN: {
+      size_t const n_slots = ht_open_n_slots( table->size, lf );
+      if ( n_slots < table->n_slots )
+        ht_open_rehash( table, n_slots );
+      break;
+    }
+    case HT_ENGINE_DENSE: {
+      size_t const n_index = ht_open_n_slots( table->size, lf );
+      if ( n_index < table->dense_n_index )
+        ht_dense_rehash( table, n_index );
+      break;
+    }
+    case HT_ENGINE_SMALL:               // has no buckets
+    case HT_ENGINE_MAPPED:              // read-only
+      break;
+  } // switch
+}
+
+////////// huge page allocator ////////////////////////////////////////////////
+
+/**
+ * Gets \a size rounded up to a multiple of #HT_HUGE_PAGE_SIZE.
+ *
+ * @param size The size.
+ * @return Returns said size.
+ */
+static inline size_t ht_huge_size( size_t size ) {
+  return (size + HT_HUGE_PAGE_SIZE - 1) & ~(HT_HUGE_PAGE_SIZE - 1);
+}
+
+/**
+ * Faults in all the pages of a mapping now rather than on each first touch.
+ *
+ * @param p A pointer to the mapping.
+ * @param size The size of the mapping.
+ */
+static void ht_huge_prefault( char *p, size_t size ) {
+#ifdef MADV_POPULATE_WRITE
+  if ( madvise( p, size, MADV_POPULATE_WRITE ) == 0 )
+    return;
+  // The kernel is older than 5.14: fall back to touching every page.
+#endif /* MADV_POPULATE_WRITE */
+  long const page_size = sysconf( _SC_PAGESIZE );
+  for ( size_t i = 0; i < size; i += (size_t)page_size )
+    p[i] = 0;
+}
+
+/**
+ * The \ref ht_allocator::alloc_fn "alloc_fn" of #ht_allocator_huge.
+ *
+ * @param size The number of bytes to allocate.
+ * @param zero If `true`, zero the memory.  (Mapped memory always is.)
+ * @param ctx Not used.
+ * @return Returns a pointer to the memory or NULL if it couldn't be mapped.
+ */
+static void* ht_huge_alloc( size_t size, bool zero, void *ctx ) {
+  (void)ctx;
+  if ( size < HT_HUGE_PAGE_SIZE )
+    return zero ? calloc( 1, size ) : malloc( size );
+
+  size_t const map_size = ht_huge_size( size );
+  //
+  // The kernel can back only aligned 2 MiB ranges by huge pages, so over-map
+  // by one huge page and unmap the unaligned head and excess tail.
+  //
+  char *const map = mmap(
+    NULL, map_size + HT_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
+  );
+  if ( map == MAP_FAILED )
+    return NULL;
+  size_t const head = -(uintptr_t)map & (HT_HUGE_PAGE_SIZE - 1);
+  char *const p = map + head;
+  if ( head > 0 )
+    munmap( map, head );
+  munmap( p + map_size, HT_HUGE_PAGE_SIZE - head );
+
+#ifdef MADV_HUGEPAGE
+  madvise( p, map_size, MADV_HUGEPAGE );
+#endif /* MADV_HUGEPAGE */
+  ht_huge_prefault( p, map_size );
+  return p;
+}
+
+/**
+ * The \ref ht_allocator::free_fn "free_fn" of #ht_allocator_huge.
  *
- * @param table The hash table to grow.
+ * @param p A pointer to the memory.
+ * @param size The number of bytes \a p was allocated with.
+ * @param ctx Not used.
  */
-static void ht_grow( hash_table_t *table ) {
+static void ht_huge_free( void *p, size_t size, void *ctx ) {
+  (void)ctx;
+  if ( size < HT_HUGE_PAGE_SIZE )
+    free( p );
+  else
+    munmap( p, ht_huge_size( size ) );
+}
+
+////////// extern variables ///////////////////////////////////////////////////
+
+ht_allocator_t const ht_allocator_huge = {
+  .alloc_fn = &ht_huge_alloc,
+  .free_fn = &ht_huge_free
+};
+
+////////// extern functions ///////////////////////////////////////////////////
+
+size_t ht_build( hash_table_t *table, void const *records, size_t record_size,
+                 size_t n, unsigned n_threads ) {
   assert( table != NULL );
+  assert( table->engine != HT_ENGINE_MAPPED );
+  assert( records != NULL || n == 0 );
 
-  unsigned const old_n_buckets = HT_PRIME[ table->prime_idx ];
-  if ( likely( table->prime_idx < ARRAY_SIZE( HT_PRIME ) - 1 ) )
-    ++table->prime_idx;
-  unsigned const new_n_buckets = HT_PRIME[ table->prime_idx ];
-  ht_entry_t *const new_buckets = calloc( new_n_buckets, sizeof(ht_entry_t) );
+  if ( n == 0 )
+    return 0;
 
-  for ( unsigned b = 0; b < old_n_buckets; ++b ) {
-    for ( ht_entry_t *entry = table->buckets[b].next, *next;
-          entry != NULL; entry = next ) {
-      ht_hash_val_t const hash = entry->hash;
-      ht_entry_t *const new_head = &new_buckets[ hash % new_n_buckets ];
+  ht_reserve( table, table->size + n );
 
-      next = entry->next;
-      entry->next = new_head->next;
-      entry->prev = new_head;
+  if ( table->engine != HT_ENGINE_CHAINED ) {
+    size_t n_inserted = 0;
+    for ( size_t i = 0; i < n; ++i ) {
+      char const *const record = (char const*)records + i * record_size;
+      ht_insert_rv_t const rv = ht_insert_hash(
+        table, record, record_size, (*table->hash_fn)( record )
+      );
+      if ( rv.inserted ) {
+        memcpy( rv.entry->data, record, record_size );
+        ++n_inserted;
+      }
+    } // for
+    return n_inserted;
+  }
 
-      if ( new_head->next != NULL )
-        new_head->next->prev = entry;
-      new_head->next = entry;
+  if ( table->old_buckets != NULL )     // finish any incremental resize
+    ht_migrate( table, table->old_n_buckets );
+
+  if ( n_threads == 0 ) {
+    long const n_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    n_threads = n_cpus > 0 ? (unsigned)n_cpus : 1;
+  }
+  if ( n_threads > n / HT_BUILD_N_PER_THREAD )
+    n_threads = n / HT_BUILD_N_PER_THREAD > 0 ?
+      (unsigned)(n / HT_BUILD_N_PER_THREAD) : 1;
+
+  ht_build_job_t job = {
+    .table = table,
+    .records = records,
+    .record_size = record_size,
+    .n = n,
+    .entry_size = ht_entry_size( record_size ),
+    .hashes = malloc( n * sizeof(ht_hash_val_t) ),
+    .perm = malloc( n * sizeof(size_t) ),
+    .n_chunks = n_threads * HT_BUILD_ITEMS_PER_THREAD,
+    .n_parts = n_threads * HT_BUILD_ITEMS_PER_THREAD
+  };
+  if ( job.n_parts > table->n_buckets )
+    job.n_parts = (unsigned)table->n_buckets;
+  //
+  // Partitions are whole words of occupied bits so that no two threads ever
+  // set bits of the same word.
+  //
+  job.part_n_buckets = (table->n_buckets + job.n_parts - 1) / job.n_parts;
+  job.part_n_buckets = (job.part_n_buckets + 63) & ~(size_t)63;
+  job.n_parts = (unsigned)
+    ((table->n_buckets + job.part_n_buckets - 1) / job.part_n_buckets);
+  job.offsets = calloc( (size_t)job.n_chunks * job.n_parts, sizeof(size_t) );
+  job.parts = calloc( job.n_parts, sizeof(ht_build_part_t) );
+
+  //
+  // All pooled entries are carved from one new slab, each record's entry at
+  // the record's index so threads need not coordinate allocation.
+  //
+  if ( job.entry_size <= HT_POOL_ENTRY_SIZE_MAX ) {
+    size_t const slab_size = n * job.entry_size;
+    job.slab = ht_alloc( table, sizeof(ht_slab_t) + slab_size, false );
+    job.slab->entry_size = job.entry_size;
+    job.slab->size = slab_size;
+  }
+
+  ht_build_run( &job, HT_BUILD_HASH, n_threads );
+
+  // Turn counts into offsets: all of partition 0 (in chunk order), etc.
+  size_t offset = 0;
+  for ( unsigned p = 0; p < job.n_parts; ++p ) {
+    job.parts[p].begin = offset;
+    for ( unsigned c = 0; c < job.n_chunks; ++c ) {
+      size_t *const count = &job.offsets[ (size_t)c * job.n_parts + p ];
+      size_t const n_records = *count;
+      *count = offset;
+      offset += n_records;
     } // for
+    job.parts[p].end = offset;
   } // for
 
-  free( table->buckets );
-  table->buckets = new_buckets;
-}
+  ht_build_run( &job, HT_BUILD_SCATTER, n_threads );
+  ht_build_run( &job, HT_BUILD_LINK, n_threads );
 
-////////// extern functions ///////////////////////////////////////////////////
+  size_t n_inserted = 0;
+  ht_pool_t *const pool = job.slab != NULL ?
+    ht_pool_get( table, job.entry_size ) : NULL;
+  for ( unsigned p = 0; p < job.n_parts; ++p ) {
+    ht_build_part_t const *const part = &job.parts[p];
+    n_inserted += part->n_inserted;
+    table->n_large += part->n_large;
+    if ( part->free_head != NULL ) {
+      part->free_tail->next = pool->free;
+      pool->free = part->free_head;
+    }
+  } // for
+  table->size += n_inserted;
+
+  if ( job.slab != NULL ) {
+    job.slab->next = table->slabs;
+    table->slabs = job.slab;
+  }
+
+  free( job.hashes );
+  free( job.perm );
+  free( job.offsets );
+  free( job.parts );
+
+  //
+  // Entries were linked directly, so add them all to the filter at once.
+  // Leave the same headroom as ht_filter_add() so the next insert doesn't
+  // rebuild it all over again.
+  //
+  if ( table->filter != NULL )
+    ht_filter_rebuild( table, 2 * table->size );
+  return n_inserted;
+}
 
 void ht_cleanup( hash_table_t *table, ht_free_fn_t free_fn ) {
-  if ( table == NULL || table->buckets == NULL )
+  if ( table == NULL )
     return;
 
-  for ( unsigned b = 0; b < HT_PRIME[ table->prime_idx ]; ++b ) {
-    for ( ht_entry_t *entry = table->buckets[b].next, *next;
-          entry != NULL; entry = next ) {
-      if ( free_fn != NULL )
-        (*free_fn)( entry->data );
-      next = entry->next;
-      free( entry );
-    }
-  } // for
+  switch ( table->engine ) {
+    case HT_ENGINE_CHAINED:
+      ht_entries_free( table, free_fn );
+      ht_free(
+        table, table->old_buckets, table->old_n_buckets * sizeof(ht_entry_t)
+      );
+      ht_free( table, table->buckets, table->n_buckets * sizeof(ht_entry_t) );
+      free( table->occupied );
+      break;
+    case HT_ENGINE_OPEN:
+      ht_entries_free( table, free_fn );
+      ht_free( table, table->ctrl, table->n_slots );
+      ht_free( table, table->slots, table->n_slots * sizeof(ht_entry_t*) );
+      break;
+    case HT_ENGINE_SMALL:
+      ht_entries_free( table, free_fn );
+      break;
+    case HT_ENGINE_DENSE:
+      ht_entries_free( table, free_fn );
+      ht_dense_free( table );
+      break;
+    case HT_ENGINE_MAPPED:
+      // Entries' data are in the read-only mapping, so there's nothing to
+      // free but the mapping itself.
+      munmap( (void*)table->map, table->map_size );
+      break;
+  } // switch
 
-  free( table->buckets );
+  ht_slabs_free( table );
+  free( table->filter );
   *table = (hash_table_t){ 0 };
 }
 
+void ht_clear( hash_table_t *table, ht_free_fn_t free_fn ) {
+  assert( table != NULL );
+  assert( table->engine != HT_ENGINE_MAPPED );
+
+  ht_entries_free( table, free_fn );
+
+  switch ( table->engine ) {
+    case HT_ENGINE_CHAINED:
+      if ( table->old_buckets != NULL ) {
+        ht_free(
+          table, table->old_buckets,
+          table->old_n_buckets * sizeof(ht_entry_t)
+        );
+        table->old_buckets = NULL;
+      }
+      memset( table->buckets, 0, table->n_buckets * sizeof(ht_entry_t) );
+      memset( table->occupied, 0, (table->n_buckets + 63) / 64 * 8 );
+      break;
+    case HT_ENGINE_OPEN:
+      memset( table->ctrl, HT_CTRL_EMPTY, table->n_slots );
+      table->n_deleted = 0;
+      break;
+    case HT_ENGINE_DENSE:
+      memset(
+        table->dense_index, 0, table->dense_n_index * sizeof(uint32_t)
+      );
+      table->dense_n = 0;
+      break;
+    case HT_ENGINE_SMALL:               // nothing but size to reset
+    case HT_ENGINE_MAPPED:              // read-only
+      break;
+  } // switch
+
+  ht_slabs_reuse( table );
+  table->size = 0;
+
+  if ( table->filter != NULL ) {
+    memset( table->filter->blocks, 0,
+            table->filter->n_blocks * HT_FILTER_BLOCK_SIZE );
+    table->filter->n = 0;
+  }
+}
+
 void ht_delete( hash_table_t *table, ht_entry_t *entry ) {
   assert( table != NULL );
+  assert( table->engine != HT_ENGINE_MAPPED );
   assert( entry != NULL );
 
-  entry->prev->next = entry->next;
-  if ( entry->next != NULL )
-    entry->next->prev = entry->prev;
-  free( entry );
+  switch ( table->engine ) {
+    case HT_ENGINE_CHAINED:
+      entry->prev->next = entry->next;
+      if ( entry->next != NULL )
+        entry->next->prev = entry->prev;
+      else
+        ht_occupied_update( table, entry->prev );
+      //
+      // Deliberately don't migrate old buckets here: an iterator may be in
+      // the middle of them and deleting the entry it just returned must
+      // remain safe.
+      //
+      break;
+
+    case HT_ENGINE_OPEN: {
+      size_t const s = ht_open_find_entry( table, entry );
+      uint8_t const *const ctrl =
+        table->ctrl + (s & ~(HT_GROUP_WIDTH - 1));
+      //
+      // A slot can be marked empty (rather than deleted) only if its group
+      // already has an empty slot: in that case, no probe for any other entry
+      // could ever have continued past this group.
+      //
+      if ( ht_group_match( ctrl, HT_CTRL_EMPTY ) != 0 ) {
+        table->ctrl[s] = HT_CTRL_EMPTY;
+      } else {
+        table->ctrl[s] = HT_CTRL_DELETED;
+        ++table->n_deleted;
+      }
+      break;
+    }
+
+    case HT_ENGINE_SMALL: {
+      size_t i = 0;
+      while ( table->small[i] != entry ) {
+        ++i;
+        assert( i < table->size );
+      } // while
+      // Moving the last entry into the hole keeps iterating (backwards) over
+      // entries while deleting the current one correct.
+      size_t const last = table->size - 1;
+      table->small[i] = table->small[ last ];
+      table->small_tags[i] = table->small_tags[ last ];
+      break;
+    }
+
+    case HT_ENGINE_DENSE:
+      // The hole keeps the order of, and indices of, all other entries.
+      table->dense[ ht_dense_find_entry( table, entry ) ] = NULL;
+      break;
+
+    case HT_ENGINE_MAPPED:              // read-only
+      break;
+  } // switch
+
+  if ( table->filter != NULL )
+    ht_filter_remove( table->filter, entry->hash );
+  ht_entry_free( table, entry );
   --table->size;
+
+  if ( table->min_lf > 0 && table->engine != HT_ENGINE_SMALL ) {
+    size_t const n =
+      table->engine == HT_ENGINE_OPEN ? table->n_slots :
+      table->engine == HT_ENGINE_DENSE ? table->dense_n_index :
+      table->n_buckets;
+    if ( table->size < n * table->min_lf )
+      ht_shrink( table, table->max_lf / 2 );
+  }
+}
+
+bool ht_delete_hash( hash_table_t *table, void const *data,
+                     ht_hash_val_t hash, ht_free_fn_t free_fn ) {
+  assert( table != NULL );
+  assert( data != NULL );
+
+  ht_entry_t *const entry =
+    ht_lookup( table, table->cmp_fn, data, hash, /*is_insert=*/false );
+  if ( entry == NULL )
+    return false;
+  if ( free_fn != NULL )
+    (*free_fn)( entry->data );
+  ht_delete( table, entry );
+  return true;
 }
 
 ht_entry_t* ht_find( hash_table_t const *table, void const *data ) {
   assert( table != NULL );
   assert( data != NULL );
+  return ht_find_hash( table, data, (*table->hash_fn)( data ) );
+}
 
-  unsigned const b = (*table->hash_fn)( data ) % HT_PRIME[ table->prime_idx ];
-  for ( ht_entry_t *entry = table->buckets[b].next; entry != NULL;
-        entry = entry->next ) {
-    if ( (*table->cmp_fn)( data, entry->data ) == 0 )
-      return entry;
+size_t ht_find_batch( hash_table_t const *table, void const *const data[],
+                      size_t n, ht_entry_t *found[] ) {
+  assert( table != NULL );
+  assert( data != NULL || n == 0 );
+  assert( found != NULL || n == 0 );
+
+  ht_hash_val_t hash[ HT_BATCH_N ];
+  size_t n_found = 0;
+  for ( size_t i = 0; i < n; i += HT_BATCH_N ) {
+    size_t const block_n = n - i < HT_BATCH_N ? n - i : HT_BATCH_N;
+    n_found += ht_find_block( table, data + i, block_n, hash, found + i );
   } // for
+  return n_found;
+}
 
-  return NULL;
+ht_entry_t* ht_find_hash( hash_table_t const *table, void const *data,
+                          ht_hash_val_t hash ) {
+  assert( table != NULL );
+  assert( data != NULL );
+  return ht_lookup( table, table->cmp_fn, data, hash, /*is_insert=*/false );
+}
+
+ht_entry_t* ht_find_key( hash_table_t const *table, void const *key,
+                         ht_hash_val_t hash, ht_cmp_fn_t key_cmp_fn ) {
+  assert( table != NULL );
+  assert( key != NULL );
+  assert( key_cmp_fn != NULL );
+  return ht_lookup( table, key_cmp_fn, key, hash, /*is_insert=*/false );
+}
+
+ht_insert_rv_t ht_find_or_insert( hash_table_t *table, void const *data,
+                                  size_t data_size, ht_hash_val_t hash ) {
+  assert( table != NULL );
+  assert( table->engine != HT_ENGINE_MAPPED );
+  assert( data != NULL );
+
+  ht_insert_rv_t const rv = ht_lookup_insert( table, data, data_size, hash );
+  if ( rv.inserted )
+    memcpy( rv.entry->data, data, data_size );
+  return rv;
+}
+
+void ht_for_each_parallel( hash_table_t *table, ht_visit_fn_t visit_fn,
+                           void *arg, unsigned n_threads ) {
+  assert( table != NULL );
+  assert( visit_fn != NULL );
+
+  if ( n_threads == 0 ) {
+    long const n_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    n_threads = n_cpus > 0 ? (unsigned)n_cpus : 1;
+  }
+  if ( n_threads > table->size / HT_BUILD_N_PER_THREAD )
+    n_threads = table->size / HT_BUILD_N_PER_THREAD > 0 ?
+      (unsigned)(table->size / HT_BUILD_N_PER_THREAD) : 1;
+
+  ht_visit_job_t job = {
+    .table = table,
+    .visit_fn = visit_fn,
+    .arg = arg,
+    .n_parts = n_threads * HT_BUILD_ITEMS_PER_THREAD
+  };
+  atomic_init( &job.next_part, 0 );
+
+  ht_visit_thread_t *const threads =
+    malloc( n_threads * sizeof(ht_visit_thread_t) );
+  unsigned n_started = 1;               // the calling thread is thread 0
+  for ( ; n_started < n_threads; ++n_started ) {
+    threads[ n_started ] =
+      (ht_visit_thread_t){ .job = &job, .idx = n_started };
+    if ( pthread_create( &threads[ n_started ].thread, NULL,
+                         &ht_visit_thread, &threads[ n_started ] ) != 0 ) {
+      break;                            // the remaining threads do the work
+    }
+  } // for
+  threads[0] = (ht_visit_thread_t){ .job = &job, .idx = 0 };
+  ht_visit_thread( &threads[0] );
+  for ( unsigned i = 1; i < n_started; ++i )
+    pthread_join( threads[i].thread, NULL );
+  free( threads );
+}
+
+void ht_get_stats( hash_table_t const *table, ht_stats_t *stats ) {
+  assert( table != NULL );
+  assert( stats != NULL );
+
+  *stats = (ht_stats_t){ 0 };
+  HT_STATS_ONLY( stats->counters = table->counters; )
+
+  switch ( table->engine ) {
+    case HT_ENGINE_CHAINED: {
+      stats->n_buckets = table->n_buckets;
+      stats->bucket_bytes = table->n_buckets * sizeof(ht_entry_t) +
+                            (table->n_buckets + 63) / 64 * 8;
+      if ( table->old_buckets != NULL ) {
+        stats->n_buckets += table->old_n_buckets - table->migrate_idx;
+        stats->bucket_bytes += table->old_n_buckets * sizeof(ht_entry_t);
+      }
+      for ( size_t b = 0; b < stats->n_buckets; ++b ) {
+        ht_entry_t const *const head = b < table->n_buckets ?
+          &table->buckets[b] :
+          &table->old_buckets[ table->migrate_idx + b - table->n_buckets ];
+        size_t len = 0;
+        for ( ht_entry_t const *entry = head->next; entry != NULL;
+              entry = entry->next, ++len ) {
+          ht_stats_add_entry( stats, entry );
+        } // for
+        ht_stats_add_chain( stats, len );
+      } // for
+      break;
+    }
+
+    case HT_ENGINE_OPEN:
+      stats->n_buckets = table->n_slots;
+      stats->bucket_bytes =
+        table->n_slots * (sizeof *table->ctrl + sizeof *table->slots);
+      for ( size_t g = 0; g < table->n_slots; g += HT_GROUP_WIDTH ) {
+        for ( unsigned bits = ht_group_match_full( table->ctrl + g );
+              bits != 0; bits &= bits - 1 ) {
+          ht_entry_t const *const entry = table->slots[ g + ctz( bits ) ];
+          ht_stats_add_entry( stats, entry );
+          // Count the probes to reach the entry's group from its first.
+          size_t const entry_g = g / HT_GROUP_WIDTH;
+          size_t probe_g = ht_open_group( table, ht_open_mix( entry->hash ) );
+          size_t probes = 1;
+          for ( ; probe_g != entry_g; ++probes )
+            probe_g = ht_open_group_next( table, probe_g, probes );
+          ht_stats_add_chain( stats, probes - 1 );
+        } // for
+      } // for
+      break;
+
+    case HT_ENGINE_SMALL:
+      // The entries are searched as if they were one chain.
+      stats->n_buckets = 1;
+      for ( size_t i = 0; i < table->size; ++i )
+        ht_stats_add_entry( stats, table->small[i] );
+      ht_stats_add_chain( stats, table->size );
+      break;
+
+    case HT_ENGINE_DENSE:
+      stats->n_buckets = table->dense_n_index;
+      stats->bucket_bytes = table->dense_n_index * sizeof(uint32_t) +
+                            table->dense_cap * sizeof(ht_entry_t*);
+      for ( size_t s = 0; s < table->dense_n_index; ++s ) {
+        uint32_t const i = table->dense_index[s];
+        if ( i == 0 || table->dense[ i - 1 ] == NULL )
+          continue;
+        ht_entry_t const *const entry = table->dense[ i - 1 ];
+        ht_stats_add_entry( stats, entry );
+        // Count the probes to reach the entry's slot from its first.
+        size_t const first_s = ht_dense_slot( table, entry->hash );
+        ht_stats_add_chain(
+          stats, (s - first_s) & (table->dense_n_index - 1)
+        );
+      } // for
+      break;
+
+    case HT_ENGINE_MAPPED:
+      stats->n_buckets = table->map_n_buckets;
+      stats->bucket_bytes = table->map_n_buckets * sizeof(uint64_t);
+      for ( size_t b = 0; b < table->map_n_buckets; ++b ) {
+        size_t len = 0;
+        ht_entry_t const *entry;
+        for ( uint64_t off = table->map_buckets[b], prev_off = 0;
+              off > prev_off && (entry = ht_map_entry( table, off )) != NULL;
+              prev_off = off, off = (uintptr_t)entry->next, ++len ) {
+          stats->data_bytes += entry->data_size;
+        } // for
+        ht_stats_add_chain( stats, len );
+      } // for
+      stats->entry_bytes = table->map_size - table->map_entries;
+      return;
+  } // switch
+
+  if ( table->filter != NULL ) {
+    ht_filter_t const *const filter = table->filter;
+    stats->filter_bytes =
+      sizeof(ht_filter_t) + filter->n_blocks * HT_FILTER_BLOCK_SIZE;
+    //
+    // Data that isn't present is a false positive only if all the counters
+    // it tests in its block are non-zero, so the expected rate is the
+    // average over blocks of the fraction of non-zero counters to the K.
+    //
+    double fpr_sum = 0;
+    for ( size_t b = 0; b < filter->n_blocks; ++b ) {
+      unsigned nonzero = 0;
+      for ( unsigned w = 0; w < HT_FILTER_BLOCK_SIZE / 8; ++w ) {
+        uint64_t const word = filter->blocks[b][w];
+        nonzero += popcount64(
+          (word | word >> 1 | word >> 2 | word >> 3) & 0x1111111111111111ull
+        );
+      } // for
+      double const p = nonzero / (double)HT_FILTER_BLOCK_N;
+      double p_k = 1;
+      for ( unsigned i = 0; i < HT_FILTER_K; ++i )
+        p_k *= p;
+      fpr_sum += p_k;
+    } // for
+    stats->filter_fpr = fpr_sum / filter->n_blocks;
+  }
+
+  // Pooled entries are counted by slab; only large entries were counted.
+  for ( ht_slab_t const *slab = table->slabs; slab != NULL;
+        slab = slab->next ) {
+    stats->entry_bytes += sizeof(ht_slab_t) + slab->size;
+  } // for
+  for ( unsigned i = 0; i < table->n_pools; ++i ) {
+    for ( ht_slab_t const *slab = table->pools[i].spare; slab != NULL;
+          slab = slab->next ) {
+      stats->entry_bytes += sizeof(ht_slab_t) + slab->size;
+    } // for
+  } // for
 }
 
-void ht_init( hash_table_t *table, double max_lf, unsigned est_size,
+void ht_init( hash_table_t *table, double max_lf, size_t est_size,
               ht_cmp_fn_t cmp_fn, ht_hash_fn_t hash_fn ) {
+  ht_init_opt(
+    table, max_lf, est_size, cmp_fn, hash_fn,
+    &(ht_options_t){ .engine = HT_DEFAULT_ENGINE }
+  );
+}
+
+void ht_init_opt( hash_table_t *table, double max_lf, size_t est_size,
+                  ht_cmp_fn_t cmp_fn, ht_hash_fn_t hash_fn,
+                  ht_options_t const *opt ) {
   assert( table != NULL );
   assert( max_lf > 0.0 );
   assert( cmp_fn != NULL );
   assert( hash_fn != NULL );
+  assert( opt != NULL );
 
-  unsigned prime_idx = 0;
-  for ( ; prime_idx < ARRAY_SIZE( HT_PRIME ) - 1; ++prime_idx ) {
-    if ( HT_PRIME[ prime_idx ] * max_lf >= est_size )
-      break;
-  } // for
+  ht_engine_t engine = opt->engine;
+  if ( engine == HT_ENGINE_SMALL && est_size > HT_SMALL_N )
+    engine = HT_ENGINE_CHAINED;
 
   *table = (hash_table_t){
-    .buckets = calloc( HT_PRIME[ prime_idx ], sizeof(ht_entry_t) ),
     .cmp_fn = cmp_fn,
     .hash_fn = hash_fn,
     .max_lf = max_lf,
-    .prime_idx = prime_idx
+    .engine = engine,
+    .allocator = opt->allocator
   };
+
+  switch ( engine ) {
+    case HT_ENGINE_CHAINED:
+      table->n_buckets = ht_n_buckets(
+        opt->sizing, ht_n_needed( est_size, max_lf ), &table->shift
+      );
+      table->buckets =
+        ht_alloc( table, table->n_buckets * sizeof(ht_entry_t), true );
+      table->occupied = ht_occupied_new( table->n_buckets );
+      table->incremental = opt->incremental;
+      break;
+
+    case HT_ENGINE_OPEN:
+      if ( table->max_lf > HT_OPEN_MAX_LF )
+        table->max_lf = HT_OPEN_MAX_LF;
+      ht_open_alloc( table, ht_open_n_slots( est_size, table->max_lf ) );
+      break;
+
+    case HT_ENGINE_DENSE:
+      if ( table->max_lf > HT_DENSE_MAX_LF )
+        table->max_lf = HT_DENSE_MAX_LF;
+      ht_dense_alloc( table, ht_open_n_slots( est_size, table->max_lf ) );
+      break;
+
+    case HT_ENGINE_SMALL:
+      table->small_sizing = opt->sizing;
+      table->small_incremental = opt->incremental;
+      break;
+
+    case HT_ENGINE_MAPPED:              // only via ht_open_mapped()
+      assert( false );
+      break;
+  } // switch
+
+  table->min_lf = opt->min_lf;
+  assert( table->min_lf < table->max_lf / 2 );
+
+  if ( opt->filter )
+    table->filter = ht_filter_new( est_size );
 }
 
 ht_insert_rv_t ht_insert( hash_table_t *table, void *data, size_t data_size ) {
-  ht_hash_val_t const hash = (*table->hash_fn)( data );
+  return ht_insert_hash( table, data, data_size, (*table->hash_fn)( data ) );
+}
 
-  unsigned n_buckets = HT_PRIME[ table->prime_idx ];
-  unsigned b = hash % n_buckets;
-  ht_entry_t *head = &table->buckets[b];
+size_t ht_insert_batch( hash_table_t *table, void const *const data[],
+                        size_t data_size, size_t n, ht_insert_rv_t rv[] ) {
+  assert( table != NULL );
+  assert( data != NULL || n == 0 );
+  assert( rv != NULL || n == 0 );
 
-  for ( ht_entry_t *entry = head->next; entry != NULL; entry = entry->next ) {
-    if ( (*table->cmp_fn)( data, entry->data ) == 0 )
-      return (ht_insert_rv_t){ entry, .inserted = false };
+  ht_hash_val_t hash[ HT_BATCH_N ];
+  ht_entry_t *found[ HT_BATCH_N ];
+  size_t n_inserted = 0;
+
+  for ( size_t i = 0; i < n; i += HT_BATCH_N ) {
+    size_t const block_n = n - i < HT_BATCH_N ? n - i : HT_BATCH_N;
+    ht_find_block( table, data + i, block_n, hash, found );
+    for ( size_t j = 0; j < block_n; ++j ) {
+      if ( found[j] != NULL ) {
+        rv[ i + j ] = (ht_insert_rv_t){ found[j], .inserted = false };
+        continue;
+      }
+      //
+      // Not found before this block, but an equal key earlier in the same
+      // block may have just been inserted, so this must check again.  The
+      // chain is in cache by now, so doing so is cheap.  For the check to
+      // work, that key's data must already have been copied.
+      //
+      rv[ i + j ] =
+        ht_insert_hash( table, data[ i + j ], data_size, hash[j] );
+      if ( rv[ i + j ].inserted ) {
+        memcpy( rv[ i + j ].entry->data, data[ i + j ], data_size );
+        ++n_inserted;
+      }
+    } // for
   } // for
 
-  double const lf = ++table->size / (double)n_buckets;
-  if ( lf >= table->max_lf ) {
-    ht_grow( table );
-    n_buckets = HT_PRIME[ table->prime_idx ];
-    b = hash % n_buckets;
-    head = &table->buckets[b];
+  return n_inserted;
+}
+
+ht_insert_rv_t ht_insert_hash( hash_table_t *table, void const *data,
+                               size_t data_size, ht_hash_val_t hash ) {
+  assert( table != NULL );
+  assert( table->engine != HT_ENGINE_MAPPED );
+  assert( data != NULL );
+
+  return ht_lookup_insert( table, data, data_size, hash );
+}
+
+ht_entry_t* ht_insert_new( hash_table_t *table, ht_hash_val_t hash,
+                           size_t data_size ) {
+  assert( table != NULL );
+  assert( table->engine != HT_ENGINE_MAPPED );
+
+  if ( table->filter != NULL )
+    ht_filter_add( table, hash );
+
+  if ( table->engine == HT_ENGINE_OPEN ) {
+    //
+    // Deleted slots count against the load factor since they lengthen
+    // probes; if they account for most of it, just rehash in place.
+    //
+    if ( table->size + table->n_deleted + 1 > table->n_slots * table->max_lf ) {
+      HT_STATS_ONLY( uint64_t const start_ns = ht_now_ns(); )
+      size_t n_slots = table->n_slots;
+      if ( table->size + 1 > n_slots * table->max_lf / 2 )
+        n_slots <<= 1;
+      ht_open_rehash( table, n_slots );
+      HT_STATS_ONLY( ht_count_grow( table, start_ns ); )
+    }
+
+    uint64_t const mix = ht_open_mix( hash );
+    ht_entry_t *const entry = ht_entry_new( table, hash, data_size );
+    ht_open_set( table, ht_open_find_free( table, mix ), mix, entry );
+    ++table->size;
+    return entry;
   }
 
-  ht_entry_t *const entry = malloc( sizeof(ht_entry_t) + data_size );
-  *entry = (ht_entry_t){ .next = head->next, .prev = head, .hash = hash };
-  if ( head->next != NULL )
-    head->next->prev = entry;
-  head->next = entry;
+  if ( table->engine == HT_ENGINE_DENSE ) {
+    //
+    // As for the open engine, if holes left by deleted entries account for
+    // most of the array, just compact it in place.
+    //
+    if ( table->dense_n == table->dense_cap ) {
+      HT_STATS_ONLY( uint64_t const start_ns = ht_now_ns(); )
+      size_t n_index = table->dense_n_index;
+      if ( table->size + 1 > table->dense_cap / 2 )
+        n_index = ht_open_n_slots( 2 * table->size, table->max_lf );
+      ht_dense_rehash( table, n_index );
+      HT_STATS_ONLY( ht_count_grow( table, start_ns ); )
+    }
+
+    ht_entry_t *const entry = ht_entry_new( table, hash, data_size );
+    ht_dense_append( table, ht_dense_find_empty( table, hash ), entry );
+    ++table->size;
+    return entry;
+  }
+
+  if ( table->engine == HT_ENGINE_SMALL ) {
+    if ( table->size < HT_SMALL_N ) {
+      ht_entry_t *const entry = ht_entry_new( table, hash, data_size );
+      table->small_tags[ table->size ] = ht_small_tag( hash );
+      table->small[ table->size++ ] = entry;
+      return entry;
+    }
+    HT_STATS_ONLY( uint64_t const start_ns = ht_now_ns(); )
+    ht_small_to_chained( table, table->size + 1 );
+    HT_STATS_ONLY( ht_count_grow( table, start_ns ); )
+  }
 
-  return (ht_insert_rv_t){ entry, .inserted = true };
+  double const lf = ++table->size / (double)table->n_buckets;
+  if ( lf >= table->max_lf )
+    ht_grow( table );
+  else if ( unlikely( table->old_buckets != NULL ) )
+    ht_migrate( table, HT_MIGRATE_N );
+  return ht_chain_new( table, ht_bucket( table, hash ), hash, data_size );
 }
 
 void ht_iterator_init( ht_iterator_t *it, hash_table_t *table ) {
+  ht_iterator_init_range( it, table, 0, 1 );
+}
+
+void ht_iterator_init_range( ht_iterator_t *it, hash_table_t *table,
+                             unsigned part, unsigned n_parts ) {
   assert( it != NULL );
   assert( table != NULL );
+  assert( part < n_parts );
+
+  size_t n_buckets = 0;
+  switch ( table->engine ) {
+    case HT_ENGINE_CHAINED:
+      n_buckets = table->n_buckets;
+      if ( table->old_buckets != NULL )
+        n_buckets += table->old_n_buckets - table->migrate_idx;
+      break;
+    case HT_ENGINE_OPEN:
+      n_buckets = table->n_slots;
+      break;
+    case HT_ENGINE_SMALL:
+      n_buckets = table->size;
+      break;
+    case HT_ENGINE_DENSE:
+      n_buckets = table->dense_n;
+      break;
+    case HT_ENGINE_MAPPED:
+      n_buckets = table->map_n_buckets;
+      break;
+  } // switch
+
+  // Written this way, n_buckets * part can't overflow.
+  size_t begin = n_buckets / n_parts * part +
+                 n_buckets % n_parts * part / n_parts;
+  size_t end = n_buckets / n_parts * (part + 1) +
+               n_buckets % n_parts * (part + 1) / n_parts;
+  ht_entry_t *next = NULL;
+
+  if ( table->engine == HT_ENGINE_MAPPED ) {
+    //
+    // Each bucket's entries are contiguous and in bucket order, so the
+    // entries of a range of buckets are those from the first entry of its
+    // first non-empty bucket up to that of the next range (or the end of the
+    // file).  The range is then those offsets instead.
+    //
+    while ( begin < n_buckets && table->map_buckets[ begin ] == 0 )
+      ++begin;
+    while ( end < n_buckets && table->map_buckets[ end ] == 0 )
+      ++end;
+    begin = begin < n_buckets ? table->map_buckets[ begin ] : table->map_size;
+    end = end < n_buckets ? table->map_buckets[ end ] : table->map_size;
+    next = (ht_entry_t*)(table->map + begin);
+  }
 
   *it = (ht_iterator_t){
     .table = table,
-    .bucket_idx = (unsigned)-1,
-    .n_buckets = HT_PRIME[ table->prime_idx ]
+    .next = next,
+    .bucket_idx = begin - 1,
+    .begin = begin,
+    .end = end,
+    .n_buckets = n_buckets
   };
 }
 
 ht_entry_t* ht_iterator_next( ht_iterator_t *it ) {
   assert( it != NULL );
+  hash_table_t const *const table = it->table;
+
+  if ( table->engine == HT_ENGINE_MAPPED ) {
+    ht_entry_t *const entry = it->next;
+    size_t const off = (size_t)((char const*)entry - table->map);
+    if ( off >= it->end || ht_map_entry( table, off ) == NULL )
+      return NULL;
+    it->next =
+      (ht_entry_t*)((char*)entry + ht_entry_size( entry->data_size ));
+    return entry;
+  }
+
+  if ( table->engine == HT_ENGINE_SMALL ) {
+    //
+    // Entries are iterated over backwards so that deleting the current one
+    // (that moves the last entry, already returned, into its place) doesn't
+    // cause any entry to be skipped.
+    //
+    if ( ++it->bucket_idx >= it->end ) {
+      it->bucket_idx = it->end;
+      return NULL;
+    }
+    return table->small[ it->begin + it->end - 1 - it->bucket_idx ];
+  }
+
+  if ( table->engine == HT_ENGINE_DENSE ) {
+    while ( ++it->bucket_idx < it->end ) {
+      ht_entry_t *const entry = table->dense[ it->bucket_idx ];
+      if ( entry != NULL )
+        return entry;
+    } // while
+    it->bucket_idx = it->end - 1;
+    return NULL;
+  }
+
+  if ( table->engine == HT_ENGINE_OPEN ) {
+    assert( it->n_buckets == table->n_slots );
+    while ( ++it->bucket_idx < it->end ) {
+      if ( (table->ctrl[ it->bucket_idx ] & HT_CTRL_EMPTY) == 0 )
+        return table->slots[ it->bucket_idx ];
+    } // while
+    it->bucket_idx = it->end - 1;
+    return NULL;
+  }
+
+  //
+  // While a table is being incrementally resized, the old buckets not yet
+  // migrated are iterated over first, then all the new buckets.  Only the
+  // new buckets have occupied bits to skip empty ones quickly.
+  //
+  size_t const n_old = table->old_buckets == NULL ? 0 :
+    table->old_n_buckets - table->migrate_idx;
 
   for (;;) {
-    assert( it->n_buckets == HT_PRIME[it->table->prime_idx] );
+    assert( it->n_buckets == table->n_buckets + n_old );
     if ( it->next != NULL ) {
       ht_entry_t *const entry = it->next;
       it->next = it->next->next;
       return entry;
     }
-    if ( ++it->bucket_idx == it->n_buckets )
+    size_t b = it->bucket_idx + 1;
+    if ( b >= n_old && b < it->end )
+      b = n_old + ht_occupied_next( table, b - n_old, it->end - n_old );
+    if ( b >= it->end ) {
+      it->bucket_idx = it->end - 1;
       return NULL;
-    it->next = it->table->buckets[ it->bucket_idx ].next;
+    }
+    it->bucket_idx = b;
+    it->next = b < n_old ?
+      table->old_buckets[ table->migrate_idx + b ].next :
+      table->buckets[ b - n_old ].next;
+  } // for
+}
+
+bool ht_open_mapped( hash_table_t *table, char const *path,
+                     ht_cmp_fn_t cmp_fn, ht_hash_fn_t hash_fn ) {
+  assert( table != NULL );
+  assert( path != NULL );
+  assert( cmp_fn != NULL );
+  assert( hash_fn != NULL );
+
+  int const fd = open( path, O_RDONLY );
+  if ( fd == -1 )
+    return false;
+  struct stat st;
+  if ( fstat( fd, &st ) == -1 ) {
+    int const fstat_errno = errno;
+    close( fd );
+    errno = fstat_errno;
+    return false;
+  }
+  size_t const map_size = (size_t)st.st_size;
+  if ( map_size < sizeof(ht_file_header_t) ) {
+    close( fd );
+    errno = EINVAL;
+    return false;
+  }
+
+  char const *const map =
+    mmap( NULL, map_size, PROT_READ, MAP_SHARED, fd, 0 );
+  int const mmap_errno = errno;
+  close( fd );                          // the mapping remains valid
+  if ( map == MAP_FAILED ) {
+    errno = mmap_errno;
+    return false;
+  }
+
+  ht_file_header_t const *const header = (ht_file_header_t const*)map;
+  if ( memcmp( header->magic, HT_FILE_MAGIC, sizeof header->magic ) != 0 ||
+       header->version != HT_FILE_VERSION ||
+       header->entry_size != sizeof(ht_entry_t) ||
+       header->file_size != map_size ||
+       header->n_buckets == 0 ||
+       (header->n_buckets & (header->n_buckets - 1)) != 0 ||
+       header->shift != 64 - (unsigned)ctz64( header->n_buckets ) ||
+       header->buckets_off < sizeof(ht_file_header_t) ||
+       header->buckets_off % alignof(uint64_t) != 0 ||
+       header->entries_off % alignof(ht_entry_t) != 0 ||
+       header->entries_off < header->buckets_off ||
+       header->entries_off > map_size ||
+       // Written this way, it can't overflow.
+       header->n_buckets >
+         (header->entries_off - header->buckets_off) / sizeof(uint64_t) ) {
+    munmap( (void*)map, map_size );
+    errno = EINVAL;
+    return false;
+  }
+
+  // Lookups are random, so read-ahead would just read pages never used.
+  madvise( (void*)map, map_size, MADV_RANDOM );
+
+  *table = (hash_table_t){
+    .map = map,
+    .map_size = map_size,
+    .map_buckets = (uint64_t const*)(map + header->buckets_off),
+    .map_n_buckets = header->n_buckets,
+    .map_shift = header->shift,
+    .map_entries = header->entries_off,
+    .cmp_fn = cmp_fn,
+    .hash_fn = hash_fn,
+    .size = header->size,
+    .engine = HT_ENGINE_MAPPED
+  };
+  return true;
+}
+
+void ht_reserve( hash_table_t *table, size_t n ) {
+  assert( table != NULL );
+  assert( table->engine != HT_ENGINE_MAPPED );
+
+  if ( table->engine == HT_ENGINE_SMALL ) {
+    if ( n <= HT_SMALL_N )
+      return;
+    ht_small_to_chained( table, n );
+  }
+
+  switch ( table->engine ) {
+    case HT_ENGINE_CHAINED: {
+      size_t const n_buckets = ht_n_needed( n, table->max_lf );
+      if ( n_buckets > table->n_buckets )
+        ht_resize( table, n_buckets, /*incremental=*/false );
+      break;
+    }
+    case HT_ENGINE_OPEN: {
+      size_t const n_slots = ht_open_n_slots( n, table->max_lf );
+      if ( n_slots > table->n_slots )
+        ht_open_rehash( table, n_slots );
+      break;
+    }
+    case HT_ENGINE_DENSE: {
+      size_t const n_index = ht_open_n_slots( n, table->max_lf );
+      if ( n_index > table->dense_n_index )
+        ht_dense_rehash( table, n_index );
+      break;
+    }
+    case HT_ENGINE_SMALL:               // converted above
+    case HT_ENGINE_MAPPED:              // read-only
+      break;
+  } // switch
+}
+
+bool ht_save( hash_table_t *table, char const *path ) {
+  assert( table != NULL );
+  assert( path != NULL );
+
+  unsigned shift;
+  size_t const n_buckets = ht_n_buckets( HT_SIZING_POW2, table->size, &shift );
+  size_t const buckets_off = ht_entry_size( sizeof(ht_file_header_t) ) -
+                             sizeof(ht_entry_t);
+  size_t const entries_off =
+    ht_entry_size( buckets_off + n_buckets * sizeof(uint64_t) ) -
+    sizeof(ht_entry_t);
+
+  ht_iterator_t it;
+  size_t file_size = entries_off;
+  ht_iterator_init( &it, table );
+  for ( ht_entry_t const *entry; (entry = ht_iterator_next( &it )) != NULL; )
+    file_size += ht_entry_size( entry->data_size );
+
+  int const fd = open( path, O_RDWR | O_CREAT | O_TRUNC, 0666 );
+  if ( fd == -1 )
+    return false;
+  //
+  // Allocate the file's blocks up front (rather than just set its size) so
+  // running out of space is an error here rather than a SIGBUS later when
+  // writing to the mapping.
+  //
+  int const fallocate_errno = posix_fallocate( fd, 0, (off_t)file_size );
+  if ( fallocate_errno != 0 ) {
+    close( fd );
+    errno = fallocate_errno;
+    return false;
+  }
+  char *const map =
+    mmap( NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  if ( map == MAP_FAILED ) {
+    int const mmap_errno = errno;
+    close( fd );
+    errno = mmap_errno;
+    return false;
+  }
+
+  //
+  // Each bucket's entries are made contiguous in three passes over the
+  // bucket offsets that need no other memory:
+  //
+  //  1. Sum the sizes of each bucket's entries.
+  //  2. Convert the sums to starting offsets, then copy each entry to its
+  //     bucket's next offset, leaving each offset at its bucket's end.
+  //  3. Link each bucket's entries and reset each offset to its start (the
+  //     previous bucket's end).
+  //
+  uint64_t *const buckets = (uint64_t*)(map + buckets_off);
+
+  ht_iterator_init( &it, table );
+  for ( ht_entry_t const *entry; (entry = ht_iterator_next( &it )) != NULL; ) {
+    buckets[ ht_bucket_idx( entry->hash, n_buckets, shift ) ] +=
+      ht_entry_size( entry->data_size );
+  } // for
+
+  for ( size_t b = 0, off = entries_off; b < n_buckets; ++b ) {
+    size_t const bucket_size = buckets[b];
+    buckets[b] = off;
+    off += bucket_size;
   } // for
+
+  ht_iterator_init( &it, table );
+  for ( ht_entry_t const *entry; (entry = ht_iterator_next( &it )) != NULL; ) {
+    uint64_t *const off =
+      &buckets[ ht_bucket_idx( entry->hash, n_buckets, shift ) ];
+    ht_entry_t *const file_entry = (ht_entry_t*)(map + *off);
+    *file_entry = (ht_entry_t){
+      .hash = entry->hash,
+      .data_size = entry->data_size
+    };
+    memcpy( file_entry->data, entry->data, entry->data_size );
+    *off += ht_entry_size( entry->data_size );
+  } // for
+
+  for ( size_t b = 0, start = entries_off; b < n_buckets; ++b ) {
+    size_t const end = buckets[b];
+    buckets[b] = start == end ? 0 : start;
+    for ( size_t off = start; off < end; ) {
+      ht_entry_t *const file_entry = (ht_entry_t*)(map + off);
+      off += ht_entry_size( file_entry->data_size );
+      file_entry->next = off < end ? (ht_entry_t*)(uintptr_t)off : NULL;
+    } // for
+    start = end;
+  } // for
+
+  ht_file_header_t *const header = (ht_file_header_t*)map;
+  *header = (ht_file_header_t){
+    .version = HT_FILE_VERSION,
+    .entry_size = sizeof(ht_entry_t),
+    .shift = shift,
+    .size = table->size,
+    .n_buckets = n_buckets,
+    .buckets_off = buckets_off,
+    .entries_off = entries_off,
+    .file_size = file_size
+  };
+  memcpy( header->magic, HT_FILE_MAGIC, sizeof header->magic );
+
+  munmap( map, file_size );
+  return close( fd ) == 0;
+}
+
+void ht_shrink_to_fit( hash_table_t *table ) {
+  assert( table != NULL );
+  assert( table->engine != HT_ENGINE_MAPPED );
+
+  ht_shrink( table, table->max_lf );
+  if ( table->engine == HT_ENGINE_OPEN && table->n_deleted > 0 )
+    ht_open_rehash( table, table->n_slots );
+  else if ( table->engine == HT_ENGINE_DENSE && table->dense_n > table->size )
+    ht_dense_rehash( table, table->dense_n_index );
+  // Shrinking is the point, so make the filter no larger than necessary.
+  if ( table->filter != NULL )
+    ht_filter_rebuild( table, 0 );
+
+  if ( table->size == 0 ) {
+    // With no entries, every slab is unused.
+    ht_slabs_free( table );
+    table->slabs = NULL;
+    table->pools = NULL;
+    table->n_pools = 0;
+  }
+  else {
+    for ( unsigned i = 0; i < table->n_pools; ++i ) {
+      ht_slab_list_free( table, table->pools[i].spare );
+      table->pools[i].spare = NULL;
+    } // for
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -202,6 +3323,8 @@ ht_entry_t* ht_iterator_next( ht_iterator_t *it ) {
 
 /// @cond DOXYGEN_IGNORE
 
+extern inline ht_entry_t* ht_bucket( hash_table_t const*, ht_hash_val_t );
+extern inline size_t ht_bucket_idx( ht_hash_val_t, size_t, unsigned );
 extern inline bool ht_empty( hash_table_t const* );
 
 /// @endcond
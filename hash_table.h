@@ -27,6 +27,10 @@
 #include <stddef.h>                     /* for max_align_t */
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
 /**
  * Gets a pointer to the internal data of \a ENTRY.
  *
@@ -57,13 +61,38 @@
  */
 #define HT_DPTR(ENTRY)            ( *(void**)HT_DINT( (ENTRY) ) )
 
+/**
+ * 2<sup>64</sup> / &phi;, used for Fibonacci (multiplicative) hashing: the high
+ * bits of `hash * HT_FIBONACCI` are well-mixed even when the low bits of
+ * `hash` aren't.
+ */
+#define HT_FIBONACCI              0x9E3779B97F4A7C15ull
+
+/**
+ * Maximum number of entries of a #HT_ENGINE_SMALL hash table.
+ */
+#define HT_SMALL_N                8
+
+/**
+ * Number of elements of \ref ht_stats::chain_hist "chain_hist".
+ */
+#define HT_STATS_CHAIN_N          16
+
 ////////// typrdefs ///////////////////////////////////////////////////////////
 
 typedef struct hash_table     hash_table_t;
+typedef struct ht_allocator   ht_allocator_t;
+typedef struct ht_counters    ht_counters_t;
 typedef struct ht_entry       ht_entry_t;
+typedef struct ht_filter      ht_filter_t;
 typedef uint64_t              ht_hash_val_t;
 typedef struct ht_insert_rv   ht_insert_rv_t;
 typedef struct ht_iterator    ht_iterator_t;
+typedef struct ht_options     ht_options_t;
+typedef struct ht_pool        ht_pool_t;
+typedef struct ht_probe_stats ht_probe_stats_t;
+typedef struct ht_slab        ht_slab_t;
+typedef struct ht_stats       ht_stats_t;
 
 /**
  * The signature for a function passed to ht_init() used to compare entry data.
@@ -92,18 +121,255 @@ typedef void (*ht_free_fn_t)( void *data );
  */
 typedef ht_hash_val_t (*ht_hash_fn_t)( void const *data );
 
+/**
+ * The signature for a function passed to ht_for_each_parallel() called for
+ * each entry.
+ *
+ * @param entry The entry.
+ * @param thread_idx The index of the calling thread in [0, _n_threads_) so
+ * that, e.g., each thread can accumulate into its own element of an array.
+ * @param arg The argument passed to ht_for_each_parallel().
+ */
+typedef void (*ht_visit_fn_t)( ht_entry_t *entry, unsigned thread_idx,
+                               void *arg );
+
+////////// enumerations ///////////////////////////////////////////////////////
+
+/**
+ * The engine, i.e., storage strategy, a hash_table uses.
+ */
+enum ht_engine {
+  /**
+   * Separate chaining: each bucket is the head of a doubly linked list of
+   * entries.
+   */
+  HT_ENGINE_CHAINED,
+
+  /**
+   * Open addressing: a packed array of 1-byte control bytes, each holding 7
+   * bits of an entry's hash, is probed 16 bytes at a time (using SSE2, if
+   * available) and only candidate entries having matching control bytes are
+   * compared.
+   *
+   * @note The table's \ref hash_table::max_lf "max_lf" is clamped to 7/8.
+   */
+  HT_ENGINE_OPEN,
+
+  /**
+   * Small: no buckets are allocated.  Instead, pointers to up to #HT_SMALL_N
+   * entries are kept within the hash_table itself along with 16 bits of each
+   * entry's hash, so a lookup is a linear scan that examines only entries
+   * whose 16 bits match.  Inserting an entry into a full table converts it to
+   * #HT_ENGINE_CHAINED using the \ref ht_options::sizing "sizing" and \ref
+   * ht_options::incremental "incremental" options it was initialized with.
+   * This suits very many tables that usually have only a few entries.
+   *
+   * @note If ht_init_opt()'s `est_size` is greater than #HT_SMALL_N, the
+   * table is #HT_ENGINE_CHAINED from the start.  A table that has converted
+   * never converts back.
+   */
+  HT_ENGINE_SMALL,
+
+  /**
+   * Dense: in the style of Python's compact dict, pointers to entries are kept
+   * in an array in insertion order and the table itself is an open-addressed
+   * array of only 32-bit indices into it.  Since entries are also allocated
+   * one after another, iterating is a sequential scan of both, and the order
+   * is deterministic: insertion order.  Deleting an entry leaves a hole in
+   * the array until the next time it's rebuilt, i.e., when it's full.
+   *
+   * @note The table's \ref hash_table::max_lf "max_lf" is clamped to 2/3.
+   * @note A table can have at most 2<sup>32</sup> - 1 entries.
+   */
+  HT_ENGINE_DENSE,
+
+  /**
+   * A read-only table memory-mapped from a file written by ht_save() and
+   * opened by ht_open_mapped().  Only ht_find() and its variants, iteration,
+   * and ht_cleanup() may be used.
+   */
+  HT_ENGINE_MAPPED
+};
+typedef enum ht_engine ht_engine_t;
+
+/**
+ * How the number of buckets of a #HT_ENGINE_CHAINED hash_table is chosen and
+ * how a hash value is reduced to a bucket index.
+ */
+enum ht_sizing {
+  /**
+   * The number of buckets is a prime and a bucket index is `hash % n`.  This
+   * is the default since a prime modulus uses all bits of a hash value so it
+   * tolerates weak hash functions.
+   */
+  HT_SIZING_PRIME,
+
+  /**
+   * The number of buckets is a power of 2 and a bucket index is the high
+   * bits of `hash` multiplied by 2<sup>64</sup>/&phi; (Fibonacci hashing).
+   * This avoids a 64-bit integer division on every operation.
+   */
+  HT_SIZING_POW2
+};
+typedef enum ht_sizing ht_sizing_t;
+
+#ifndef HT_DEFAULT_ENGINE
+/**
+ * The engine ht_init() uses.  It can be overridden at compile-time, e.g.,
+ * `-DHT_DEFAULT_ENGINE=HT_ENGINE_OPEN`, to compare engines without changing
+ * any code.
+ */
+#define HT_DEFAULT_ENGINE         HT_ENGINE_CHAINED
+#endif /* HT_DEFAULT_ENGINE */
+
 ////////// structures /////////////////////////////////////////////////////////
 
+/**
+ * Statistics of one kind of lookup.  A probe is an entry examined or, for
+ * #HT_ENGINE_OPEN, a group of slots examined.
+ */
+struct ht_probe_stats {
+  uint64_t      n;                      ///< Number of lookups.
+  uint64_t      probes;                 ///< Total number of probes.
+  uint64_t      probes_max;             ///< Most probes of any one lookup.
+};
+
+/**
+ * Counters of events on a hash table's hot paths.  They're maintained only if
+ * `HT_STATS` is defined, which it must be either for all or for none of the
+ * files that include this one since it changes the layout of \ref
+ * hash_table; otherwise they're not even present so they cost nothing.
+ *
+ * @note Since lookups update counters of a `const` table, if several threads
+ * search the same table at once, its counters are only approximate.
+ *
+ * @sa ht_get_stats()
+ */
+struct ht_counters {
+  /**
+   * Lookups by ht_find() and its variants.  For ht_find_batch() and
+   * ht_insert_batch(), each key is a lookup.
+   */
+  ht_probe_stats_t finds;
+
+  /// Lookups by ht_insert(), ht_insert_hash(), and ht_insert_batch().
+  ht_probe_stats_t inserts;
+
+  /// Calls of \ref hash_table::cmp_fn "cmp_fn", i.e., hash values matched.
+  uint64_t      n_cmps;
+
+  /// Calls of \ref hash_table::cmp_fn "cmp_fn" that returned non-zero.
+  uint64_t      n_cmp_fails;
+
+  /// Lookups that the \ref ht_options::filter "filter" answered "absent."
+  uint64_t      n_filter_negs;
+
+  /**
+   * Lookups that the \ref ht_options::filter "filter" answered "maybe
+   * present" that then didn't find an entry, i.e., false positives.  The
+   * measured false-positive rate is this divided by the sum of it and \ref
+   * n_filter_negs.
+   */
+  uint64_t      n_filter_fps;
+
+  /// Number of times the table grew (or, if open, rehashed) by inserting.
+  uint64_t      n_grows;
+
+  /// Nanoseconds spent growing.
+  uint64_t      grow_ns;
+};
+
+/**
+ * An allocator for the memory of a hash table that grows with it: its buckets
+ * (or slots) and its entries.  (Small bookkeeping memory is still allocated
+ * with malloc(3).)
+ *
+ * @sa #ht_allocator_huge
+ * @sa ht_options::allocator
+ */
+struct ht_allocator {
+  /**
+   * Allocates memory.
+   *
+   * @param size The number of bytes to allocate; never 0.
+   * @param zero If `true`, the memory must be zeroed.
+   * @param ctx The allocator's \ref ctx.
+   * @return Returns a pointer to memory aligned to at least 16 bytes and to
+   * `alignof(max_align_t)`.
+   */
+  void* (*alloc_fn)( size_t size, bool zero, void *ctx );
+
+  /**
+   * Frees memory allocated by \ref alloc_fn.
+   *
+   * @param p A pointer to the memory.
+   * @param size The number of bytes it was allocated with.
+   * @param ctx The allocator's \ref ctx.
+   */
+  void (*free_fn)( void *p, size_t size, void *ctx );
+
+  void         *ctx;                    ///< Passed to both functions.
+};
+
 /**
  * A hash table.
  */
 struct hash_table {
-  ht_entry_t   *buckets;                ///< Buckets.
+  union {
+    struct {                            // HT_ENGINE_CHAINED
+      ht_entry_t   *buckets;            ///< Buckets.
+      size_t        n_buckets;          ///< Number of buckets.
+      uint64_t     *occupied;           ///< Bit per non-empty bucket.
+      unsigned      shift;              ///< Fibonacci shift or 0 if prime.
+      bool          incremental;        ///< Resize incrementally?
+      ht_entry_t   *old_buckets;        ///< Buckets being migrated, if any.
+      size_t        old_n_buckets;      ///< Number of old buckets.
+      unsigned      old_shift;          ///< Fibonacci shift of old buckets.
+      size_t        migrate_idx;        ///< Next old bucket to migrate.
+    };
+    struct {                            // HT_ENGINE_OPEN
+      uint8_t      *ctrl;               ///< Control bytes.
+      ht_entry_t  **slots;              ///< Slots.
+      size_t        n_slots;            ///< Number of slots.
+      size_t        n_deleted;          ///< Number of deleted slots.
+    };
+    struct {                            // HT_ENGINE_SMALL
+      ht_entry_t   *small[ HT_SMALL_N ];  ///< Entries.
+      uint16_t      small_tags[ HT_SMALL_N ]; ///< High 16 bits of hashes.
+      ht_sizing_t   small_sizing;       ///< Sizing once chained.
+      bool          small_incremental;  ///< Incremental once chained?
+    };
+    struct {                            // HT_ENGINE_DENSE
+      uint32_t     *dense_index;        ///< 1 + index into \ref dense or 0.
+      size_t        dense_n_index;      ///< Number of indices; power of 2.
+      ht_entry_t  **dense;              ///< Entries in order; NULL if deleted.
+      size_t        dense_n;            ///< Number of \ref dense used.
+      size_t        dense_cap;          ///< Capacity of \ref dense.
+    };
+    struct {                            // HT_ENGINE_MAPPED
+      char const   *map;                ///< Mapped file.
+      size_t        map_size;           ///< Size of \ref map.
+      uint64_t const *map_buckets;      ///< Offsets of first entries or 0.
+      size_t        map_n_buckets;      ///< Number of buckets; power of 2.
+      unsigned      map_shift;          ///< Fibonacci shift.
+      size_t        map_entries;        ///< Offset of the first entry.
+    };
+  };
   ht_cmp_fn_t   cmp_fn;                 ///< Comparison function.
   ht_hash_fn_t  hash_fn;                ///< Hash function.
   double        max_lf;                 ///< Maximum load factor.
-  unsigned      size;                   ///< Number of entries.
-  unsigned      prime_idx;              ///< Index into HT_PRIME.
+  double        min_lf;                 ///< Minimum load factor or 0.
+  size_t        size;                   ///< Number of entries.
+  ht_engine_t   engine;                 ///< Engine used.
+  ht_pool_t    *pools;                  ///< Entry pools, one per size class.
+  unsigned      n_pools;                ///< Number of entry pools.
+  size_t        n_large;                ///< Number of entries not in a pool.
+  ht_slab_t    *slabs;                  ///< Slabs entry pools carve from.
+  ht_filter_t  *filter;                 ///< Filter of hashes or NULL.
+  ht_allocator_t const *allocator;      ///< Allocator or NULL for malloc(3).
+#ifdef HT_STATS
+  ht_counters_t counters;               ///< Hot-path counters.
+#endif /* HT_STATS */
 };
 
 /**
@@ -112,11 +378,15 @@ struct hash_table {
  * @remarks Once created, `ht_entry` objects don't move even if the hash table
  * grows, so pointers to them remain valid until either deleted or the hash
  * table is cleaned up.
+ *
+ * @remarks Entries are carved from slabs owned by the hash table rather than
+ * individually allocated.
  */
 struct ht_entry {
   ht_entry_t   *next;                   ///< Next entry, if any.
   ht_entry_t   *prev;                   ///< Previous entry, if any.
   ht_hash_val_t hash;                   ///< Entry hash.
+  uint32_t      data_size;              ///< Size of \ref data.
   alignas(max_align_t) char data[];     ///< Entry data.
 };
 
@@ -144,17 +414,207 @@ struct ht_insert_rv {
 };
 
 /**
- * An iterator for a hash_table.
+ * An iterator for a hash_table over all its buckets (or slots) or, via
+ * ht_iterator_init_range(), a range of them.
  */
 struct ht_iterator {
   hash_table_t *table;                  ///< Hash table being iterated over.
   ht_entry_t   *next;                   ///< Next entry, if any.
-  unsigned      bucket_idx;             ///< Current bucket index.
-  unsigned      n_buckets;              ///< Number of buckets.
+  size_t        bucket_idx;             ///< Current bucket (or slot) index.
+  size_t        begin;                  ///< First bucket (or slot) index.
+  size_t        end;                    ///< One past last bucket (or slot).
+                                        // (If mapped, both are offsets.)
+  size_t        n_buckets;              ///< Number of buckets (or slots).
+};
+
+/**
+ * Options for ht_init_opt().
+ */
+struct ht_options {
+  ht_engine_t   engine;                 ///< Engine to use.
+  ht_sizing_t   sizing;                 ///< Bucket sizing for chained engine.
+
+  /**
+   * If `true`, growing a #HT_ENGINE_CHAINED table allocates the new buckets
+   * but leaves the entries in the old buckets; each subsequent ht_insert()
+   * then migrates a bounded number of old buckets until all have been
+   * migrated.  This bounds the latency of any single ht_insert() at the cost
+   * of both arrays of buckets coexisting for a while.
+   *
+   * @note ht_find() and ht_iterator_next() work correctly during migration,
+   * but don't themselves migrate since they don't modify the table.  Neither
+   * does ht_delete(), so deleting the entry just returned by
+   * ht_iterator_next() is as safe during migration as otherwise.
+   */
+  bool          incremental;
+
+  /**
+   * If &gt; 0, when ht_delete() makes the load factor drop below this, the
+   * table shrinks so that its load factor is half the maximum.  It must be
+   * less than half the maximum load factor so that a table doesn't shrink
+   * right after growing.
+   *
+   * @warning Shrinking rehashes, so any iterators are invalidated.
+   */
+  double        min_lf;
+
+  /**
+   * If `true`, the table also maintains a counting blocked Bloom filter of
+   * its entries' hash values that ht_find() and its variants (and
+   * ht_insert()) test before touching any bucket.  Each hash value maps to a
+   * single 64-byte block of 4-bit counters, so a lookup of data that isn't
+   * present costs one cache line (except for about 1% false positives)
+   * rather than a bucket and its whole chain.  The filter takes 6 bytes per
+   * entry when full and is rebuilt twice as large whenever it fills.
+   *
+   * This pays off when most lookups are misses; when most are hits, it only
+   * adds the cost of testing it.
+   *
+   * @note It's ignored for #HT_ENGINE_MAPPED.
+   */
+  bool          filter;
+
+  /**
+   * The allocator to use for buckets (or slots) and entries or NULL to use
+   * malloc(3).  It must remain valid until the table is cleaned up.
+   *
+   * @warning The allocator must be thread-safe if it's used either with
+   * ht_build() (that allocates from multiple threads) or by several tables
+   * used concurrently, e.g., the shards of an \ref ht_sharded.
+   */
+  ht_allocator_t const *allocator;
 };
 
+/**
+ * Statistics of a hash table filled in by ht_get_stats().
+ */
+struct ht_stats {
+  ht_counters_t counters;               ///< All 0 unless `HT_STATS`.
+
+  /**
+   * Element _i_ is the number of buckets having _i_ entries or, for
+   * #HT_ENGINE_OPEN, the number of entries found by _i_ + 1 probes.  The last
+   * element also counts all greater.
+   */
+  size_t        chain_hist[ HT_STATS_CHAIN_N ];
+
+  size_t        chain_max;              ///< Longest chain (or most probes).
+  size_t        n_buckets;              ///< Number of buckets (or slots).
+  size_t        bucket_bytes;           ///< Bytes of buckets (or slots).
+  size_t        entry_bytes;            ///< Bytes allocated for entries.
+  size_t        data_bytes;             ///< Bytes of entries' data.
+  size_t        filter_bytes;           ///< Bytes of filter or 0.
+
+  /**
+   * The expected false-positive rate of the \ref ht_options::filter
+   * "filter" for data that isn't present, computed from how full each of its
+   * blocks is; or 0 if none.
+   *
+   * @sa ht_counters::n_filter_fps
+   */
+  double        filter_fpr;
+};
+
+////////// extern variables ///////////////////////////////////////////////////
+
+/**
+ * An allocator that maps each allocation of at least 2 MiB with mmap(2),
+ * aligned to 2 MiB, and asks for transparent huge pages by madvise(2)
+ * `MADV_HUGEPAGE`.  It also faults in all the pages up front, so a table
+ * that grows pays for faulting its new buckets once rather than on each
+ * first touch.  Smaller allocations use malloc(3).
+ *
+ * Multi-gigabyte bucket arrays on 2 MiB pages rather than 4 KiB pages need
+ * 512 times fewer TLB entries, so random lookups miss the TLB much less.
+ *
+ * @note Huge pages are used only if the kernel has transparent huge pages
+ * enabled in either `always` or `madvise` mode.
+ */
+extern ht_allocator_t const ht_allocator_huge;
+
 ////////// extern functions ///////////////////////////////////////////////////
 
+/**
+ * Reduces \a hash to a bucket index.
+ *
+ * @param hash The hash value.
+ * @param n_buckets The number of buckets.
+ * @param shift For #HT_SIZING_POW2, 64 minus the base-2 logarithm of \a
+ * n_buckets; for #HT_SIZING_PRIME, 0.
+ * @return Returns a bucket index in the range [0, \a n_buckets).
+ *
+ * @sa ht_bucket()
+ */
+inline size_t ht_bucket_idx( ht_hash_val_t hash, size_t n_buckets,
+                             unsigned shift ) {
+  return shift != 0 ?
+    (size_t)((hash * HT_FIBONACCI) >> shift) :
+    (size_t)(hash % n_buckets);
+}
+
+/**
+ * Gets the head of the bucket of a #HT_ENGINE_CHAINED hash table for \a hash.
+ * The head itself is a sentinel: the bucket's first entry, if any, is the
+ * head's \ref ht_entry::next "next".
+ *
+ * @remarks This is a low-level function that allows a caller that already
+ * has a hash value to walk a chain using its own comparison (that can be
+ * inlined) rather than the table's \ref hash_table::cmp_fn "cmp_fn".  When
+ * doing so, an entry's \ref ht_entry::hash "hash" should be compared to the
+ * hash value before comparing data.
+ *
+ * @remarks While a table is being incrementally resized, entries whose old
+ * bucket has not yet been migrated are still in (and new entries are added
+ * to) the old bucket so that every hash maps to exactly one chain.
+ *
+ * @param table The #HT_ENGINE_CHAINED hash table.
+ * @param hash The hash value.
+ * @return Returns said head.
+ *
+ * @sa ht_insert_new()
+ */
+inline ht_entry_t* ht_bucket( hash_table_t const *table, ht_hash_val_t hash ) {
+  if ( table->old_buckets != NULL ) {
+    size_t const b =
+      ht_bucket_idx( hash, table->old_n_buckets, table->old_shift );
+    if ( b >= table->migrate_idx )
+      return &table->old_buckets[b];
+  }
+  return &table->buckets[
+    ht_bucket_idx( hash, table->n_buckets, table->shift )
+  ];
+}
+
+/**
+ * Builds a #HT_ENGINE_CHAINED hash table from an array of fixed-size records
+ * in parallel.  It's equivalent to calling ht_insert() on each record in
+ * order (and copying the record into the entry if inserted), but:
+ *
+ *  + The table is resized once, up front, for all the records.
+ *  + Records are hashed by all threads.
+ *  + Records are partitioned by ranges of buckets, then each thread links
+ *    whole partitions into their buckets without locking since no two
+ *    threads touch the same bucket.
+ *  + Entries are carved from a single slab rather than allocated one at a
+ *    time.
+ *
+ * @param table The hash table to build.  It may already have entries.  If
+ * it's not #HT_ENGINE_CHAINED, the records are inserted one at a time.
+ * @param records A pointer to the first record.
+ * @param record_size The size of each record.
+ * @param n The number of records.
+ * @param n_threads The number of threads to use or 0 for one per online CPU.
+ * @return Returns the number of records inserted.  As with ht_insert(), if
+ * several records are equal (or equal an existing entry), only the first is
+ * inserted.
+ *
+ * @warning The table's \ref hash_table::hash_fn "hash_fn" and \ref
+ * hash_table::cmp_fn "cmp_fn" are called concurrently, so they must be
+ * thread-safe.
+ */
+size_t ht_build( hash_table_t *table, void const *records, size_t record_size,
+                 size_t n, unsigned n_threads );
+
 /**
  * Cleans-up a hash table.
  *
@@ -166,14 +626,49 @@ struct ht_iterator {
  */
 void ht_cleanup( hash_table_t *table, ht_free_fn_t free_fn );
 
+/**
+ * Deletes all entries from a hash table, but keeps its buckets (or slots) and
+ * entry memory so that refilling it allocates nothing until it exceeds its
+ * previous size.
+ *
+ * @param table The hash table to clear.
+ * @param free_fn A pointer to a function used to free data associated with
+ * each entry or NULL if unnecessary.
+ *
+ * @sa ht_cleanup()
+ * @sa ht_shrink_to_fit()
+ */
+void ht_clear( hash_table_t *table, ht_free_fn_t free_fn );
+
 /**
  * Deletes an entry from a hash table.
  *
  * @param table The hash table to delete from.
  * @param entry The entry to delete.
+ *
+ * @warning If the table has a \ref ht_options::min_lf "min_lf", this may
+ * shrink the table, invalidating any iterators.
  */
 void ht_delete( hash_table_t *table, ht_entry_t *entry );
 
+/**
+ * Deletes the entry having data equal to \a data, if any, from a hash table
+ * given its hash value.
+ *
+ * @remarks This is the same as ht_find_hash() followed by ht_delete().
+ *
+ * @param table The hash table to delete from.
+ * @param data The data to delete.
+ * @param hash The hash value of \a data.
+ * @param free_fn A pointer to a function used to free data associated with
+ * the entry or NULL if unnecessary.
+ * @return Returns `true` only if an entry was deleted.
+ *
+ * @warning The same as for ht_delete() applies.
+ */
+bool ht_delete_hash( hash_table_t *table, void const *data,
+                     ht_hash_val_t hash, ht_free_fn_t free_fn );
+
 /**
  * Gets whether a hash table is empty.
  *
@@ -195,7 +690,119 @@ inline bool ht_empty( hash_table_t const *table ) {
 ht_entry_t* ht_find( hash_table_t const *table, void const *data );
 
 /**
- * Initializes a hash table.
+ * Attempts to find each of \a data within a hash table.
+ *
+ * @remarks This is the same as calling ht_find() for each of \a data, but
+ * faster for large tables: keys are hashed and their buckets prefetched a
+ * block at a time, then the blocks' chains are walked in an interleaved
+ * fashion so that cache misses for different keys overlap rather than occur
+ * one after another.
+ *
+ * @param table The hash table to search.
+ * @param data The data to search for.
+ * @param n The number of \a data.
+ * @param found Set to a pointer to the entry containing each of \a data or
+ * NULL if not found.
+ * @return Returns the number of \a data found.
+ *
+ * @sa ht_insert_batch()
+ */
+size_t ht_find_batch( hash_table_t const *table, void const *const data[],
+                      size_t n, ht_entry_t *found[] );
+
+/**
+ * Attempts to find \a data within a hash table given its hash value.
+ *
+ * @remarks This is the same as ht_find() except that it uses \a hash rather
+ * than calling the table's \ref hash_table::hash_fn "hash_fn", so a caller
+ * that already has the hash value (e.g., to select a shard) doesn't hash
+ * twice.
+ *
+ * @param table The hash table to search.
+ * @param data The data to search for.
+ * @param hash The hash value of \a data.
+ * @return Returns a pointer to the entry containing \a data or NULL if not
+ * found.
+ *
+ * @sa ht_delete_hash()
+ * @sa ht_find_key()
+ * @sa ht_insert_hash()
+ */
+ht_entry_t* ht_find_hash( hash_table_t const *table, void const *data,
+                          ht_hash_val_t hash );
+
+/**
+ * Attempts to find an entry within a hash table by a key of a different type
+ * than its entries' data, e.g., a span of bytes for entries of NUL-terminated
+ * strings, without having to make a temporary of the same type.
+ *
+ * @param table The hash table to search.
+ * @param key The key to search for.
+ * @param hash The hash value of \a key.  It must be equal to what the table's
+ * \ref hash_table::hash_fn "hash_fn" returns for data equal to \a key.
+ * @param key_cmp_fn The function to compare \a key (as its first argument)
+ * with an entry's data (as its second).  It need return only 0 or non-zero.
+ * @return Returns a pointer to the entry containing data equal to \a key or
+ * NULL if not found.
+ *
+ * @sa ht_cmp_span_str()
+ * @sa ht_find_hash()
+ */
+ht_entry_t* ht_find_key( hash_table_t const *table, void const *key,
+                         ht_hash_val_t hash, ht_cmp_fn_t key_cmp_fn );
+
+/**
+ * Finds the entry having data equal to \a data within a hash table, or
+ * inserts a new entry containing a copy of \a data if there is none, given
+ * its hash value.
+ *
+ * @remarks Unless the table needs to grow, the table is probed only once: a
+ * new entry is put where the search for an equal one ended.  (The same is
+ * true of ht_insert() and ht_insert_hash().)
+ *
+ * @param table The hash table.
+ * @param data The data to find or insert.
+ * @param data_size The size of \a data.
+ * @param hash The hash value of \a data.
+ * @return Returns the same as ht_insert().
+ *
+ * @note Unlike ht_insert(), if \ref ht_insert_rv::inserted "inserted" is
+ * `true`, \a data _is_ copied into the new entry's \ref ht_entry::data
+ * "data".
+ *
+ * @sa ht_insert_hash()
+ */
+ht_insert_rv_t ht_find_or_insert( hash_table_t *table, void const *data,
+                                  size_t data_size, ht_hash_val_t hash );
+
+/**
+ * Calls a function for every entry of a hash table using several threads.
+ * The table's buckets (or slots) are divided into several ranges per thread
+ * that threads take one at a time, so threads that finish early take more.
+ *
+ * @param table The hash table.  It must not be modified until this returns.
+ * @param visit_fn The function to call for every entry.  It's called
+ * concurrently for different entries, so it must be thread-safe.
+ * @param arg The argument to pass to \a visit_fn.
+ * @param n_threads The number of threads to use or 0 for one per online CPU.
+ * Small tables use fewer.  The calling thread is one of them.
+ *
+ * @sa ht_iterator_init_range()
+ */
+void ht_for_each_parallel( hash_table_t *table, ht_visit_fn_t visit_fn,
+                           void *arg, unsigned n_threads );
+
+/**
+ * Gets the statistics of a hash table.  Other than its \ref ht_stats::counters
+ * "counters", they're computed by examining every bucket and entry.
+ *
+ * @param table The hash table.
+ * @param stats The statistics to fill in.
+ */
+void ht_get_stats( hash_table_t const *table, ht_stats_t *stats );
+
+/**
+ * Initializes a hash table using #HT_DEFAULT_ENGINE.
  *
  * @param table The hash table to initialize.
  * @param max_lf The maximum load factor.
@@ -203,10 +810,27 @@ ht_entry_t* ht_find( hash_table_t const *table, void const *data );
  * @param cmp_fn The comparison function to use.
  * @param hash_fn The hash function to use.
  * @sa ht_cleanup()
+ * @sa ht_init_opt()
  */
-void ht_init( hash_table_t *table, double max_lf, unsigned est_size,
+void ht_init( hash_table_t *table, double max_lf, size_t est_size,
               ht_cmp_fn_t cmp_fn, ht_hash_fn_t hash_fn );
 
+/**
+ * Initializes a hash table.
+ *
+ * @param table The hash table to initialize.
+ * @param max_lf The maximum load factor.
+ * @param est_size The estimated number of entries.
+ * @param cmp_fn The comparison function to use.
+ * @param hash_fn The hash function to use.
+ * @param opt The options to use.
+ * @sa ht_cleanup()
+ * @sa ht_init()
+ */
+void ht_init_opt( hash_table_t *table, double max_lf, size_t est_size,
+                  ht_cmp_fn_t cmp_fn, ht_hash_fn_t hash_fn,
+                  ht_options_t const *opt );
+
 /**
  * Attempts to insert \a data into \a table.
  *
@@ -224,6 +848,66 @@ void ht_init( hash_table_t *table, double max_lf, unsigned est_size,
  */
 ht_insert_rv_t ht_insert( hash_table_t *table, void *data, size_t data_size );
 
+/**
+ * Attempts to insert each of \a data into \a table.
+ *
+ * @remarks This is the same as calling ht_insert() for each of \a data, but
+ * faster for large tables in the same way ht_find_batch() is.
+ *
+ * @param table The hash table to insert into.
+ * @param data The data to insert.
+ * @param data_size The size of each of \a data.
+ * @param n The number of \a data.
+ * @param rv Set to the same as ht_insert() would return for each of \a data.
+ * @return Returns the number of \a data inserted.
+ *
+ * @note Unlike ht_insert(), each of \a data _is_ copied into \ref
+ * ht_entry::data "data" of its inserted entry since equal data later in the
+ * same batch must be found.
+ *
+ * @sa ht_find_batch()
+ */
+size_t ht_insert_batch( hash_table_t *table, void const *const data[],
+                        size_t data_size, size_t n, ht_insert_rv_t rv[] );
+
+/**
+ * Attempts to insert \a data into \a table given its hash value.
+ *
+ * @remarks This is the same as ht_insert() except that it uses \a hash rather
+ * than calling the table's \ref hash_table::hash_fn "hash_fn".
+ *
+ * @param table The hash table to insert into.
+ * @param data The data to insert.
+ * @param data_size The size of \a data.
+ * @param hash The hash value of \a data.
+ * @return Returns the same as ht_insert().
+ *
+ * @sa ht_delete_hash()
+ * @sa ht_find_hash()
+ * @sa ht_find_or_insert()
+ */
+ht_insert_rv_t ht_insert_hash( hash_table_t *table, void const *data,
+                               size_t data_size, ht_hash_val_t hash );
+
+/**
+ * Inserts a new entry into \a table _without_ checking whether an entry
+ * having equal data already exists.
+ *
+ * @remarks This is a low-level function for a caller that has already
+ * determined (e.g., via ht_bucket()) that no equal entry exists.
+ *
+ * @param table The hash table to insert into.
+ * @param hash The hash value of the data that will be copied into the new
+ * entry's \ref ht_entry::data "data".
+ * @param data_size The size of the data.
+ * @return Returns a pointer to the new entry.
+ *
+ * @note As with ht_insert(), the data is _not_ copied into \ref
+ * ht_entry::data "data" --- that needs to be done by the caller.
+ */
+ht_entry_t* ht_insert_new( hash_table_t *table, ht_hash_val_t hash,
+                           size_t data_size );
+
 /**
  * Initializes a hash table iterator.
  *
@@ -234,18 +918,117 @@ ht_insert_rv_t ht_insert( hash_table_t *table, void *data, size_t data_size );
  */
 void ht_iterator_init( ht_iterator_t *it, hash_table_t *table );
 
+/**
+ * Initializes a hash table iterator over only one of \a n_parts disjoint
+ * ranges of its buckets (or slots) so that several threads can iterate over
+ * a table at once, each over its own part.  Together, the parts iterate over
+ * every entry exactly once.
+ *
+ * @param it The hash table iterator to initialize.
+ * @param table The hash table to iterate over.  It must not be modified while
+ * any iterator over part of it is in use.
+ * @param part The part to iterate over in [0, \a n_parts).
+ * @param n_parts The number of parts.
+ *
+ * @sa ht_for_each_parallel()
+ * @sa ht_iterator_next()
+ */
+void ht_iterator_init_range( ht_iterator_t *it, hash_table_t *table,
+                             unsigned part, unsigned n_parts );
+
 /**
  * Gets the nexy hash table entry, if any.
  *
- * @remarks The order entries are returned is in bucket order that is seemingly
- * arbitrary.
+ * @remarks The order entries are returned is in bucket (or slot) order that is
+ * seemingly arbitrary except for #HT_ENGINE_DENSE where it's insertion order.
+ *
+ * @remarks For #HT_ENGINE_CHAINED, empty buckets are skipped a word of \ref
+ * hash_table::occupied "occupied" bits at a time rather than one at a time.
  *
  * @param it The hash table iterator.
  * @return Returns a pointer to the next entry or NULL if none.
  */
 ht_entry_t* ht_iterator_next( ht_iterator_t *it );
 
+/**
+ * Initializes a read-only #HT_ENGINE_MAPPED hash table by memory-mapping a
+ * file written by ht_save().  Nothing is read or deserialized: pages of the
+ * file are read only when lookups touch them.
+ *
+ * @param table The hash table to initialize.
+ * @param path The path of the file.
+ * @param cmp_fn The comparison function to use.
+ * @param hash_fn The hash function to use.  It must be the same one the saved
+ * table used.
+ * @return Returns `true` only if successful; otherwise sets `errno`
+ * (`EINVAL` if the file isn't a compatible hash table file).
+ *
+ * @note Only the file's header is checked here.  Since checking every entry
+ * would read the whole file, every offset in it is instead checked when it's
+ * followed: an entry that isn't wholly within the file ends its bucket's
+ * chain (or iteration).  Entries' data are not checked, so \a cmp_fn must not
+ * read more than an entry's \ref ht_entry::data_size "data_size" bytes if
+ * the file might be corrupt.
+ *
+ * @sa ht_cleanup()
+ * @sa ht_save()
+ */
+bool ht_open_mapped( hash_table_t *table, char const *path,
+                     ht_cmp_fn_t cmp_fn, ht_hash_fn_t hash_fn );
+
+/**
+ * Ensures a hash table can hold at least \a n entries without growing by
+ * resizing it at most once now.
+ *
+ * @param table The hash table.
+ * @param n The number of entries.
+ *
+ * @note For an incremental table, this resizes all at once.
+ *
+ * @sa ht_shrink_to_fit()
+ */
+void ht_reserve( hash_table_t *table, size_t n );
+
+/**
+ * Saves a hash table to a file that can later be opened by ht_open_mapped().
+ *
+ * @remarks The file has a header, an array of bucket offsets, then all
+ * entries laid out exactly as \ref ht_entry "ht_entry" objects except that
+ * each \ref ht_entry::next "next" is the file offset of the next entry in the
+ * same bucket (or 0) rather than a pointer.  Each bucket's entries are
+ * contiguous so a lookup typically touches only one page of entries.
+ *
+ * @param table The hash table to save.
+ * @param path The path of the file to create or overwrite.
+ * @return Returns `true` only if successful; otherwise sets `errno`.
+ *
+ * @warning Entries' data are copied byte-for-byte, so they must not contain
+ * pointers.  The file can only be opened on a machine with the same
+ * endianness and \ref ht_entry "ht_entry" layout.
+ */
+bool ht_save( hash_table_t *table, char const *path );
+
+/**
+ * Shrinks a hash table's buckets (or slots) to the fewest that hold its
+ * entries and frees entry memory kept by ht_clear().  If the table is empty,
+ * all entry memory is freed.
+ *
+ * @param table The hash table to shrink.
+ *
+ * @note Entry memory in use by even a single entry can't be freed.
+ * @note Memory is freed to the table's allocator (or by free(3)) that may
+ * keep it in the process rather than return it to the operating system.  With
+ * glibc, the caller can call malloc_trim(3) afterwards if that matters.
+ *
+ * @sa ht_reserve()
+ */
+void ht_shrink_to_fit( hash_table_t *table );
+
 ///////////////////////////////////////////////////////////////////////////////
 
+#ifdef __cplusplus
+} // extern "C"
+#endif /* __cplusplus */
+
 #endif /* pjl_hash_table_H */
 /* vim:set et sw=2 ts=2: */
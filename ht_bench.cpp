@@ -0,0 +1,2150 @@
+/*
+**      ht_bench -- hash_table benchmarks
+**      ht_bench.cpp
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// local
+#include "hash_map.h"
+#include "hash_table.h"
+#include "ht_compact.h"
+#include "ht_frozen.h"
+#include "ht_hash.h"
+#include "ht_intern.h"
+#include "ht_lru.h"
+#include "ht_mt.h"
+#include "ht_sharded.h"
+
+// standard
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fstream>
+#include <libgen.h>                     /* for basename(3) */
+#include <sys/resource.h>               /* for getrusage(2) */
+#include <sysexits.h>
+#include <unistd.h>                     /* for getopt(3) */
+
+#ifdef __GLIBC__
+#include <malloc.h>                     /* for malloc_trim(3) */
+#endif /* __GLIBC__ */
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>                /* for SYS_perf_event_open */
+#endif /* __linux__ */
+
+using namespace std;
+
+////////// local constants ////////////////////////////////////////////////////
+
+static size_t const MIN_OPS = 10000000; // minimum operations to time
+static size_t const SUITE_BATCH_N = 16;  // operations per latency sample
+static size_t const SUITE_OPS = 1000000; // minimum suite operations to time
+
+////////// local variables ////////////////////////////////////////////////////
+
+static char const  *me;                 // executable name
+static size_t       opt_n = 1000000;    // number of entries
+static unsigned     opt_threads;        // maximum number of threads
+
+////////// local functions ////////////////////////////////////////////////////
+
+[[noreturn]] static void print_usage( int status ) {
+  (status == EX_OK ? cout : cerr )
+    << "usage: " << me << " [-n entries] [-t threads] workload...\n"
+       "workloads:\n"
+       "  batch     ht_find_batch()/ht_insert_batch() vs. scalar loops\n"
+       "  build     ht_build() from 1 to -t threads vs. an ht_insert() loop\n"
+       "  compact   ht_compact layouts vs. hash_table: bytes/entry and ns/op\n"
+       "  filter    ht_options::filter on and off when most finds are misses\n"
+       "  freeze    ht_freeze() vs. the live table: index bits/key and ns/op\n"
+       "  hash      ht_hash.h quality (avalanche, buckets) and throughput\n"
+       "  intern    ht_intern vs. a caller-written table of strings\n"
+       "  iterate   ht_iterator_next() vs. ht_for_each_parallel() full scans\n"
+       "  lru       ht_lru and ht_clock vs. a map + list LRU cache\n"
+       "  mt        ht_mt vs. mutex-guarded hash_table scaling\n"
+       "  merge     per-thread tables: serial vs. sharded parallel merge\n"
+       "  resize    incremental resizing: insert latency; delete in scan\n"
+       "  reuse     ht_clear() vs. re-init per round; ht_shrink_to_fit() RSS\n"
+       "  sizing    prime vs. power-of-2 bucket sizing\n"
+       "  small     many tiny tables: small vs. chained engine\n"
+       "  snapshot  rebuild vs. ht_open_mapped() of an ht_save() file\n"
+       "  stats     ht_get_stats() for good and poor hash functions\n"
+       "  suite     hash_table vs. hash_map vs. std::unordered_map\n"
+       "  tlb       random finds with buckets on 4 KiB vs. 2 MiB pages\n"
+       "  upsert    hashing long strings once vs. per call; ht_find_key()\n";
+  exit( status );
+}
+
+/**
+ * Gets the number of nanoseconds elapsed since \a start per \a n operations.
+ */
+static double ns_per_op( chrono::steady_clock::time_point start, size_t n ) {
+  chrono::duration<double,nano> const elapsed =
+    chrono::steady_clock::now() - start;
+  return elapsed.count() / (double)n;
+}
+
+/**
+ * Gets a vector of \a n distinct 64-bit keys in random order.
+ */
+static vector<uint64_t> shuffled_keys( uint64_t first, size_t n ) {
+  vector<uint64_t> keys( n );
+  for ( size_t i = 0; i < n; ++i )
+    keys[i] = first + i;
+  shuffle( keys.begin(), keys.end(), mt19937_64{ 42 } );
+  return keys;
+}
+
+/**
+ * Gets \a n distinct strings of \a min_len to \a max_len characters in random
+ * order, the first being string \a first.
+ */
+static vector<string> shuffled_strings( size_t first, size_t n,
+                                        size_t min_len, size_t max_len ) {
+  static char const ALNUM[] =
+    "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+  mt19937_64 rng{ first + 1 };
+  vector<string> strs( n );
+  for ( size_t i = 0; i < n; ++i ) {
+    // A unique prefix then random padding.
+    string &s = strs[i];
+    s = to_string( first + i ) + '-';
+    size_t const len = min_len + rng() % (max_len - min_len + 1);
+    while ( s.size() < len )
+      s += ALNUM[ rng() % (sizeof ALNUM - 1) ];
+  } // for
+  shuffle( strs.begin(), strs.end(), rng );
+  return strs;
+}
+
+static uint64_t key_of( void const *data ) {
+  uint64_t k;
+  memcpy( &k, data, sizeof k );
+  return k;
+}
+
+// A byte-at-a-time hash typical of hand-written ones: 64-bit FNV-1a.
+static ht_hash_val_t hash_fnv1a( void const *p, size_t n ) {
+  uint8_t const *const b = static_cast<uint8_t const*>( p );
+  uint64_t h = 0xCBF29CE484222325ull;
+  for ( size_t i = 0; i < n; ++i )
+    h = (h ^ b[i]) * 0x100000001B3ull;
+  return h;
+}
+
+// A poor hash: the key itself.
+static ht_hash_val_t hash_identity( void const *data ) {
+  return key_of( data );
+}
+
+// A poor hash: the key times 4096, i.e., the low 12 bits are always 0.
+static ht_hash_val_t hash_strided( void const *data ) {
+  return key_of( data ) << 12;
+}
+
+/**
+ * Gets the resident set size of this process in MiB.
+ */
+static double rss_mib() {
+  size_t pages = 0, resident = 0;
+  ifstream{ "/proc/self/statm" } >> pages >> resident;
+  return (double)resident * (double)sysconf( _SC_PAGESIZE ) / (1 << 20);
+}
+
+/**
+ * Inserts \a keys into \a table.
+ */
+static void insert_keys( hash_table_t *table, vector<uint64_t> const &keys ) {
+  for ( uint64_t k : keys ) {
+    ht_insert_rv_t const rv = ht_insert( table, &k, sizeof k );
+    if ( rv.inserted )
+      memcpy( HT_DINT( rv.entry ), &k, sizeof k );
+  } // for
+}
+
+/**
+ * Gets the number of passes over \a n keys to make so that small tables are
+ * measured over enough operations.
+ */
+static size_t n_passes( size_t n ) {
+  return n < MIN_OPS ? MIN_OPS / n : 1;
+}
+
+/**
+ * Looks up \a keys in \a table.
+ *
+ * @return Returns the number of keys found per pass.
+ */
+static size_t find_keys( hash_table_t const *table,
+                         vector<uint64_t> const &keys ) {
+  size_t found = 0;
+  for ( size_t pass = n_passes( keys.size() ); pass > 0; --pass ) {
+    found = 0;
+    for ( uint64_t const &k : keys )
+      found += ht_find( table, &k ) != nullptr;
+  } // for
+  return found;
+}
+
+/**
+ * A hash_table guarded by a single mutex: what ht_mt replaces.
+ */
+struct locked_table {
+  hash_table_t  table;
+  mutex         lock;
+};
+
+/**
+ * Performs one operation on \a t.
+ *
+ * @param op The operation: 0 = find, 1 = insert, 2 = delete.
+ * @return Returns `true` only if the operation found, inserted, or deleted.
+ */
+static bool locked_op( locked_table *t, unsigned op, uint64_t k ) {
+  lock_guard<mutex> const guard{ t->lock };
+  switch ( op ) {
+    case 0:
+      return ht_find( &t->table, &k ) != nullptr;
+    case 1: {
+      ht_insert_rv_t const rv = ht_insert( &t->table, &k, sizeof k );
+      if ( rv.inserted )
+        memcpy( HT_DINT( rv.entry ), &k, sizeof k );
+      return rv.inserted;
+    }
+    default: {
+      ht_entry_t *const entry = ht_find( &t->table, &k );
+      if ( entry != nullptr )
+        ht_delete( &t->table, entry );
+      return entry != nullptr;
+    }
+  } // switch
+}
+
+/**
+ * Performs one operation on \a t.
+ *
+ * @param op The operation: 0 = find, 1 = insert, 2 = delete.
+ * @return Returns `true` only if the operation found, inserted, or deleted.
+ */
+static bool mt_op( ht_mt_t *t, unsigned op, uint64_t k ) {
+  switch ( op ) {
+    case 0: {
+      ht_mt_read_begin( t );
+      bool const found = ht_mt_find( t, &k ) != nullptr;
+      ht_mt_read_end( t );
+      return found;
+    }
+    case 1:
+      return ht_mt_insert( t, &k, sizeof k );
+    default:
+      return ht_mt_delete( t, &k );
+  } // switch
+}
+
+/**
+ * Runs \a n_threads threads each performing \a n_ops random operations on
+ * keys in [0, 2 * #opt_n) of which \a write_pct percent are writes (half
+ * inserts, half deletes) and the rest finds.
+ *
+ * @return Returns the throughput in millions of operations per second.
+ */
+template<typename Table,typename OpFn>
+static double run_mt( Table *t, OpFn op_fn, unsigned n_threads, size_t n_ops,
+                      unsigned write_pct ) {
+  vector<thread> threads;
+  auto const start = chrono::steady_clock::now();
+  for ( unsigned i = 0; i < n_threads; ++i ) {
+    threads.emplace_back( [=]() {
+      mt19937_64 rng{ i + 1 };
+      size_t hits = 0;
+      for ( size_t j = 0; j < n_ops; ++j ) {
+        uint64_t const r = rng();
+        unsigned const pct = (r >> 32) % 100;
+        unsigned const op = pct >= write_pct ? 0 : 1 + (pct & 1);
+        hits += op_fn( t, op, (r & 0xFFFFFFFF) % (2 * opt_n) );
+      } // for
+      // Keep the loop from being optimized away.
+      asm volatile( "" : : "r"(hits) );
+    } );
+  } // for
+  for ( thread &t : threads )
+    t.join();
+  return (double)n_threads * n_ops / ns_per_op( start, 1 ) * 1e3;
+}
+
+////////// workloads //////////////////////////////////////////////////////////
+
+/**
+ * Compares ht_find_batch() and ht_insert_batch() with scalar ht_find() and
+ * ht_insert() loops.  The benefit shows only when the table is much larger
+ * than the last-level cache, e.g., `-n 20000000`.
+ */
+static void bench_batch() {
+  struct { char const *name; ht_engine_t engine; } const ENGINES[] = {
+    { "chained", HT_ENGINE_CHAINED },
+    { "open",    HT_ENGINE_OPEN    },
+  };
+
+  vector<uint64_t> const keys = shuffled_keys( 0, opt_n );
+  // Probe keys: half hits, half misses, in random order.
+  vector<uint64_t> const probes = shuffled_keys( opt_n / 2, opt_n );
+  vector<void const*> key_ptrs( opt_n ), probe_ptrs( opt_n );
+  for ( size_t i = 0; i < opt_n; ++i ) {
+    key_ptrs[i] = &keys[i];
+    probe_ptrs[i] = &probes[i];
+  } // for
+  vector<ht_entry_t*> found( opt_n );
+  vector<ht_insert_rv_t> rv( opt_n );
+
+  cout << "batch: " << opt_n << " entries, ns/op\n"
+       << left << setw(8) << "engine" << right << setw(10) << "insert"
+       << setw(10) << "insert_b" << setw(10) << "find"
+       << setw(10) << "find_b" << '\n' << fixed << setprecision(1);
+
+  for ( auto const &e : ENGINES ) {
+    ht_options_t opt{};
+    opt.engine = e.engine;
+    opt.sizing = HT_SIZING_PRIME;
+    hash_table_t table;
+
+    ht_init_opt( &table, 1.0, 0, &ht_cmp_u64, &ht_hash_u64, &opt );
+    auto start = chrono::steady_clock::now();
+    insert_keys( &table, keys );
+    double const insert_ns = ns_per_op( start, opt_n );
+
+    start = chrono::steady_clock::now();
+    size_t n_found = 0;
+    for ( void const *probe : probe_ptrs )
+      n_found += ht_find( &table, probe ) != nullptr;
+    double const find_ns = ns_per_op( start, opt_n );
+    ht_cleanup( &table, nullptr );
+
+    ht_init_opt( &table, 1.0, 0, &ht_cmp_u64, &ht_hash_u64, &opt );
+    start = chrono::steady_clock::now();
+    ht_insert_batch(
+      &table, key_ptrs.data(), sizeof(uint64_t), opt_n, rv.data()
+    );
+    double const insert_b_ns = ns_per_op( start, opt_n );
+
+    start = chrono::steady_clock::now();
+    size_t const n_found_b =
+      ht_find_batch( &table, probe_ptrs.data(), opt_n, found.data() );
+    double const find_b_ns = ns_per_op( start, opt_n );
+
+    if ( n_found != n_found_b || table.size != opt_n ) {
+      cerr << me << ": batch: wrong results\n";
+      exit( EX_SOFTWARE );
+    }
+    cout << left << setw(8) << e.name << right << setw(10) << insert_ns
+         << setw(10) << insert_b_ns << setw(10) << find_ns
+         << setw(10) << find_b_ns << '\n';
+    ht_cleanup( &table, nullptr );
+  } // for
+}
+
+/**
+ * Compares building a table from #opt_n 16-byte records by ht_build() with 1
+ * to #opt_threads threads with an ht_insert() loop.
+ */
+static void bench_build() {
+  struct record { uint64_t key, value; };
+  vector<uint64_t> const keys = shuffled_keys( 0, opt_n );
+  vector<record> records( opt_n );
+  for ( size_t i = 0; i < opt_n; ++i )
+    records[i] = { keys[i], i };
+
+  cout << "build: " << opt_n << " records\n"
+       << left << setw(12) << "method" << right << setw(10) << "ms"
+       << setw(10) << "Mrec/s" << '\n' << fixed << setprecision(1);
+
+  auto const report = [&]( string const &method, hash_table_t *table,
+                           double ms ) {
+    if ( table->size != opt_n ) {
+      cerr << me << ": build: wrong size\n";
+      exit( EX_SOFTWARE );
+    }
+    cout << left << setw(12) << method << right << setw(10) << ms
+         << setw(10) << opt_n / ms / 1e3 << '\n';
+    ht_cleanup( table, nullptr );
+  };
+
+  hash_table_t table;
+  ht_init( &table, 1.0, 0, &ht_cmp_u64, &ht_hash_u64 );
+  auto start = chrono::steady_clock::now();
+  for ( record const &r : records ) {
+    ht_insert_rv_t const rv = ht_insert( &table, (void*)&r, sizeof r );
+    if ( rv.inserted )
+      memcpy( rv.entry->data, &r, sizeof r );
+  } // for
+  report( "ht_insert", &table, ns_per_op( start, 1000000 ) );
+
+  for ( unsigned t = 1; t <= opt_threads; t *= 2 ) {
+    ht_init( &table, 1.0, 0, &ht_cmp_u64, &ht_hash_u64 );
+    start = chrono::steady_clock::now();
+    ht_build( &table, records.data(), sizeof(record), opt_n, t );
+    report( "ht_build/" + to_string( t ), &table, ns_per_op( start, 1000000 ) );
+  } // for
+}
+
+/**
+ * Compares the memory per entry (by RSS) and the insert, hit, and delete time
+ * of #opt_n 8-byte keys in a hash_table with those in an ht_compact with
+ * various layouts.
+ */
+static void bench_compact() {
+  struct { char const *name; ht_compact_options_t opt; } const LAYOUTS[] = {
+    { "h32/max",  { 32, 0 } },
+    { "h32/8",    { 32, 8 } },
+    { "h0/8",     {  0, 8 } },
+    { "h0/4",     {  0, 4 } },
+  };
+  vector<uint64_t> const keys = shuffled_keys( 0, opt_n );
+
+  cout << "compact: " << opt_n << " 8-byte keys\n"
+       << left << setw(14) << "layout" << right << setw(10) << "B/entry"
+       << setw(10) << "insert" << setw(10) << "hit" << setw(10) << "delete"
+       << '\n' << fixed << setprecision(1);
+
+  auto const report = [&]( string const &name, double rss_before,
+                           double rss_after, double insert_ns, double hit_ns,
+                           double delete_ns ) {
+    cout << left << setw(14) << name << right << setw(10)
+         << (rss_after - rss_before) * (1 << 20) / (double)opt_n
+         << setw(10) << insert_ns << setw(10) << hit_ns
+         << setw(10) << delete_ns << '\n';
+  };
+
+  {
+#ifdef __GLIBC__
+    malloc_trim( 0 );
+#endif /* __GLIBC__ */
+    double const rss_before = rss_mib();
+    hash_table_t table;
+    ht_init( &table, 1.0, 0, &ht_cmp_u64, &ht_hash_u64 );
+    auto start = chrono::steady_clock::now();
+    insert_keys( &table, keys );
+    double const insert_ns = ns_per_op( start, opt_n );
+    double const rss_after = rss_mib();
+    start = chrono::steady_clock::now();
+    find_keys( &table, keys );
+    double const hit_ns = ns_per_op( start, keys.size() * n_passes( opt_n ) );
+    start = chrono::steady_clock::now();
+    for ( uint64_t const &k : keys )
+      ht_delete( &table, ht_find( &table, &k ) );
+    double const delete_ns = ns_per_op( start, opt_n );
+    ht_cleanup( &table, nullptr );
+    report( "hash_table", rss_before, rss_after, insert_ns, hit_ns,
+            delete_ns );
+  }
+
+  for ( auto const &layout : LAYOUTS ) {
+#ifdef __GLIBC__
+    malloc_trim( 0 );
+#endif /* __GLIBC__ */
+    double const rss_before = rss_mib();
+    ht_compact_t table;
+    ht_compact_init(
+      &table, 1.0, 0, sizeof(uint64_t), &ht_cmp_u64, &ht_hash_u64,
+      &layout.opt
+    );
+    auto start = chrono::steady_clock::now();
+    for ( uint64_t const &k : keys )
+      ht_compact_insert( &table, &k );
+    double const insert_ns = ns_per_op( start, opt_n );
+    double const rss_after = rss_mib();
+    size_t found = 0;
+    start = chrono::steady_clock::now();
+    for ( size_t pass = n_passes( opt_n ); pass > 0; --pass ) {
+      for ( uint64_t const &k : keys )
+        found += ht_compact_find( &table, &k ) != nullptr;
+    } // for
+    double const hit_ns = ns_per_op( start, keys.size() * n_passes( opt_n ) );
+    start = chrono::steady_clock::now();
+    for ( uint64_t const &k : keys )
+      found -= ht_compact_delete( &table, &k );
+    double const delete_ns = ns_per_op( start, opt_n );
+    if ( table.size != 0 || found != opt_n * (n_passes( opt_n ) - 1) ) {
+      cerr << me << ": compact: wrong size\n";
+      exit( EX_SOFTWARE );
+    }
+    ht_compact_cleanup( &table );
+    report( layout.name, rss_before, rss_after, insert_ns, hit_ns,
+            delete_ns );
+  } // for
+}
+
+/**
+ * Compares the hit and miss time of #opt_n 8-byte keys in hash tables with
+ * and without a \ref ht_options::filter "filter", and the time of a mix of
+ * 90% misses and 10% hits.
+ */
+static void bench_filter() {
+  struct { char const *name; ht_engine_t engine; bool filter; }
+  const OPTIONS[] = {
+    { "chained",    HT_ENGINE_CHAINED, false },
+    { "chained+f",  HT_ENGINE_CHAINED, true  },
+    { "open",       HT_ENGINE_OPEN,    false },
+    { "open+f",     HT_ENGINE_OPEN,    true  },
+  };
+  vector<uint64_t> const keys = shuffled_keys( 0, opt_n );
+  vector<uint64_t> const misses = shuffled_keys( opt_n, opt_n );
+  vector<uint64_t> mix;
+  for ( size_t i = 0; i < opt_n; ++i )
+    mix.push_back( i % 10 == 0 ? keys[i] : misses[i] );
+  size_t const passes = n_passes( opt_n );
+
+  cout << "filter: " << opt_n << " 8-byte keys\n"
+       << left << setw(11) << "table" << right << setw(8) << "hit"
+       << setw(8) << "miss" << setw(8) << "90%miss" << setw(10) << "filt MiB"
+       << setw(8) << "fpr %"
+#ifdef HT_STATS
+       << setw(8) << "meas %"
+#endif /* HT_STATS */
+       << '\n' << fixed << setprecision(1);
+
+  for ( auto const &o : OPTIONS ) {
+    hash_table_t table;
+    ht_options_t opt{};
+    opt.engine = o.engine;
+    opt.filter = o.filter;
+    ht_init_opt( &table, 1.0, 0, &ht_cmp_u64, &ht_hash_u64, &opt );
+    insert_keys( &table, keys );
+
+    auto const time_finds = [&]( vector<uint64_t> const &v ) {
+      auto const start = chrono::steady_clock::now();
+      size_t found = 0;
+      for ( size_t pass = passes; pass > 0; --pass ) {
+        for ( uint64_t const &k : v )
+          found += ht_find( &table, &k ) != nullptr;
+      } // for
+      double const ns = ns_per_op( start, v.size() * passes );
+      size_t const expected = &v == &keys ? opt_n :
+                              &v == &mix ? (opt_n + 9) / 10 : 0;
+      if ( found != expected * passes ) {
+        cerr << me << ": filter: wrong number found\n";
+        exit( EX_SOFTWARE );
+      }
+      return ns;
+    };
+    double const hit_ns = time_finds( keys );
+    double const miss_ns = time_finds( misses );
+    double const mix_ns = time_finds( mix );
+
+    ht_stats_t stats;
+    ht_get_stats( &table, &stats );
+    cout << left << setw(11) << o.name << right << setw(8) << hit_ns
+         << setw(8) << miss_ns << setw(8) << mix_ns
+         << setw(10) << stats.filter_bytes / (double)(1 << 20)
+         << setw(8) << setprecision(2) << 100 * stats.filter_fpr
+#ifdef HT_STATS
+         << setw(8) << 100.0 * stats.counters.n_filter_fps /
+            max( stats.counters.n_filter_fps + stats.counters.n_filter_negs,
+                 uint64_t{ 1 } )
+#endif /* HT_STATS */
+         << setprecision(1) << '\n';
+    ht_cleanup( &table, nullptr );
+  } // for
+}
+
+/**
+ * Compares the hit and miss time of #opt_n 8-byte keys in a hash_table with
+ * those in the ht_frozen made from it, and reports the time ht_freeze() takes
+ * and the size of its index.
+ */
+static void bench_freeze() {
+  vector<uint64_t> const keys = shuffled_keys( 0, opt_n );
+  vector<uint64_t> const misses = shuffled_keys( opt_n, opt_n );
+  size_t const passes = n_passes( opt_n );
+
+  hash_table_t table;
+  ht_init( &table, 1.0, 0, &ht_cmp_u64, &ht_hash_u64 );
+  insert_keys( &table, keys );
+
+  auto start = chrono::steady_clock::now();
+  ht_frozen_t frozen;
+  if ( !ht_freeze( &table, &frozen ) ) {
+    cerr << me << ": freeze: " << strerror( errno ) << '\n';
+    exit( EX_SOFTWARE );
+  }
+  chrono::duration<double,milli> const freeze_ms =
+    chrono::steady_clock::now() - start;
+
+  auto const time_finds = [&]( vector<uint64_t> const &v, auto find ) {
+    size_t found = 0;
+    auto const start = chrono::steady_clock::now();
+    for ( size_t pass = passes; pass > 0; --pass ) {
+      for ( uint64_t const &k : v )
+        found += find( &k );
+    } // for
+    double const ns = ns_per_op( start, v.size() * passes );
+    if ( found != (&v == &keys ? v.size() * passes : 0) ) {
+      cerr << me << ": freeze: wrong number found\n";
+      exit( EX_SOFTWARE );
+    }
+    return ns;
+  };
+  auto const table_find = [&]( uint64_t const *k ) {
+    return ht_find( &table, k ) != nullptr;
+  };
+  auto const frozen_find = [&]( uint64_t const *k ) {
+    return ht_frozen_find( &frozen, k ) != nullptr;
+  };
+
+  cout << "freeze: " << opt_n << " 8-byte keys: " << fixed << setprecision(1)
+       << freeze_ms.count() << " ms, index "
+       << setprecision(2) << 8.0 * ht_frozen_index_bytes( &frozen ) / opt_n
+       << " bits/key (" << frozen.pilot_bytes << "-byte pilots)\n"
+       << left << setw(12) << "table" << right << setw(10) << "hit"
+       << setw(10) << "miss" << '\n' << setprecision(1)
+       << left << setw(12) << "hash_table" << right
+       << setw(10) << time_finds( keys, table_find )
+       << setw(10) << time_finds( misses, table_find ) << '\n'
+       << left << setw(12) << "ht_frozen" << right
+       << setw(10) << time_finds( keys, frozen_find )
+       << setw(10) << time_finds( misses, frozen_find ) << '\n';
+
+  ht_frozen_cleanup( &frozen );
+  ht_cleanup( &table, nullptr );
+}
+
+/**
+ * Measures the quality of the ht_hash.h functions and the throughput of
+ * ht_hash_bytes() across key lengths, each compared with a poor hash:
+ *
+ *  + Avalanche: the worst bias over all (input bit, output bit) pairs of the
+ *    probability that flipping the input bit flips the output bit from the
+ *    ideal 0.5.  Random noise alone is about 0.03 (about 0.1 for 1-byte keys
+ *    since there are only 256 of them).
+ *  + Buckets: the chi-squared statistic per degree of freedom of 2^16
+ *    buckets indexed by the low and the high bits of hash values of
+ *    structured keys.  Ideal is about 1.0.
+ */
+static void bench_hash() {
+  typedef ht_hash_val_t (*bytes_fn_t)( void const*, size_t );
+  struct { char const *name; bytes_fn_t fn; } const BYTE_HASHES[] = {
+    { "ht_hash",  []( void const *p, size_t n ) {
+                    return ht_hash_bytes( p, n, 0 );
+                  } },
+    { "fnv1a",    &hash_fnv1a },
+  };
+  size_t const LENGTHS[] = { 4, 8, 16, 32, 64, 256, 1024, 4096 };
+
+  cout << "hash: avalanche worst bias\n"
+       << left << setw(10) << "hash" << right;
+  for ( size_t len : { 1, 4, 8, 16, 32, 100 } )
+    cout << setw(7) << len << 'B';
+  cout << '\n' << fixed << setprecision(3);
+
+  size_t const N_TRIALS = 4000;
+  mt19937_64 rng{ 42 };
+  for ( auto const &h : BYTE_HASHES ) {
+    cout << left << setw(10) << h.name << right;
+    for ( size_t len : { 1, 4, 8, 16, 32, 100 } ) {
+      vector<uint32_t> flips( len * 8 * 64 );
+      vector<uint8_t> key( len );
+      for ( size_t t = 0; t < N_TRIALS; ++t ) {
+        for ( uint8_t &b : key )
+          b = (uint8_t)rng();
+        uint64_t const h0 = (*h.fn)( key.data(), len );
+        for ( size_t i = 0; i < len * 8; ++i ) {
+          key[ i / 8 ] ^= (uint8_t)(1u << (i % 8));
+          uint64_t const diff = h0 ^ (*h.fn)( key.data(), len );
+          key[ i / 8 ] ^= (uint8_t)(1u << (i % 8));
+          for ( unsigned j = 0; j < 64; ++j )
+            flips[ i * 64 + j ] += (diff >> j) & 1;
+        } // for
+      } // for
+      double worst = 0;
+      for ( uint32_t f : flips )
+        worst = max( worst, abs( (double)f / N_TRIALS - 0.5 ) );
+      cout << setw(8) << worst;
+    } // for
+    cout << '\n';
+  } // for
+
+  size_t const N_KEYS = 1 << 20, LOG2_BUCKETS = 16;
+  auto const chi2 = [&]( auto hash_at ) {
+    double result[2];
+    for ( unsigned high = 0; high < 2; ++high ) {
+      vector<uint32_t> counts( size_t{ 1 } << LOG2_BUCKETS );
+      for ( size_t i = 0; i < N_KEYS; ++i ) {
+        uint64_t const hash = hash_at( i );
+        ++counts[ high ? hash >> (64 - LOG2_BUCKETS) :
+                         hash & (counts.size() - 1) ];
+      } // for
+      double const expected = (double)N_KEYS / counts.size();
+      double sum = 0;
+      for ( uint32_t c : counts )
+        sum += (c - expected) * (c - expected) / expected;
+      result[ high ] = sum / (counts.size() - 1);
+    } // for
+    cout << setw(12) << result[0] << setw(12) << result[1] << '\n';
+  };
+
+  cout << "buckets: " << N_KEYS << " keys, chi^2/df\n"
+       << left << setw(24) << "keys/hash" << right
+       << setw(12) << "low" << setw(12) << "high" << '\n';
+  cout << left << setw(24) << "i*4096/ht_hash_u64" << right;
+  chi2( []( uint64_t i ) { i <<= 12; return ht_hash_u64( &i ); } );
+  cout << left << setw(24) << "i*4096/identity" << right;
+  chi2( []( uint64_t i ) { i <<= 12; return hash_identity( &i ); } );
+
+  vector<string> strs( N_KEYS );
+  for ( size_t i = 0; i < N_KEYS; ++i )
+    strs[i] = "key-" + to_string( i );
+  cout << left << setw(24) << "\"key-i\"/ht_hash_str" << right;
+  chi2( [&]( size_t i ) { return ht_hash_str( strs[i].c_str() ); } );
+  cout << left << setw(24) << "\"key-i\"/fnv1a" << right;
+  chi2( [&]( size_t i ) {
+    return hash_fnv1a( strs[i].data(), strs[i].size() );
+  } );
+
+  cout << "throughput: ns/hash (GB/s)\n" << setw(6) << "bytes";
+  for ( auto const &h : BYTE_HASHES )
+    cout << setw(18) << h.name;
+  cout << '\n';
+
+  vector<uint8_t> buf( 1 << 16 );
+  for ( uint8_t &b : buf )
+    b = (uint8_t)rng();
+  for ( size_t len : LENGTHS ) {
+    cout << setw(6) << len;
+    for ( auto const &h : BYTE_HASHES ) {
+      // Hash at varying offsets so no two consecutive calls are the same.
+      size_t const n_hashes = max( MIN_OPS / 10, (size_t{ 1 } << 27) / len );
+      size_t const n_offsets = buf.size() - len;
+      uint64_t sink = 0;
+      auto const start = chrono::steady_clock::now();
+      for ( size_t i = 0, off = 0; i < n_hashes; ++i ) {
+        sink ^= (*h.fn)( buf.data() + off, len );
+        if ( (off += 72) >= n_offsets )
+          off -= n_offsets;
+      } // for
+      double const ns = ns_per_op( start, n_hashes );
+      asm volatile( "" : : "r"(sink) );
+      ostringstream oss;
+      oss << fixed << setprecision(1) << ns << " (" << len / ns << ')';
+      cout << setw(18) << oss.str();
+    } // for
+    cout << '\n';
+  } // for
+}
+
+/**
+ * Compares interning #opt_n strings, each one of #opt_n / 8 distinct strings,
+ * via:
+ *
+ *  + A hash_table of strings using ht_find() then ht_insert() and copying the
+ *    string into the new entry.
+ *  + A single-threaded and a concurrent ht_intern.
+ *
+ * then finding already interned strings with 1 to #opt_threads threads via a
+ * mutex-guarded single-threaded ht_intern versus a concurrent one.
+ */
+static void bench_intern() {
+  size_t const n_distinct = max( opt_n / 8, size_t{ 1 } );
+  vector<string> const distinct = shuffled_strings( 0, n_distinct, 8, 24 );
+  vector<char const*> tokens;
+  mt19937_64 rng{ 42 };
+  size_t token_bytes = 0;
+  for ( size_t i = 0; i < opt_n; ++i ) {
+    string const &s = distinct[ rng() % n_distinct ];
+    tokens.push_back( s.c_str() );
+    token_bytes += s.size() + 1;
+  } // for
+
+  cout << "intern: " << opt_n << " strings, " << n_distinct
+       << " distinct, ns/op\n" << fixed << setprecision(1);
+
+  hash_table_t table;
+  ht_init( &table, 1.0, 0, &ht_cmp_str, &ht_hash_str );
+  auto start = chrono::steady_clock::now();
+  for ( char const *s : tokens ) {
+    if ( ht_find( &table, s ) == nullptr ) {
+      size_t const size = strlen( s ) + 1;
+      ht_insert_rv_t const rv = ht_insert( &table, (void*)s, size );
+      memcpy( rv.entry->data, s, size );
+    }
+  } // for
+  cout << left << setw(11) << "caller" << right << setw(8)
+       << ns_per_op( start, tokens.size() ) << '\n';
+  ht_cleanup( &table, nullptr );
+
+  ht_intern_t *pools[2];
+  for ( bool concurrent : { false, true } ) {
+    ht_intern_t *const pool = pools[ concurrent ] =
+      ht_intern_new( 0, concurrent );
+    start = chrono::steady_clock::now();
+    for ( char const *s : tokens )
+      ht_intern_str( pool, s );
+    double const ns = ns_per_op( start, tokens.size() );
+    if ( ht_intern_size( pool ) > n_distinct ) {
+      cerr << me << ": intern: too many interned\n";
+      exit( EX_SOFTWARE );
+    }
+    cout << left << setw(11) << (concurrent ? "intern/mt" : "intern")
+         << right << setw(8) << ns << '\n';
+  } // for
+  cout << "arena: " << ht_intern_bytes( pools[0] ) / 1024 << " KiB vs. "
+       << token_bytes / 1024 << " KiB of strings\n";
+
+  // Pre-compute lengths so only finding is timed.
+  vector<size_t> lens;
+  for ( char const *s : tokens )
+    lens.push_back( strlen( s ) );
+
+  cout << left << setw(11) << "threads" << right << setw(10) << "mutex"
+       << setw(11) << "lock-free" << "  (Mops/s)\n";
+  for ( unsigned n_threads = 1; n_threads <= opt_threads; n_threads *= 2 ) {
+    double mops[2];
+    mutex pool_mutex;
+    for ( bool concurrent : { false, true } ) {
+      ht_intern_t *const pool = pools[ concurrent ];
+      vector<thread> threads;
+      start = chrono::steady_clock::now();
+      for ( unsigned i = 0; i < n_threads; ++i ) {
+        threads.emplace_back( [&, i, concurrent, pool]() {
+          size_t found = 0;
+          for ( size_t j = i; j < i + tokens.size(); ++j ) {
+            size_t const k = j % tokens.size();
+            if ( concurrent ) {
+              found += ht_intern_find( pool, tokens[k], lens[k] ) != nullptr;
+            }
+            else {
+              lock_guard<mutex> const lock{ pool_mutex };
+              found += ht_intern_find( pool, tokens[k], lens[k] ) != nullptr;
+            }
+          } // for
+          if ( found != tokens.size() ) {
+            cerr << me << ": intern: wrong number found\n";
+            exit( EX_SOFTWARE );
+          }
+        } );
+      } // for
+      for ( thread &t : threads )
+        t.join();
+      mops[ concurrent ] =
+        (double)n_threads * tokens.size() / ns_per_op( start, 1 ) * 1e3;
+    } // for
+    cout << left << setw(11) << n_threads << right << setw(10) << mops[0]
+         << setw(11) << mops[1] << '\n';
+  } // for
+
+  ht_intern_free( pools[0] );
+  ht_intern_free( pools[1] );
+}
+
+/**
+ * Compares summing #opt_n 16-byte records by ht_iterator_next() with doing so
+ * by ht_for_each_parallel() with 1 to #opt_threads threads for each engine,
+ * both for a table at its maximum load factor and one having 16 times as many
+ * buckets (or slots) as entries (as after having grown then had most entries
+ * deleted).
+ */
+static void bench_iterate() {
+  struct record { uint64_t key, value; };
+  vector<uint64_t> const keys = shuffled_keys( 0, opt_n );
+  vector<record> records( opt_n );
+  uint64_t expected = 0;
+  for ( size_t i = 0; i < opt_n; ++i ) {
+    records[i] = { keys[i], i };
+    expected += i;
+  } // for
+
+  struct { char const *name; ht_engine_t engine; bool sparse; }
+  const TABLES[] = {
+    { "chained",    HT_ENGINE_CHAINED, false },
+    { "chained/16", HT_ENGINE_CHAINED, true  },
+    { "open",       HT_ENGINE_OPEN,    false },
+    { "open/16",    HT_ENGINE_OPEN,    true  },
+    { "dense",      HT_ENGINE_DENSE,   false },
+    { "dense/16",   HT_ENGINE_DENSE,   true  },
+  };
+
+  cout << "iterate: " << opt_n << " records\n"
+       << left << setw(11) << "table" << setw(18) << "method" << right
+       << setw(10) << "ms" << setw(10) << "Mrec/s" << '\n'
+       << fixed << setprecision(1);
+
+  for ( auto const &tc : TABLES ) {
+    char const *const name = tc.name;
+    hash_table_t table;
+    ht_options_t opt{};
+    opt.engine = tc.engine;
+    ht_init_opt( &table, 1.0, 0, &ht_cmp_u64, &ht_hash_u64, &opt );
+    if ( tc.sparse )
+      ht_reserve( &table, opt_n * 16 );
+    ht_build( &table, records.data(), sizeof(record), opt_n, 0 );
+
+    auto const report = [&]( string const &method, uint64_t sum,
+                             double ms ) {
+      if ( sum != expected ) {
+        cerr << me << ": iterate: wrong sum\n";
+        exit( EX_SOFTWARE );
+      }
+      cout << left << setw(11) << name << setw(18) << method << right
+           << setw(10) << ms << setw(10) << opt_n / ms / 1e3 << '\n';
+    };
+
+    auto start = chrono::steady_clock::now();
+    uint64_t sum = 0;
+    ht_iterator_t it;
+    ht_iterator_init( &it, &table );
+    for ( ht_entry_t *entry; (entry = ht_iterator_next( &it )) != nullptr; )
+      sum += static_cast<record const*>( HT_DINT( entry ) )->value;
+    report( "ht_iterator_next", sum, ns_per_op( start, 1000000 ) );
+
+    for ( unsigned t = 1; t <= opt_threads; t *= 2 ) {
+      // One cache line per thread so threads don't falsely share.
+      struct alignas(64) padded_sum { uint64_t sum; };
+      vector<padded_sum> sums( t );
+      start = chrono::steady_clock::now();
+      ht_for_each_parallel(
+        &table,
+        []( ht_entry_t *entry, unsigned thread_idx, void *arg ) {
+          static_cast<padded_sum*>( arg )[ thread_idx ].sum +=
+            static_cast<record const*>( HT_DINT( entry ) )->value;
+        },
+        sums.data(), t
+      );
+      sum = 0;
+      for ( padded_sum const &ps : sums )
+        sum += ps.sum;
+      report(
+        "for_each/" + to_string( t ), sum, ns_per_op( start, 1000000 )
+      );
+    } // for
+
+    ht_cleanup( &table, nullptr );
+  } // for
+}
+
+/**
+ * Compares caches holding #opt_n / 10 of #opt_n keys accessed with a skewed
+ * distribution, each access a find followed, on a miss, by an insert:
+ *
+ *  + map+list: the usual std::unordered_map of std::list iterators.
+ *  + ht_lru.
+ *  + ht_clock with 1 to #opt_threads threads.
+ */
+static void bench_lru() {
+  struct kv { uint64_t key, value; };
+  size_t const capacity = max( opt_n / 10, size_t{ 1 } );
+  size_t const n_ops = max( MIN_OPS / 10, opt_n );
+  vector<uint64_t> accesses( n_ops );
+  mt19937_64 rng{ 42 };
+  uniform_real_distribution<double> uniform;
+  for ( uint64_t &k : accesses ) {
+    double const u = uniform( rng );
+    k = (uint64_t)((double)opt_n * u * u * u);    // skewed toward 0
+  } // for
+
+  cout << "lru: capacity " << capacity << " of " << opt_n << " keys, "
+       << n_ops << " accesses\n"
+       << left << setw(12) << "cache" << right << setw(10) << "Mops/s"
+       << setw(10) << "hit %" << '\n' << fixed << setprecision(1);
+
+  auto const report = [&]( string const &name, double mops, size_t hits ) {
+    cout << left << setw(12) << name << right << setw(10) << mops
+         << setw(10) << 100.0 * hits / n_ops << '\n';
+  };
+
+  {
+    list<kv> recency;
+    unordered_map<uint64_t,list<kv>::iterator> map;
+    map.reserve( capacity + 1 );
+    size_t hits = 0;
+    auto const start = chrono::steady_clock::now();
+    for ( uint64_t k : accesses ) {
+      auto const i = map.find( k );
+      if ( i != map.end() ) {
+        recency.splice( recency.begin(), recency, i->second );
+        ++hits;
+        continue;
+      }
+      recency.push_front( { k, k } );
+      map.emplace( k, recency.begin() );
+      if ( map.size() > capacity ) {
+        map.erase( recency.back().key );
+        recency.pop_back();
+      }
+    } // for
+    report( "map+list", 1e3 / ns_per_op( start, n_ops ), hits );
+  }
+
+  {
+    ht_lru_t cache;
+    ht_lru_init( &cache, capacity, 0, &ht_cmp_u64, &ht_hash_u64, nullptr );
+    size_t hits = 0;
+    auto const start = chrono::steady_clock::now();
+    for ( uint64_t k : accesses ) {
+      if ( ht_lru_find( &cache, &k ) != nullptr ) {
+        ++hits;
+        continue;
+      }
+      kv const r = { k, k };
+      ht_lru_insert( &cache, &r, sizeof r );
+    } // for
+    report( "ht_lru", 1e3 / ns_per_op( start, n_ops ), hits );
+    ht_lru_cleanup( &cache, nullptr );
+  }
+
+  for ( unsigned n_threads = 1; ; n_threads = min( n_threads * 2,
+                                                   opt_threads ) ) {
+    ht_clock_t *const cache = ht_clock_new(
+      64, capacity, 0, &ht_cmp_u64, &ht_hash_u64, nullptr
+    );
+    atomic<size_t> hits{ 0 };
+    vector<thread> threads;
+    auto const start = chrono::steady_clock::now();
+    for ( unsigned t = 0; t < n_threads; ++t ) {
+      threads.emplace_back( [&, t]() {
+        size_t thread_hits = 0;
+        for ( size_t i = t; i < n_ops; i += n_threads ) {
+          kv r = { accesses[i], accesses[i] };
+          if ( ht_clock_find( cache, &r, &r, sizeof r ) )
+            ++thread_hits;
+          else
+            ht_clock_insert( cache, &r, sizeof r );
+        } // for
+        hits += thread_hits;
+      } );
+    } // for
+    for ( thread &t : threads )
+      t.join();
+    report( "ht_clock/" + to_string( n_threads ),
+            1e3 / ns_per_op( start, n_ops ), hits );
+    ht_clock_free( cache, nullptr );
+    if ( n_threads == opt_threads )
+      break;
+  } // for
+}
+
+/**
+ * Compares the throughput of ht_mt with that of a mutex-guarded hash_table
+ * from 1 to #opt_threads threads for read-mostly and write-heavy mixes.
+ */
+static void bench_mt() {
+  struct { char const *name; unsigned write_pct; } const MIXES[] = {
+    { "read-mostly", 5  },
+    { "write-heavy", 50 },
+  };
+  size_t const n_ops = max( MIN_OPS / 10, opt_n );
+  vector<uint64_t> const keys = shuffled_keys( 0, opt_n );
+
+  cout << "mt: " << opt_n << " entries, " << n_ops
+       << " ops/thread, Mops/s\n"
+       << left << setw(12) << "mix" << right << setw(8) << "threads"
+       << setw(10) << "mutex" << setw(10) << "ht_mt" << '\n'
+       << fixed << setprecision(1);
+
+  for ( auto const &m : MIXES ) {
+    for ( unsigned n_threads = 1; ; n_threads = min( n_threads * 2,
+                                                     opt_threads ) ) {
+      locked_table locked;
+      ht_init( &locked.table, 1.0, opt_n, &ht_cmp_u64, &ht_hash_u64 );
+      insert_keys( &locked.table, keys );
+      double const locked_mops =
+        run_mt( &locked, &locked_op, n_threads, n_ops, m.write_pct );
+      ht_cleanup( &locked.table, nullptr );
+
+      ht_mt_t *const mt = ht_mt_new( 1.0, opt_n, &ht_cmp_u64, &ht_hash_u64 );
+      for ( uint64_t k : keys )
+        ht_mt_insert( mt, &k, sizeof k );
+      double const mt_mops =
+        run_mt( mt, &mt_op, n_threads, n_ops, m.write_pct );
+      ht_mt_free( mt, nullptr );
+
+      cout << left << setw(12) << m.name << right << setw(8) << n_threads
+           << setw(10) << locked_mops << setw(10) << mt_mops << '\n';
+      if ( n_threads == opt_threads )
+        break;
+    } // for
+  } // for
+}
+
+/**
+ * Compares merging #opt_threads per-thread tables of #opt_n entries each
+ * (half of which are shared with the next thread's) with the serial
+ * ht_iterator_next() + ht_insert() loop versus ht_sharded_merge().
+ */
+static void bench_merge() {
+  unsigned const N_SHARDS = 64;
+  ht_options_t opt{};
+  opt.engine = HT_ENGINE_CHAINED;
+  opt.sizing = HT_SIZING_POW2;
+  vector<vector<uint64_t>> keys;
+  for ( unsigned i = 0; i < opt_threads; ++i )
+    keys.push_back( shuffled_keys( i * opt_n / 2, opt_n ) );
+  size_t const n_distinct = (opt_threads + 1) * opt_n / 2;
+
+  cout << "merge: " << opt_threads << " tables of " << opt_n
+       << " entries, ms\n"
+       << left << setw(10) << "method" << right << setw(10) << "build"
+       << setw(10) << "merge" << '\n' << fixed << setprecision(1);
+
+  // serial
+  {
+    auto start = chrono::steady_clock::now();
+    vector<hash_table_t> tables( opt_threads );
+    vector<thread> threads;
+    for ( unsigned i = 0; i < opt_threads; ++i ) {
+      threads.emplace_back( [&, i]() {
+        ht_init_opt( &tables[i], 1.0, opt_n, &ht_cmp_u64, &ht_hash_u64, &opt );
+        insert_keys( &tables[i], keys[i] );
+      } );
+    } // for
+    for ( thread &t : threads )
+      t.join();
+    double const build_ms = ns_per_op( start, 1000000 );
+
+    start = chrono::steady_clock::now();
+    hash_table_t merged;
+    ht_init_opt( &merged, 1.0, 0, &ht_cmp_u64, &ht_hash_u64, &opt );
+    for ( hash_table_t &table : tables ) {
+      ht_iterator_t it;
+      ht_iterator_init( &it, &table );
+      for ( ht_entry_t *entry; (entry = ht_iterator_next( &it )) != nullptr; ) {
+        ht_insert_rv_t const rv =
+          ht_insert( &merged, entry->data, entry->data_size );
+        if ( rv.inserted )
+          memcpy( HT_DINT( rv.entry ), entry->data, entry->data_size );
+      } // for
+      ht_cleanup( &table, nullptr );
+    } // for
+    double const merge_ms = ns_per_op( start, 1000000 );
+
+    if ( merged.size != n_distinct ) {
+      cerr << me << ": merge: wrong size\n";
+      exit( EX_SOFTWARE );
+    }
+    cout << left << setw(10) << "serial" << right << setw(10) << build_ms
+         << setw(10) << merge_ms << '\n';
+    ht_cleanup( &merged, nullptr );
+  }
+
+  // sharded
+  {
+    auto start = chrono::steady_clock::now();
+    vector<ht_sharded_t> tables( opt_threads );
+    vector<thread> threads;
+    for ( unsigned i = 0; i < opt_threads; ++i ) {
+      threads.emplace_back( [&, i]() {
+        ht_sharded_init(
+          &tables[i], N_SHARDS, 1.0, opt_n, &ht_cmp_u64, &ht_hash_u64, &opt
+        );
+        for ( uint64_t k : keys[i] ) {
+          ht_insert_rv_t const rv =
+            ht_sharded_insert( &tables[i], &k, sizeof k );
+          if ( rv.inserted )
+            memcpy( HT_DINT( rv.entry ), &k, sizeof k );
+        } // for
+      } );
+    } // for
+    for ( thread &t : threads )
+      t.join();
+    double const build_ms = ns_per_op( start, 1000000 );
+
+    start = chrono::steady_clock::now();
+    ht_sharded_t merged;
+    ht_sharded_init(
+      &merged, N_SHARDS, 1.0, 0, &ht_cmp_u64, &ht_hash_u64, &opt
+    );
+    ht_sharded_merge(
+      &merged, tables.data(), opt_threads, nullptr, opt_threads
+    );
+    double const merge_ms = ns_per_op( start, 1000000 );
+
+    if ( ht_sharded_size( &merged ) != n_distinct ) {
+      cerr << me << ": merge: wrong size\n";
+      exit( EX_SOFTWARE );
+    }
+    cout << left << setw(10) << "sharded" << right << setw(10) << build_ms
+         << setw(10) << merge_ms << '\n';
+    ht_sharded_cleanup( &merged, nullptr );
+  }
+}
+
+/**
+ * Compares the mean and maximum latency of ht_insert() of #opt_n keys with
+ * and without \ref ht_options::incremental "incremental" resizing, then, for
+ * an incremental table in the middle of migrating its old buckets, deletes
+ * every other entry returned by ht_iterator_next() and checks that every
+ * entry was visited exactly once.
+ */
+static void bench_resize() {
+  vector<uint64_t> const keys = shuffled_keys( 0, opt_n );
+
+  cout << "resize: " << opt_n << " inserts, ns\n"
+       << left << setw(13) << "resize" << right << setw(10) << "mean"
+       << setw(12) << "max" << '\n' << fixed << setprecision(1);
+
+  for ( bool incremental : { false, true } ) {
+    ht_options_t opt{};
+    opt.incremental = incremental;
+    hash_table_t table;
+    ht_init_opt( &table, 1.0, 0, &ht_cmp_u64, &ht_hash_u64, &opt );
+    double max_ns = 0;
+    auto const start = chrono::steady_clock::now();
+    for ( uint64_t const &k : keys ) {
+      auto const insert_start = chrono::steady_clock::now();
+      ht_insert_rv_t const rv = ht_insert( &table, (void*)&k, sizeof k );
+      memcpy( rv.entry->data, &k, sizeof k );
+      max_ns = max( max_ns, ns_per_op( insert_start, 1 ) );
+    } // for
+    cout << left << setw(13) << (incremental ? "incremental" : "all at once")
+         << right << setw(10) << ns_per_op( start, opt_n ) << setw(12)
+         << max_ns << '\n';
+    ht_cleanup( &table, nullptr );
+  } // for
+
+  ht_options_t opt{};
+  opt.incremental = true;
+  hash_table_t table;
+  ht_init_opt( &table, 1.0, 0, &ht_cmp_u64, &ht_hash_u64, &opt );
+  // Insert until the table has just grown, so most old buckets remain.
+  for ( uint64_t k = 0; k < opt_n || table.old_buckets == nullptr; ++k ) {
+    ht_insert_rv_t const rv = ht_insert( &table, &k, sizeof k );
+    memcpy( rv.entry->data, &k, sizeof k );
+  } // for
+  size_t const size = table.size;
+  size_t const old_left = table.old_n_buckets - table.migrate_idx;
+
+  vector<bool> seen( size );
+  size_t n_visited = 0;
+  ht_iterator_t it;
+  auto const start = chrono::steady_clock::now();
+  ht_iterator_init( &it, &table );
+  for ( ht_entry_t *entry; (entry = ht_iterator_next( &it )) != nullptr; ) {
+    uint64_t const k = key_of( entry->data );
+    if ( k >= size || seen[k] ) {
+      cerr << me << ": resize: key visited twice or unknown\n";
+      exit( EX_SOFTWARE );
+    }
+    seen[k] = true;
+    if ( n_visited++ % 2 == 0 )
+      ht_delete( &table, entry );
+  } // for
+  double const scan_ns = ns_per_op( start, size );
+  if ( n_visited != size || table.size != size / 2 ) {
+    cerr << me << ": resize: visited " << n_visited << " of " << size
+         << " entries while deleting\n";
+    exit( EX_SOFTWARE );
+  }
+  ht_cleanup( &table, nullptr );
+
+  cout << "delete in scan: " << size << " entries, " << old_left
+       << " old buckets left, " << scan_ns << " ns/entry: ok\n";
+}
+
+/**
+ * Compares reusing a table per "request" round via ht_clear() with
+ * ht_cleanup() + ht_init(), then measures RSS after a spike before and after
+ * ht_shrink_to_fit().
+ */
+static void bench_reuse() {
+  size_t const N_ROUNDS = 100;
+  size_t const round_n = max( opt_n / 100, size_t{ 1 } );
+  vector<uint64_t> const keys = shuffled_keys( 0, round_n );
+
+  cout << "reuse: " << N_ROUNDS << " rounds of " << round_n
+       << " entries, ms\n" << fixed << setprecision(1);
+
+  hash_table_t table;
+  auto start = chrono::steady_clock::now();
+  for ( size_t r = 0; r < N_ROUNDS; ++r ) {
+    ht_init( &table, 1.0, 0, &ht_cmp_u64, &ht_hash_u64 );
+    insert_keys( &table, keys );
+    ht_cleanup( &table, nullptr );
+  } // for
+  cout << "  re-init  " << setw(10) << ns_per_op( start, 1000000 ) << '\n';
+
+  ht_init( &table, 1.0, 0, &ht_cmp_u64, &ht_hash_u64 );
+  start = chrono::steady_clock::now();
+  for ( size_t r = 0; r < N_ROUNDS; ++r ) {
+    insert_keys( &table, keys );
+    ht_clear( &table, nullptr );
+  } // for
+  cout << "  clear    " << setw(10) << ns_per_op( start, 1000000 ) << '\n';
+
+  cout << "spike: " << opt_n << " entries, RSS MiB\n";
+  double const rss_before = rss_mib();
+  insert_keys( &table, shuffled_keys( 0, opt_n ) );
+  double const rss_spike = rss_mib();
+  ht_clear( &table, nullptr );
+  insert_keys( &table, keys );
+  double const rss_clear = rss_mib();
+  ht_shrink_to_fit( &table );
+#ifdef __GLIBC__
+  // Freed slabs may be in the heap, so return them to the OS to measure.
+  malloc_trim( 0 );
+#endif /* __GLIBC__ */
+  double const rss_shrunk = rss_mib();
+  ht_cleanup( &table, nullptr );
+
+  cout << "  before   " << setw(10) << rss_before << '\n'
+       << "  spike    " << setw(10) << rss_spike << '\n'
+       << "  cleared  " << setw(10) << rss_clear << '\n'
+       << "  shrunk   " << setw(10) << rss_shrunk << '\n';
+}
+
+/**
+ * Compares #HT_ENGINE_SMALL with #HT_ENGINE_CHAINED for #opt_n / 4 tables
+ * having 0 to #HT_SMALL_N - 1 entries each: RSS per table, the time to build
+ * them all, and the time per hit.
+ */
+static void bench_small() {
+  struct { char const *name; ht_engine_t engine; } const ENGINES[] = {
+    { "chained", HT_ENGINE_CHAINED },
+    { "small",   HT_ENGINE_SMALL   },
+  };
+  size_t const n_tables = max( opt_n / 4, size_t{ 1 } );
+
+  cout << "small: " << n_tables << " tables of 0-" << HT_SMALL_N - 1
+       << " entries\n"
+       << left << setw(10) << "engine" << right << setw(10) << "B/table"
+       << setw(10) << "build ms" << setw(10) << "hit ns" << '\n'
+       << fixed << setprecision(1);
+
+  for ( auto const &e : ENGINES ) {
+#ifdef __GLIBC__
+    malloc_trim( 0 );
+#endif /* __GLIBC__ */
+    double const rss_before = rss_mib();
+    vector<hash_table_t> tables( n_tables );
+    ht_options_t opt{};
+    opt.engine = e.engine;
+    size_t n_entries = 0;
+
+    auto start = chrono::steady_clock::now();
+    for ( size_t t = 0; t < n_tables; ++t ) {
+      ht_init_opt( &tables[t], 1.0, 0, &ht_cmp_u64, &ht_hash_u64, &opt );
+      for ( uint64_t k = 0; k < t % HT_SMALL_N; ++k ) {
+        ht_insert_rv_t const rv = ht_insert( &tables[t], &k, sizeof k );
+        memcpy( rv.entry->data, &k, sizeof k );
+      } // for
+      n_entries += t % HT_SMALL_N;
+    } // for
+    double const build_ms = ns_per_op( start, 1000000 );
+    double const rss_after = rss_mib();
+
+    size_t found = 0;
+    start = chrono::steady_clock::now();
+    for ( size_t t = 0; t < n_tables; ++t ) {
+      for ( uint64_t k = 0; k < t % HT_SMALL_N; ++k )
+        found += ht_find( &tables[t], &k ) != nullptr;
+    } // for
+    double const hit_ns = ns_per_op( start, max( n_entries, size_t{ 1 } ) );
+    if ( found != n_entries ) {
+      cerr << me << ": small: wrong number found\n";
+      exit( EX_SOFTWARE );
+    }
+
+    for ( hash_table_t &table : tables )
+      ht_cleanup( &table, nullptr );
+
+    cout << left << setw(10) << e.name << right << setw(10)
+         << (rss_after - rss_before) * (1 << 20) / (double)n_tables
+         << setw(10) << build_ms << setw(10) << hit_ns << '\n';
+  } // for
+}
+
+/**
+ * Compares #HT_SIZING_PRIME and #HT_SIZING_POW2 with good and poor hash
+ * functions.
+ */
+static void bench_sizing() {
+  struct { char const *name; ht_hash_fn_t fn; } const HASHES[] = {
+    { "mix",      &ht_hash_u64   },
+    { "identity", &hash_identity },
+    { "strided",  &hash_strided  },
+  };
+  struct { char const *name; ht_sizing_t sizing; } const SIZINGS[] = {
+    { "prime", HT_SIZING_PRIME },
+    { "pow2",  HT_SIZING_POW2  },
+  };
+
+  vector<uint64_t> const keys = shuffled_keys( 0, opt_n );
+  vector<uint64_t> const misses = shuffled_keys( opt_n, opt_n );
+
+  cout << "sizing: " << opt_n << " entries, ns/op\n"
+       << left << setw(8) << "sizing" << setw(10) << "hash"
+       << right << setw(10) << "insert" << setw(10) << "hit"
+       << setw(10) << "miss" << '\n' << fixed << setprecision(1);
+
+  for ( auto const &s : SIZINGS ) {
+    for ( auto const &h : HASHES ) {
+      hash_table_t table;
+      ht_options_t opt{};
+      opt.engine = HT_ENGINE_CHAINED;
+      opt.sizing = s.sizing;
+      ht_init_opt( &table, 1.0, 0, &ht_cmp_u64, h.fn, &opt );
+
+      auto start = chrono::steady_clock::now();
+      insert_keys( &table, keys );
+      double const insert_ns = ns_per_op( start, keys.size() );
+
+      start = chrono::steady_clock::now();
+      size_t const hits = find_keys( &table, keys );
+      double const hit_ns =
+        ns_per_op( start, keys.size() * n_passes( keys.size() ) );
+
+      start = chrono::steady_clock::now();
+      size_t const false_hits = find_keys( &table, misses );
+      double const miss_ns =
+        ns_per_op( start, misses.size() * n_passes( misses.size() ) );
+
+      if ( hits != keys.size() || false_hits != 0 ) {
+        cerr << me << ": sizing: wrong lookup results\n";
+        exit( EX_SOFTWARE );
+      }
+
+      cout << left << setw(8) << s.name << setw(10) << h.name
+           << right << setw(10) << insert_ns << setw(10) << hit_ns
+           << setw(10) << miss_ns << '\n';
+      ht_cleanup( &table, nullptr );
+    } // for
+  } // for
+}
+
+/**
+ * Compares the time until the first lookup of rebuilding a table by inserting
+ * every entry with that of ht_open_mapped() on a file written by ht_save(),
+ * then compares lookup speeds.
+ */
+static void bench_snapshot() {
+  char const *const tmpdir = getenv( "TMPDIR" );
+  string const path =
+    string{ tmpdir != nullptr ? tmpdir : "/tmp" } + "/ht_bench.snapshot";
+  vector<uint64_t> const keys = shuffled_keys( 0, opt_n );
+
+  cout << "snapshot: " << opt_n << " entries\n" << fixed << setprecision(1);
+
+  hash_table_t built;
+  auto start = chrono::steady_clock::now();
+  ht_init( &built, 1.0, 0, &ht_cmp_u64, &ht_hash_u64 );
+  insert_keys( &built, keys );
+  uint64_t const k0 = keys[0];
+  bool const built_found = ht_find( &built, &k0 ) != nullptr;
+  double const rebuild_ms = ns_per_op( start, 1000000 );
+
+  start = chrono::steady_clock::now();
+  bool const saved = ht_save( &built, path.c_str() );
+  double const save_ms = ns_per_op( start, 1000000 );
+
+  hash_table_t mapped;
+  start = chrono::steady_clock::now();
+  bool const opened =
+    saved && ht_open_mapped( &mapped, path.c_str(), &ht_cmp_u64, &ht_hash_u64 );
+  bool const mapped_found = opened && ht_find( &mapped, &k0 ) != nullptr;
+  double const open_ms = ns_per_op( start, 1000000 );
+  unlink( path.c_str() );
+
+  if ( !opened ) {
+    cerr << me << ": snapshot: " << path << ": " << strerror( errno ) << '\n';
+    exit( EX_IOERR );
+  }
+
+  cout << "  time to first lookup, ms\n"
+       << "    rebuild  " << setw(10) << rebuild_ms << '\n'
+       << "    mapped   " << setw(10) << open_ms << '\n'
+       << "  ht_save(), ms\n"
+       << "    save     " << setw(10) << save_ms << '\n'
+       << "  hit, ns/op\n";
+
+  start = chrono::steady_clock::now();
+  size_t const built_hits = find_keys( &built, keys );
+  double const built_ns =
+    ns_per_op( start, keys.size() * n_passes( keys.size() ) );
+  start = chrono::steady_clock::now();
+  size_t const mapped_hits = find_keys( &mapped, keys );
+  double const mapped_ns =
+    ns_per_op( start, keys.size() * n_passes( keys.size() ) );
+
+  if ( !built_found || !mapped_found || built_hits != keys.size() ||
+       mapped_hits != keys.size() ) {
+    cerr << me << ": snapshot: wrong lookup results\n";
+    exit( EX_SOFTWARE );
+  }
+
+  cout << "    built    " << setw(10) << built_ns << '\n'
+       << "    mapped   " << setw(10) << mapped_ns << '\n';
+  ht_cleanup( &mapped, nullptr );
+  ht_cleanup( &built, nullptr );
+}
+
+/**
+ * Latency statistics of a run of operations.  Operations are timed in
+ * batches of #SUITE_BATCH_N since timing each operation individually would
+ * cost as much as the operation itself, so percentiles are of batch averages.
+ */
+struct latency {
+  vector<float> samples;                // ns/op of each batch
+  double        total_ns = 0;           // total time
+  size_t        n_ops = 0;              // total operations
+
+  /**
+   * Runs \a op_fn( i ) for i in [0, \a n).
+   */
+  template<typename OpFn>
+  void time( size_t n, OpFn op_fn ) {
+    size_t hits = 0;
+    auto const start = chrono::steady_clock::now();
+    auto batch_start = start;
+    for ( size_t i = 0; i < n; ) {
+      size_t const batch_n = min( n - i, SUITE_BATCH_N );
+      for ( size_t const end = i + batch_n; i < end; ++i )
+        hits += op_fn( i );
+      auto const now = chrono::steady_clock::now();
+      chrono::duration<float,nano> const elapsed = now - batch_start;
+      samples.push_back( elapsed.count() / batch_n );
+      batch_start = now;
+    } // for
+    total_ns += ns_per_op( start, 1 );
+    n_ops += n;
+    // Keep the loop from being optimized away.
+    asm volatile( "" : : "r"(hits) );
+  }
+
+  /**
+   * Prints the mean, percentiles, and max in ns/op.
+   */
+  void print() {
+    sort( samples.begin(), samples.end() );
+    auto const pct = [this]( double p ) {
+      return samples[ min( samples.size() - 1,
+                           (size_t)(p / 100 * samples.size()) ) ];
+    };
+    cout << setw(8) << total_ns / n_ops << setw(8) << pct( 50 )
+         << setw(8) << pct( 99 ) << setw(8) << pct( 99.9 )
+         << setw(9) << samples.back();
+  }
+};
+
+/**
+ * How ht_table stores and looks up keys of type \a K.
+ */
+template<typename K>
+struct ht_key_traits;
+
+template<>
+struct ht_key_traits<uint64_t> {
+  static constexpr ht_cmp_fn_t  cmp_fn  = &ht_cmp_u64;
+  static constexpr ht_hash_fn_t hash_fn = &ht_hash_u64;
+  static void const* data( uint64_t const &k ) { return &k; }
+  static size_t size( uint64_t const& ) { return sizeof(uint64_t); }
+};
+
+template<>
+struct ht_key_traits<string> {
+  static constexpr ht_cmp_fn_t  cmp_fn  = &ht_cmp_str;
+  static constexpr ht_hash_fn_t hash_fn = &ht_hash_str;
+  static void const* data( string const &k ) { return k.c_str(); }
+  static size_t size( string const &k ) { return k.size() + 1; }
+};
+
+/**
+ * A hash_table mapping keys of type \a K to `uint64_t` values.  Each entry's
+ * data is the key immediately followed by the value so that the key-only
+ * ht_key_traits functions work on entries as-is.
+ */
+template<typename K>
+class ht_table {
+  typedef ht_key_traits<K> traits;
+public:
+  explicit ht_table( ht_engine_t engine ) {
+    ht_options_t opt{};
+    opt.engine = engine;
+    ht_init_opt( &table_, 1.0, 0, traits::cmp_fn, traits::hash_fn, &opt );
+  }
+
+  ~ht_table() {
+    ht_cleanup( &table_, nullptr );
+  }
+
+  bool erase( K const &k ) {
+    ht_entry_t *const entry = ht_find( &table_, traits::data( k ) );
+    if ( entry != nullptr )
+      ht_delete( &table_, entry );
+    return entry != nullptr;
+  }
+
+  bool find( K const &k ) const {
+    return ht_find( &table_, traits::data( k ) ) != nullptr;
+  }
+
+  bool insert( K const &k, uint64_t v ) {
+    size_t const n = traits::size( k );
+    ht_insert_rv_t const rv = ht_insert(
+      &table_, const_cast<void*>( traits::data( k ) ), n + sizeof v
+    );
+    if ( rv.inserted ) {
+      memcpy( rv.entry->data, traits::data( k ), n );
+      memcpy( rv.entry->data + n, &v, sizeof v );
+    }
+    return rv.inserted;
+  }
+
+  uint64_t sum() {
+    uint64_t sum = 0;
+    ht_iterator_t it;
+    ht_iterator_init( &it, &table_ );
+    for ( ht_entry_t *entry; (entry = ht_iterator_next( &it )) != nullptr; ) {
+      uint64_t v;
+      memcpy( &v, entry->data + entry->data_size - sizeof v, sizeof v );
+      sum += v;
+    } // for
+    return sum;
+  }
+
+private:
+  hash_table_t table_;
+};
+
+/**
+ * A standard-like map (std::unordered_map or PJL::hash_map) with the same
+ * interface as ht_table.
+ */
+template<typename Map>
+class std_table {
+  typedef typename Map::key_type K;
+public:
+  bool erase( K const &k ) { return map_.erase( k ) != 0; }
+  bool find( K const &k ) const { return map_.find( k ) != map_.end(); }
+  bool insert( K const &k, uint64_t v ) {
+    return map_.try_emplace( k, v ).second;
+  }
+
+  uint64_t sum() {
+    uint64_t sum = 0;
+    for ( auto const &kv : map_ )
+      sum += kv.second;
+    return sum;
+  }
+
+private:
+  Map map_;
+};
+
+/**
+ * Runs the suite's workloads on one kind of table.
+ *
+ * @param name The name of the table.
+ * @param keys The keys to insert.
+ * @param misses Keys not in \a keys.
+ * @param new_table A function returning a new, empty table.
+ */
+template<typename K,typename NewFn>
+static void suite_table( char const *name, vector<K> const &keys,
+                         vector<K> const &misses, NewFn new_table ) {
+  size_t const n = keys.size();
+  size_t const passes = max( SUITE_OPS / n, size_t{ 1 } );
+  auto const row = [name]( char const *workload ) {
+    cout << left << setw(15) << name << setw(8) << workload << right;
+  };
+
+  latency insert_lat;
+  double rss_delta = 0;
+  for ( size_t pass = 0; pass < passes; ++pass ) {
+#ifdef __GLIBC__
+    // Release memory cached by malloc so it's not reused unmeasured.
+    if ( pass == 0 )
+      malloc_trim( 0 );
+#endif /* __GLIBC__ */
+    double const rss_before = rss_mib();
+    auto table = new_table();
+    insert_lat.time( n, [&]( size_t i ) {
+      return table->insert( keys[i], i );
+    } );
+    if ( pass == 0 )
+      rss_delta = rss_mib() - rss_before;
+  } // for
+  row( "insert" );
+  insert_lat.print();
+  cout << setw(8) << rss_delta << '\n';
+
+  auto table = new_table();
+  for ( size_t i = 0; i < n; ++i )
+    table->insert( keys[i], i );
+
+  latency hit_lat, miss_lat, iter_lat, churn_lat;
+  for ( size_t pass = 0; pass < passes; ++pass ) {
+    hit_lat.time( n, [&]( size_t i ) { return table->find( keys[i] ); } );
+    miss_lat.time( n, [&]( size_t i ) { return table->find( misses[i] ); } );
+  } // for
+  row( "hit" );
+  hit_lat.print();
+  cout << '\n';
+  row( "miss" );
+  miss_lat.print();
+  cout << '\n';
+
+  // Each iteration is timed as one batch of n entries.
+  for ( size_t pass = 0; pass < passes; ++pass ) {
+    auto const start = chrono::steady_clock::now();
+    uint64_t const sum = table->sum();
+    double const ns = ns_per_op( start, 1 );
+    asm volatile( "" : : "r"(sum) );
+    iter_lat.samples.push_back( (float)(ns / n) );
+    iter_lat.total_ns += ns;
+    iter_lat.n_ops += n;
+  } // for
+  row( "iterate" );
+  iter_lat.print();
+  cout << '\n';
+
+  //
+  // Churn: keys[] then misses[] form a ring of 2n keys of which a window of n
+  // is in the table; each operation deletes the oldest key of the window and
+  // inserts the key just past it, sliding the window by one.
+  //
+  size_t const n_churn = passes * n;
+  churn_lat.time( n_churn, [&]( size_t i ) {
+    auto const ring = [&]( size_t j ) -> K const& {
+      j %= 2 * n;
+      return j < n ? keys[j] : misses[ j - n ];
+    };
+    return table->erase( ring( i ) ) + table->insert( ring( i + n ), i );
+  } );
+  row( "churn" );
+  churn_lat.print();
+  cout << '\n';
+}
+
+/**
+ * Runs the suite on every kind of table for one key type and size.
+ */
+template<typename K>
+static void suite_size( char const *key_name, vector<K> const &keys,
+                        vector<K> const &misses ) {
+  cout << key_name << " keys, " << keys.size() << " entries\n"
+       << left << setw(15) << "table" << setw(8) << "op" << right
+       << setw(8) << "mean" << setw(8) << "p50" << setw(8) << "p99"
+       << setw(8) << "p99.9" << setw(9) << "max" << setw(8) << "RSS MiB"
+       << '\n' << fixed << setprecision(1);
+
+  suite_table( "ht-chained", keys, misses, []() {
+    return make_unique<ht_table<K>>( HT_ENGINE_CHAINED );
+  } );
+  suite_table( "ht-open", keys, misses, []() {
+    return make_unique<ht_table<K>>( HT_ENGINE_OPEN );
+  } );
+  suite_table( "hash_map", keys, misses, []() {
+    return make_unique<std_table<PJL::hash_map<K,uint64_t>>>();
+  } );
+  suite_table( "unordered_map", keys, misses, []() {
+    return make_unique<std_table<unordered_map<K,uint64_t>>>();
+  } );
+}
+
+/**
+ * Runs insert, hit, miss, iterate, and churn workloads on hash_table (both
+ * engines), PJL::hash_map, and std::unordered_map for 64-bit integer, short
+ * (8-16 character), and long (64-128 character) string keys at sizes from
+ * about L1 to #opt_n.  (To go well past the last-level cache, use `-n` with
+ * at least 10 million.)
+ *
+ * Times are in ns/op; "RSS MiB" is the growth of RSS by inserting.
+ */
+static void bench_suite() {
+  vector<size_t> sizes;
+  for ( size_t n : { 1u << 9, 1u << 14, 1u << 18 } ) {
+    if ( n < opt_n )
+      sizes.push_back( n );
+  } // for
+  sizes.push_back( opt_n );
+
+  for ( size_t n : sizes ) {
+    suite_size( "u64", shuffled_keys( 0, n ), shuffled_keys( n, n ) );
+    suite_size(
+      "short", shuffled_strings( 0, n, 8, 16 ), shuffled_strings( n, n, 8, 16 )
+    );
+    suite_size(
+      "long", shuffled_strings( 0, n, 64, 128 ),
+      shuffled_strings( n, n, 64, 128 )
+    );
+  } // for
+
+  struct rusage ru;
+  getrusage( RUSAGE_SELF, &ru );
+  cout << "peak RSS MiB: " << ru.ru_maxrss / 1024.0 << '\n';
+}
+
+/**
+ * Prints ht_get_stats() for each engine with good and poor hash functions
+ * after inserting #opt_n keys then looking each up once.  Lookup counters are
+ * printed only if compiled with `HT_STATS`.
+ */
+static void bench_stats() {
+  struct { char const *name; ht_hash_fn_t fn; } const HASHES[] = {
+    { "mix",      &ht_hash_u64   },
+    { "identity", &hash_identity },
+    { "strided",  &hash_strided  },
+  };
+  struct { char const *name; ht_engine_t engine; ht_sizing_t sizing; }
+  const OPTIONS[] = {
+    { "prime", HT_ENGINE_CHAINED, HT_SIZING_PRIME },
+    { "pow2",  HT_ENGINE_CHAINED, HT_SIZING_POW2  },
+    { "open",  HT_ENGINE_OPEN,    HT_SIZING_PRIME },
+  };
+
+  vector<uint64_t> const keys = shuffled_keys( 0, opt_n );
+
+  cout << "stats: " << opt_n << " entries\n"
+       << left << setw(8) << "table" << setw(10) << "hash" << right
+       << setw(6) << "max" << setw(8) << "empty%" << setw(9) << "bkt MiB"
+       << setw(9) << "ent MiB"
+#ifdef HT_STATS
+       << setw(9) << "probes" << setw(8) << "fails" << setw(7) << "grows"
+       << setw(9) << "grow ms"
+#endif /* HT_STATS */
+       << '\n' << fixed << setprecision(1);
+
+  for ( auto const &o : OPTIONS ) {
+    for ( auto const &h : HASHES ) {
+      hash_table_t table;
+      ht_options_t opt{};
+      opt.engine = o.engine;
+      opt.sizing = o.sizing;
+      ht_init_opt( &table, 1.0, 0, &ht_cmp_u64, h.fn, &opt );
+      insert_keys( &table, keys );
+      for ( uint64_t const &k : keys )
+        ht_find( &table, &k );
+
+      ht_stats_t stats;
+      ht_get_stats( &table, &stats );
+      // For the open engine, chain_hist counts entries, not buckets.
+      double const empty_pct = o.engine == HT_ENGINE_OPEN ?
+        100.0 * (stats.n_buckets - table.size) / stats.n_buckets :
+        100.0 * stats.chain_hist[0] / stats.n_buckets;
+
+      cout << left << setw(8) << o.name << setw(10) << h.name << right
+           << setw(6) << stats.chain_max << setw(8) << empty_pct
+           << setw(9) << stats.bucket_bytes / (double)(1 << 20)
+           << setw(9) << stats.entry_bytes / (double)(1 << 20)
+#ifdef HT_STATS
+           << setw(9)
+           << (double)stats.counters.finds.probes / stats.counters.finds.n
+           << setw(8) << stats.counters.n_cmp_fails
+           << setw(7) << stats.counters.n_grows
+           << setw(9) << stats.counters.grow_ns / 1e6
+#endif /* HT_STATS */
+           << '\n';
+      ht_cleanup( &table, nullptr );
+    } // for
+  } // for
+}
+
+/**
+ * Opens a counter of this thread's data TLB load misses.
+ *
+ * @return Returns its file descriptor or -1 if counters are unavailable, e.g.,
+ * in a container or virtual machine.
+ */
+static int tlb_counter_open() {
+#ifdef __linux__
+  perf_event_attr attr{};
+  attr.size = sizeof attr;
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+#else
+  return -1;
+#endif /* __linux__ */
+}
+
+/**
+ * Gets the MiB of this process's anonymous memory backed by transparent huge
+ * pages.
+ */
+static double thp_mib() {
+  ifstream smaps{ "/proc/self/smaps_rollup" };
+  for ( string line; getline( smaps, line ); ) {
+    if ( line.compare( 0, 14, "AnonHugePages:" ) == 0 )
+      return strtod( line.c_str() + 14, nullptr ) / 1024;
+  } // for
+  return 0;
+}
+
+/**
+ * Compares random finds of #opt_n 8-byte keys in tables whose buckets (or
+ * slots) are allocated by malloc(3) with those allocated by
+ * #ht_allocator_huge.  The difference grows with the table: try `-n` of at
+ * least 10000000.  Data TLB misses are printed only where the kernel permits
+ * counting them.
+ */
+static void bench_tlb() {
+  struct { char const *name; ht_engine_t engine; } const ENGINES[] = {
+    { "chained", HT_ENGINE_CHAINED },
+    { "open",    HT_ENGINE_OPEN    },
+  };
+  struct { char const *name; ht_allocator_t const *allocator; }
+  const ALLOCATORS[] = {
+    { "malloc", nullptr            },
+    { "huge",   &ht_allocator_huge },
+  };
+  vector<uint64_t> const keys = shuffled_keys( 0, opt_n );
+  size_t const passes = n_passes( opt_n );
+  int const tlb_fd = tlb_counter_open();
+
+  cout << "tlb: " << opt_n << " 8-byte keys\n"
+       << left << setw(9) << "table" << setw(8) << "alloc" << right
+       << setw(10) << "insert ns" << setw(9) << "find ns" << setw(12)
+       << "dTLB/find" << setw(9) << "THP MiB" << '\n'
+       << fixed << setprecision(1);
+
+  for ( auto const &e : ENGINES ) {
+    for ( auto const &a : ALLOCATORS ) {
+      hash_table_t table;
+      ht_options_t opt{};
+      opt.engine = e.engine;
+      opt.allocator = a.allocator;
+      double const thp_before = thp_mib();
+      ht_init_opt( &table, 1.0, 0, &ht_cmp_u64, &ht_hash_u64, &opt );
+
+      auto start = chrono::steady_clock::now();
+      insert_keys( &table, keys );
+      double const insert_ns = ns_per_op( start, opt_n );
+      double const thp = thp_mib() - thp_before;
+
+      uint64_t tlb_misses = 0;
+      if ( tlb_fd != -1 ) {
+        ioctl( tlb_fd, PERF_EVENT_IOC_RESET, 0 );
+        ioctl( tlb_fd, PERF_EVENT_IOC_ENABLE, 0 );
+      }
+      start = chrono::steady_clock::now();
+      size_t const found = find_keys( &table, keys );
+      double const find_ns = ns_per_op( start, opt_n * passes );
+      if ( tlb_fd != -1 ) {
+        ioctl( tlb_fd, PERF_EVENT_IOC_DISABLE, 0 );
+        if ( read( tlb_fd, &tlb_misses, sizeof tlb_misses ) !=
+             sizeof tlb_misses ) {
+          tlb_misses = 0;
+        }
+      }
+      if ( found != opt_n ) {
+        cerr << me << ": tlb: wrong number found\n";
+        exit( EX_SOFTWARE );
+      }
+
+      cout << left << setw(9) << e.name << setw(8) << a.name << right
+           << setw(10) << insert_ns << setw(9) << find_ns << setw(12);
+      if ( tlb_fd != -1 )
+        cout << setprecision(2)
+             << (double)tlb_misses / (double)(opt_n * passes)
+             << setprecision(1);
+      else
+        cout << "n/a";
+      cout << setw(9) << thp << '\n';
+      ht_cleanup( &table, nullptr );
+    } // for
+  } // for
+
+  if ( tlb_fd != -1 )
+    close( tlb_fd );
+}
+
+/**
+ * Compares ways to upsert #opt_n long (64-128 character) string keys each
+ * twice when the caller also needs each key's hash value (e.g., to route it):
+ * ht_find() then ht_insert() that hash it again vs. ht_find_or_insert() with
+ * the hash value already computed.  Then compares finding keys that are spans
+ * within a larger buffer by copying each into a temporary string vs.
+ * ht_find_key().
+ */
+static void bench_upsert() {
+  struct { char const *name; ht_engine_t engine; } const ENGINES[] = {
+    { "chained", HT_ENGINE_CHAINED },
+    { "open",    HT_ENGINE_OPEN    },
+  };
+  vector<string> const keys = shuffled_strings( 0, opt_n, 64, 128 );
+  vector<char const*> ops;
+  for ( size_t pass = 0; pass < 2; ++pass ) {
+    for ( string const &k : keys )
+      ops.push_back( k.c_str() );
+  } // for
+  shuffle( ops.begin(), ops.end(), mt19937_64{ 42 } );
+
+  // The keys as spans within one buffer, so none is NUL-terminated.
+  string buf;
+  vector<ht_span_t> spans;
+  for ( string const &k : keys )
+    buf += k;
+  for ( size_t i = 0, off = 0; i < keys.size(); off += keys[i++].size() )
+    spans.push_back( ht_span_t{ buf.data() + off, keys[i].size() } );
+
+  cout << "upsert: " << opt_n << " long string keys, each upserted twice\n"
+       << left << setw(9) << "table" << right << setw(12) << "find+insert"
+       << setw(14) << "find_or_ins" << setw(10) << "temp+find"
+       << setw(10) << "find_key" << '\n' << fixed << setprecision(1);
+
+  for ( auto const &e : ENGINES ) {
+    ht_options_t opt{};
+    opt.engine = e.engine;
+    auto const check_size = [&]( hash_table_t const *table ) {
+      if ( table->size != opt_n ) {
+        cerr << me << ": upsert: wrong number inserted\n";
+        exit( EX_SOFTWARE );
+      }
+    };
+    hash_table_t table;
+    ht_init_opt( &table, 1.0, 0, &ht_cmp_str, &ht_hash_str, &opt );
+    auto start = chrono::steady_clock::now();
+    for ( char const *k : ops ) {
+      size_t const len = strlen( k );
+      (void)ht_hash_bytes( k, len, 0 );     // the caller's own use of it
+      if ( ht_find( &table, k ) == nullptr ) {
+        ht_insert_rv_t const rv = ht_insert( &table, (void*)k, len + 1 );
+        memcpy( rv.entry->data, k, len + 1 );
+      }
+    } // for
+    double const rehash_ns = ns_per_op( start, ops.size() );
+    check_size( &table );
+    ht_cleanup( &table, nullptr );
+
+    ht_init_opt( &table, 1.0, 0, &ht_cmp_str, &ht_hash_str, &opt );
+    start = chrono::steady_clock::now();
+    for ( char const *k : ops ) {
+      size_t const len = strlen( k );
+      ht_find_or_insert( &table, k, len + 1, ht_hash_bytes( k, len, 0 ) );
+    } // for
+    double const once_ns = ns_per_op( start, ops.size() );
+    check_size( &table );
+
+    size_t found = 0;
+    start = chrono::steady_clock::now();
+    for ( ht_span_t const &span : spans ) {
+      string const temp{ static_cast<char const*>( span.ptr ), span.len };
+      found += ht_find( &table, temp.c_str() ) != nullptr;
+    } // for
+    double const temp_ns = ns_per_op( start, spans.size() );
+
+    start = chrono::steady_clock::now();
+    for ( ht_span_t const &span : spans ) {
+      found += ht_find_key(
+        &table, &span, ht_hash_span( &span ), &ht_cmp_span_str
+      ) != nullptr;
+    } // for
+    double const key_ns = ns_per_op( start, spans.size() );
+    if ( found != 2 * opt_n ) {
+      cerr << me << ": upsert: wrong number found\n";
+      exit( EX_SOFTWARE );
+    }
+    ht_cleanup( &table, nullptr );
+
+    cout << left << setw(9) << e.name << right << setw(12) << rehash_ns
+         << setw(14) << once_ns << setw(10) << temp_ns << setw(10) << key_ns
+         << '\n';
+  } // for
+}
+
+////////// main ///////////////////////////////////////////////////////////////
+
+int main( int argc, char *argv[] ) {
+  me = basename( argv[0] );
+  opt_threads = max( thread::hardware_concurrency(), 1u );
+
+  for ( int opt; (opt = getopt( argc, argv, "hn:t:" )) != EOF; ) {
+    switch ( opt ) {
+      case 'h':
+        print_usage( EX_OK );
+      case 'n':
+        opt_n = strtoull( optarg, nullptr, 10 );
+        break;
+      case 't':
+        opt_threads = (unsigned)strtoul( optarg, nullptr, 10 );
+        break;
+      default:
+        print_usage( EX_USAGE );
+    } // switch
+  } // for
+  if ( optind == argc || opt_n == 0 || opt_threads == 0 )
+    print_usage( EX_USAGE );
+
+  for ( ; optind < argc; ++optind ) {
+    string const workload = argv[ optind ];
+    if ( workload == "batch" )
+      bench_batch();
+    else if ( workload == "build" )
+      bench_build();
+    else if ( workload == "compact" )
+      bench_compact();
+    else if ( workload == "filter" )
+      bench_filter();
+    else if ( workload == "freeze" )
+      bench_freeze();
+    else if ( workload == "hash" )
+      bench_hash();
+    else if ( workload == "intern" )
+      bench_intern();
+    else if ( workload == "iterate" )
+      bench_iterate();
+    else if ( workload == "lru" )
+      bench_lru();
+    else if ( workload == "merge" )
+      bench_merge();
+    else if ( workload == "mt" )
+      bench_mt();
+    else if ( workload == "resize" )
+      bench_resize();
+    else if ( workload == "reuse" )
+      bench_reuse();
+    else if ( workload == "sizing" )
+      bench_sizing();
+    else if ( workload == "small" )
+      bench_small();
+    else if ( workload == "snapshot" )
+      bench_snapshot();
+    else if ( workload == "stats" )
+      bench_stats();
+    else if ( workload == "suite" )
+      bench_suite();
+    else if ( workload == "tlb" )
+      bench_tlb();
+    else if ( workload == "upsert" )
+      bench_upsert();
+    else
+      print_usage( EX_USAGE );
+  } // for
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,370 @@
+/*
+**      PJL Library
+**      src/ht_compact.c
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// local
+#include "ht_compact.h"
+
+// standard
+#include <assert.h>
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+////////// local constants ////////////////////////////////////////////////////
+
+/**
+ * Minimum number of buckets.
+ */
+#define HT_COMPACT_N_BUCKETS_MIN  8u
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Gets the base-2 logarithm of \a n rounded down.
+ *
+ * @param n The number.  It must not be 0.
+ * @return Returns said logarithm.
+ */
+static inline unsigned log2_u32( uint32_t n ) {
+  assert( n != 0 );
+#ifdef __GNUC__
+  return 31u - (unsigned)__builtin_clz( n );
+#else
+  unsigned log2 = 0;
+  while ( n >>= 1 )
+    ++log2;
+  return log2;
+#endif /* __GNUC__ */
+}
+
+/**
+ * Rounds \a n up to a multiple of \a align.
+ *
+ * @param n The number to round up.
+ * @param align The alignment; a power of 2.
+ * @return Returns said multiple.
+ */
+static inline size_t round_up( size_t n, size_t align ) {
+  return (n + align - 1) & ~(align - 1);
+}
+
+/**
+ * Gets the bucket index for a truncated hash value.
+ *
+ * @param table The compact hash table.
+ * @param h32 The truncated hash value.
+ * @return Returns said index.
+ */
+static inline size_t ht_compact_bucket_idx( ht_compact_t const *table,
+                                            uint32_t h32 ) {
+  return (size_t)(((uint64_t)h32 * HT_FIBONACCI) >> table->shift);
+}
+
+/**
+ * Hashes \a data truncating the hash value to 32 bits.
+ *
+ * @param table The compact hash table.
+ * @param data The data to hash.
+ * @return Returns said hash value.
+ */
+static inline uint32_t ht_compact_hash( ht_compact_t const *table,
+                                        void const *data ) {
+  ht_hash_val_t const hash = (*table->hash_fn)( data );
+  return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/**
+ * Gets the number of slots in a segment.
+ *
+ * @param seg The segment index.
+ * @return Returns said number.
+ */
+static inline size_t ht_compact_seg_n( unsigned seg ) {
+  return (size_t)1 << (seg == 0 ?
+    HT_COMPACT_SEG0_LOG2 : HT_COMPACT_SEG0_LOG2 + seg - 1);
+}
+
+/**
+ * Gets the segment index and the offset within it of the slot having index
+ * \a idx.  Segment 0 has slots [0, 2<sup>S</sup>) and segment _k_ &gt; 0 has
+ * slots [2<sup>S+k-1</sup>, 2<sup>S+k</sup>) where _S_ is
+ * #HT_COMPACT_SEG0_LOG2.
+ *
+ * @param idx The slot index.
+ * @param off A pointer to receive the offset within the segment.
+ * @return Returns the segment index.
+ */
+static inline unsigned ht_compact_seg( uint32_t idx, uint32_t *off ) {
+  if ( idx < (1u << HT_COMPACT_SEG0_LOG2) ) {
+    *off = idx;
+    return 0;
+  }
+  unsigned const log2 = log2_u32( idx );
+  *off = idx - (1u << log2);
+  return log2 - HT_COMPACT_SEG0_LOG2 + 1;
+}
+
+/**
+ * Gets the slot having index \a idx.
+ *
+ * @param table The compact hash table.
+ * @param idx The slot index.
+ * @return Returns a pointer to said slot.
+ */
+static inline char* ht_compact_slot( ht_compact_t const *table,
+                                     uint32_t idx ) {
+  uint32_t off;
+  unsigned const seg = ht_compact_seg( idx, &off );
+  return table->segs[ seg ] + (size_t)off * table->slot_size;
+}
+
+/**
+ * Gets a pointer to the index of the next slot in a slot's chain.  It's
+ * always the first member of a slot.
+ *
+ * @param slot The slot.
+ * @return Returns said pointer.
+ */
+static inline uint32_t* ht_compact_slot_next( char *slot ) {
+  return (uint32_t*)slot;
+}
+
+/**
+ * Gets a pointer to the truncated hash value of a slot.  It immediately
+ * follows the next index, if a table has stored hashes.
+ *
+ * @param slot The slot.
+ * @return Returns said pointer.
+ */
+static inline uint32_t* ht_compact_slot_hash( char *slot ) {
+  return (uint32_t*)slot + 1;
+}
+
+/**
+ * Allocates a slot, either from the free list or the next unused one.
+ *
+ * @param table The compact hash table.
+ * @return Returns the index of said slot.
+ */
+static uint32_t ht_compact_alloc( ht_compact_t *table ) {
+  uint32_t idx = table->free;
+  if ( idx != 0 ) {
+    table->free = *ht_compact_slot_next( ht_compact_slot( table, idx ) );
+    return idx;
+  }
+
+  idx = table->n_slots++;
+  assert( table->n_slots != 0 );        // overflowed 32-bit indices
+  uint32_t off;
+  unsigned const seg = ht_compact_seg( idx, &off );
+  if ( table->segs[ seg ] == NULL )
+    table->segs[ seg ] = malloc( ht_compact_seg_n( seg ) * table->slot_size );
+  return idx;
+}
+
+/**
+ * Grows a compact hash table to twice its number of buckets.  If the table
+ * has stored hashes, the hash function isn't called.
+ *
+ * @param table The compact hash table to grow.
+ */
+static void ht_compact_grow( ht_compact_t *table ) {
+  uint32_t *const old_buckets = table->buckets;
+  size_t const old_n_buckets = table->n_buckets;
+
+  table->n_buckets *= 2;
+  --table->shift;
+  table->buckets = calloc( table->n_buckets, sizeof(uint32_t) );
+
+  for ( size_t i = 0; i < old_n_buckets; ++i ) {
+    for ( uint32_t idx = old_buckets[i], next; idx != 0; idx = next ) {
+      char *const slot = ht_compact_slot( table, idx );
+      uint32_t *const slot_next = ht_compact_slot_next( slot );
+      next = *slot_next;
+      uint32_t const h32 = table->has_hash ?
+        *ht_compact_slot_hash( slot ) :
+        ht_compact_hash( table, slot + table->data_off );
+      uint32_t *const bucket =
+        &table->buckets[ ht_compact_bucket_idx( table, h32 ) ];
+      *slot_next = *bucket;
+      *bucket = idx;
+    } // for
+  } // for
+
+  free( old_buckets );
+}
+
+/**
+ * Finds the link (either a bucket or a slot's next index) that refers to the
+ * slot having data equal to \a data.
+ *
+ * @param table The compact hash table.
+ * @param h32 The truncated hash value of \a data.
+ * @param data The data to find.
+ * @return Returns a pointer to said link; or to the terminating link having
+ * the index 0 if not found.
+ */
+static uint32_t* ht_compact_link( ht_compact_t const *table, uint32_t h32,
+                                  void const *data ) {
+  uint32_t *link = &table->buckets[ ht_compact_bucket_idx( table, h32 ) ];
+  for ( uint32_t idx; (idx = *link) != 0; ) {
+    char *const slot = ht_compact_slot( table, idx );
+    if ( (!table->has_hash || *ht_compact_slot_hash( slot ) == h32) &&
+         (*table->cmp_fn)( slot + table->data_off, data ) == 0 ) {
+      break;
+    }
+    link = ht_compact_slot_next( slot );
+  } // for
+  return link;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+void ht_compact_cleanup( ht_compact_t *table ) {
+  if ( table == NULL )
+    return;
+  free( table->buckets );
+  for ( unsigned i = 0; i < HT_COMPACT_SEGS_MAX; ++i )
+    free( table->segs[i] );
+}
+
+bool ht_compact_delete( ht_compact_t *table, void const *data ) {
+  assert( table != NULL );
+  assert( data != NULL );
+
+  uint32_t *const link =
+    ht_compact_link( table, ht_compact_hash( table, data ), data );
+  uint32_t const idx = *link;
+  if ( idx == 0 )
+    return false;
+
+  uint32_t *const slot_next =
+    ht_compact_slot_next( ht_compact_slot( table, idx ) );
+  *link = *slot_next;
+  *slot_next = table->free;
+  table->free = idx;
+  --table->size;
+  return true;
+}
+
+void* ht_compact_find( ht_compact_t const *table, void const *data ) {
+  assert( table != NULL );
+  assert( data != NULL );
+
+  uint32_t const idx =
+    *ht_compact_link( table, ht_compact_hash( table, data ), data );
+  return idx != 0 ?
+    ht_compact_slot( table, idx ) + table->data_off : NULL;
+}
+
+void ht_compact_init( ht_compact_t *table, double max_lf, size_t est_size,
+                      size_t data_size, ht_cmp_fn_t cmp_fn,
+                      ht_hash_fn_t hash_fn, ht_compact_options_t const *opt ) {
+  assert( table != NULL );
+  assert( max_lf > 0.0 );
+  assert( data_size > 0 );
+  assert( cmp_fn != NULL );
+  assert( hash_fn != NULL );
+
+  static ht_compact_options_t const OPT_DEFAULT = { .hash_bits = 32 };
+  if ( opt == NULL )
+    opt = &OPT_DEFAULT;
+  assert( opt->hash_bits == 0 || opt->hash_bits == 32 );
+
+  size_t align = opt->data_align;
+  if ( align == 0 )
+    align = alignof(max_align_t);
+  assert( (align & (align - 1)) == 0 );
+  assert( align <= alignof(max_align_t) );
+
+  size_t n_buckets = HT_COMPACT_N_BUCKETS_MIN;
+  while ( n_buckets * max_lf < est_size )
+    n_buckets *= 2;
+
+  bool const has_hash = opt->hash_bits == 32;
+  size_t const data_off =
+    round_up( (1 + has_hash) * sizeof(uint32_t), align );
+
+  *table = (ht_compact_t){
+    .buckets = calloc( n_buckets, sizeof(uint32_t) ),
+    .n_buckets = n_buckets,
+    .shift = 64 - log2_u32( (uint32_t)n_buckets ),
+    .n_slots = 1,                       // slot 0 means "none"
+    .data_size = data_size,
+    .data_off = data_off,
+    .slot_size = round_up(
+      data_off + data_size,
+      align > sizeof(uint32_t) ? align : sizeof(uint32_t)
+    ),
+    .has_hash = has_hash,
+    .max_lf = max_lf,
+    .cmp_fn = cmp_fn,
+    .hash_fn = hash_fn
+  };
+}
+
+ht_compact_rv_t ht_compact_insert( ht_compact_t *table, void const *data ) {
+  assert( table != NULL );
+  assert( data != NULL );
+
+  uint32_t const h32 = ht_compact_hash( table, data );
+  uint32_t *const link = ht_compact_link( table, h32, data );
+  if ( *link != 0 ) {
+    return (ht_compact_rv_t){
+      ht_compact_slot( table, *link ) + table->data_off, false
+    };
+  }
+
+  // Allocating a slot never moves other slots, so link remains valid.
+  uint32_t const idx = ht_compact_alloc( table );
+  char *const slot = ht_compact_slot( table, idx );
+  *ht_compact_slot_next( slot ) = 0;
+  if ( table->has_hash )
+    *ht_compact_slot_hash( slot ) = h32;
+  memcpy( slot + table->data_off, data, table->data_size );
+  *link = idx;
+
+  if ( ++table->size > table->n_buckets * table->max_lf )
+    ht_compact_grow( table );
+  return (ht_compact_rv_t){ slot + table->data_off, true };
+}
+
+void ht_compact_iterator_init( ht_compact_iterator_t *it,
+                               ht_compact_t const *table ) {
+  assert( it != NULL );
+  assert( table != NULL );
+  *it = (ht_compact_iterator_t){ .table = table };
+}
+
+void* ht_compact_iterator_next( ht_compact_iterator_t *it ) {
+  assert( it != NULL );
+  ht_compact_t const *const table = it->table;
+  while ( it->next == 0 ) {
+    if ( it->bucket_idx >= table->n_buckets )
+      return NULL;
+    it->next = table->buckets[ it->bucket_idx++ ];
+  } // while
+  char *const slot = ht_compact_slot( table, it->next );
+  it->next = *ht_compact_slot_next( slot );
+  return slot + table->data_off;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
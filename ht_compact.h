@@ -0,0 +1,214 @@
+/*
+**      PJL Library
+**      src/ht_compact.h
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef pjl_ht_compact_H
+#define pjl_ht_compact_H
+
+/**
+ * @file
+ * Declares a compact hash table for very many small, fixed-size entries.
+ *
+ * Unlike a \ref hash_table "hash_table" entry that has two pointers, a 64-bit
+ * hash value, and data aligned to `max_align_t` (so an 8-byte key costs 48
+ * bytes), a compact entry has only a 32-bit index of the next entry in its
+ * chain, optionally a 32-bit truncated hash value, and data aligned only as
+ * much as the caller says.  Buckets are 32-bit indices too.  An 8-byte key
+ * costs 16 bytes (or 12 with 4-byte alignment and no stored hash) plus 4
+ * bytes per bucket.
+ *
+ * Entries are kept in slots of segments that double in size, so entries
+ * never move and pointers to their data remain valid until deleted.
+ */
+
+// local
+#include "hash_table.h"
+
+// standard
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Base-2 logarithm of the number of slots of the first segment.
+ */
+#define HT_COMPACT_SEG0_LOG2      6
+
+/**
+ * Maximum number of segments: enough for 2<sup>32</sup> slots.
+ */
+#define HT_COMPACT_SEGS_MAX       (32 - HT_COMPACT_SEG0_LOG2 + 1)
+
+////////// typedefs ///////////////////////////////////////////////////////////
+
+typedef struct ht_compact           ht_compact_t;
+typedef struct ht_compact_iterator  ht_compact_iterator_t;
+typedef struct ht_compact_options   ht_compact_options_t;
+typedef struct ht_compact_rv        ht_compact_rv_t;
+
+////////// structures /////////////////////////////////////////////////////////
+
+/**
+ * A compact hash table.
+ */
+struct ht_compact {
+  uint32_t     *buckets;                ///< First slot index of each or 0.
+  size_t        n_buckets;              ///< Number of buckets; power of 2.
+  unsigned      shift;                  ///< 64 minus log2 of n_buckets.
+  char         *segs[ HT_COMPACT_SEGS_MAX ]; ///< Segments of slots.
+  uint32_t      n_slots;                ///< Slots used so far (incl. 0).
+  uint32_t      free;                   ///< Free list of slots or 0.
+  size_t        size;                   ///< Number of entries.
+  size_t        data_size;              ///< Size of each entry's data.
+  size_t        data_off;               ///< Offset of data in a slot.
+  size_t        slot_size;              ///< Size of each slot.
+  bool          has_hash;               ///< Slots store truncated hashes?
+  double        max_lf;                 ///< Maximum load factor.
+  ht_cmp_fn_t   cmp_fn;                 ///< Comparison function.
+  ht_hash_fn_t  hash_fn;                ///< Hash function.
+};
+
+/**
+ * An iterator for an ht_compact.
+ */
+struct ht_compact_iterator {
+  ht_compact_t const *table;            ///< Table being iterated over.
+  size_t        bucket_idx;             ///< Next bucket index.
+  uint32_t      next;                   ///< Next slot index or 0.
+};
+
+/**
+ * Options for ht_compact_init().
+ */
+struct ht_compact_options {
+  /**
+   * The number of bits of each entry's hash value to store: 0 or 32.  With
+   * 32, most unequal entries are rejected without calling the comparison
+   * function and growing doesn't call the hash function.  With 0, each entry
+   * is 4 bytes smaller (if alignment permits).
+   */
+  unsigned      hash_bits;
+
+  /**
+   * The alignment of each entry's data: a power of 2 no greater than
+   * `alignof(max_align_t)`, or 0 for `alignof(max_align_t)`.
+   */
+  size_t        data_align;
+};
+
+/**
+ * The return value of ht_compact_insert().
+ */
+struct ht_compact_rv {
+  void         *data;                   ///< Data found or inserted.
+  bool          inserted;               ///< Was \ref data inserted?
+};
+
+////////// extern functions ///////////////////////////////////////////////////
+
+/**
+ * Cleans-up a compact hash table.
+ *
+ * @param table The table to clean up.  If NULL, does nothing.
+ *
+ * @sa ht_compact_init()
+ */
+void ht_compact_cleanup( ht_compact_t *table );
+
+/**
+ * Deletes the entry having data equal to \a data, if any.  This takes
+ * expected constant time since only \a data's chain is walked.
+ *
+ * @param table The table to delete from.
+ * @param data The data to delete.
+ * @return Returns `true` only if an entry was deleted.
+ */
+bool ht_compact_delete( ht_compact_t *table, void const *data );
+
+/**
+ * Attempts to find \a data within a compact hash table.
+ *
+ * @param table The table to search.
+ * @param data The data to search for.
+ * @return Returns a pointer to the data of the entry equal to \a data or NULL
+ * if not found.
+ */
+void* ht_compact_find( ht_compact_t const *table, void const *data );
+
+/**
+ * Initializes a compact hash table.
+ *
+ * @param table The table to initialize.
+ * @param max_lf The maximum load factor.
+ * @param est_size The estimated number of entries.
+ * @param data_size The size of every entry's data.
+ * @param cmp_fn The comparison function to use.
+ * @param hash_fn The hash function to use.
+ * @param opt The options to use or NULL for the defaults (a 32-bit stored
+ * hash and `max_align_t` alignment).
+ *
+ * @sa ht_compact_cleanup()
+ */
+void ht_compact_init( ht_compact_t *table, double max_lf, size_t est_size,
+                      size_t data_size, ht_cmp_fn_t cmp_fn,
+                      ht_hash_fn_t hash_fn, ht_compact_options_t const *opt );
+
+/**
+ * Attempts to insert \a data into \a table.
+ *
+ * @param table The table to insert into.
+ * @param data The data to insert.  Unlike ht_insert(), it's copied into the
+ * new entry.
+ * @return Returns the data of the entry either found or inserted.
+ */
+ht_compact_rv_t ht_compact_insert( ht_compact_t *table, void const *data );
+
+/**
+ * Initializes an iterator for a compact hash table.
+ *
+ * @param it The iterator to initialize.
+ * @param table The table to iterate over.
+ *
+ * @sa ht_compact_iterator_next()
+ */
+void ht_compact_iterator_init( ht_compact_iterator_t *it,
+                               ht_compact_t const *table );
+
+/**
+ * Gets the data of the next entry, if any.
+ *
+ * @param it The iterator.
+ * @return Returns a pointer to said data or NULL if none.
+ *
+ * @sa ht_compact_iterator_init()
+ */
+void* ht_compact_iterator_next( ht_compact_iterator_t *it );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef __cplusplus
+} // extern "C"
+#endif /* __cplusplus */
+
+#endif /* pjl_ht_compact_H */
+/* vim:set et sw=2 ts=2: */
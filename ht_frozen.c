@@ -0,0 +1,448 @@
+/*
+**      PJL Library
+**      src/ht_frozen.c
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// local
+#include "ht_frozen.h"
+
+// standard
+#include <assert.h>
+#include <errno.h>
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+////////// local constants ////////////////////////////////////////////////////
+
+/**
+ * Load factor of the slots pilots place into: less than 1 so the last
+ * buckets placed find free slots quickly.
+ */
+#define HT_FROZEN_ALPHA           0.97
+
+/**
+ * Number of buckets per entry times the base-2 logarithm of the number of
+ * entries: more buckets means smaller pilots, but more of them.
+ */
+#define HT_FROZEN_C               6.0
+
+/**
+ * Fraction of entries in the dense buckets.
+ */
+#define HT_FROZEN_DENSE_KEYS      0.6
+
+/**
+ * Fraction of buckets that are dense.
+ */
+#define HT_FROZEN_DENSE_BUCKETS   0.3
+
+/**
+ * Maximum pilot tried for any bucket before trying another seed.
+ */
+#define HT_FROZEN_PILOT_MAX       (1u << 24)
+
+/**
+ * Number of seeds tried before giving up.
+ */
+#define HT_FROZEN_SEEDS_MAX       8u
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Mixes the bits of \a k so that every bit of the result depends on every bit
+ * of \a k.
+ *
+ * @param k The value to mix.
+ * @return Returns said value.
+ */
+static inline uint64_t ht_frozen_mix( uint64_t k ) {
+  k ^= k >> 33;
+  k *= 0xFF51AFD7ED558CCDull;
+  k ^= k >> 33;
+  k *= 0xC4CEB9FE1A85EC53ull;
+  k ^= k >> 33;
+  return k;
+}
+
+/**
+ * Reduces \a x to [0, \a n) using its high bits.
+ *
+ * @param x The value to reduce.
+ * @param n The size of the range.
+ * @return Returns said reduced value.
+ */
+static inline uint64_t ht_frozen_range( uint64_t x, uint64_t n ) {
+#ifdef __SIZEOF_INT128__
+  return (uint64_t)(((__uint128_t)x * n) >> 64);
+#else
+  return x % n;
+#endif /* __SIZEOF_INT128__ */
+}
+
+/**
+ * Gets the bucket of a mixed hash value: #HT_FROZEN_DENSE_KEYS of them go to
+ * the first #HT_FROZEN_DENSE_BUCKETS of buckets.
+ *
+ * @param frozen The hash index.
+ * @param h The mixed hash value.
+ * @return Returns said bucket.
+ */
+static inline size_t ht_frozen_bucket( ht_frozen_t const *frozen,
+                                       uint64_t h ) {
+  uint64_t const u = (uint32_t)h;
+  return (h >> 32) < (uint64_t)(HT_FROZEN_DENSE_KEYS * 4294967296.0) ?
+    (size_t)((u * frozen->n_dense) >> 32) :
+    frozen->n_dense +
+      (size_t)((u * (frozen->n_buckets - frozen->n_dense)) >> 32);
+}
+
+/**
+ * Gets the pilot of a bucket.
+ *
+ * @param frozen The hash index.
+ * @param b The bucket.
+ * @return Returns said pilot.
+ */
+static inline uint32_t ht_frozen_pilot( ht_frozen_t const *frozen,
+                                        size_t b ) {
+  switch ( frozen->pilot_bytes ) {
+    case 1:
+      return ((uint8_t const*)frozen->pilots)[b];
+    case 2:
+      return ((uint16_t const*)frozen->pilots)[b];
+    default:
+      return ((uint32_t const*)frozen->pilots)[b];
+  } // switch
+}
+
+/**
+ * Gets the slot a mixed hash value is placed into by a pilot.
+ *
+ * @param frozen The hash index.
+ * @param h The mixed hash value.
+ * @param pilot The pilot of \a h's bucket.
+ * @return Returns said slot in [0, \ref ht_frozen::n_slots "n_slots").
+ */
+static inline size_t ht_frozen_slot( ht_frozen_t const *frozen, uint64_t h,
+                                     uint32_t pilot ) {
+  uint64_t const p = ht_frozen_mix( pilot ^ frozen->seed );
+  return (size_t)ht_frozen_range( (h ^ p) * HT_FIBONACCI, frozen->n_slots );
+}
+
+/**
+ * Compares two hash values for qsort(3).
+ *
+ * @param i_data A pointer to the first hash value.
+ * @param j_data A pointer to the second hash value.
+ * @return Returns a number less than 0, 0, or greater than 0 if \a i_data is
+ * less than, equal to, or greater than \a j_data, respectively.
+ */
+static int ht_hash_cmp( void const *i_data, void const *j_data ) {
+  ht_hash_val_t const i = *(ht_hash_val_t const*)i_data;
+  ht_hash_val_t const j = *(ht_hash_val_t const*)j_data;
+  return (i > j) - (i < j);
+}
+
+/**
+ * Attempts to find a pilot for every bucket using \ref ht_frozen::seed
+ * "seed".
+ *
+ * @param frozen The hash index whose \ref ht_frozen::size "size", \ref
+ * ht_frozen::n_slots "n_slots", \ref ht_frozen::n_buckets "n_buckets", \ref
+ * ht_frozen::n_dense "n_dense", and \ref ht_frozen::seed "seed" have been
+ * set.  On success, its pilots and remap array are set.
+ * @param hashes The hash value of each entry.
+ * @param slots Set to the slot in [0, \ref ht_frozen::size "size") of each
+ * entry.
+ * @return Returns `true` only if successful.
+ */
+static bool ht_frozen_build( ht_frozen_t *frozen, ht_hash_val_t const *hashes,
+                             uint32_t *slots ) {
+  size_t const n = frozen->size;
+  size_t const n_buckets = frozen->n_buckets;
+  uint64_t *const h = malloc( n * sizeof(uint64_t) );
+  size_t *const bucket_start = calloc( n_buckets + 1, sizeof(size_t) );
+  uint32_t *const keys = malloc( n * sizeof(uint32_t) );
+  uint32_t *const pilots = malloc( n_buckets * sizeof(uint32_t) );
+  uint64_t *const taken = calloc( (frozen->n_slots + 63) / 64, 8 );
+  size_t *by_size = NULL, *size_start = NULL, *positions = NULL;
+  bool ok = false;
+
+  //
+  // Group entries by bucket with a counting sort: count, prefix sum, then
+  // scatter (leaving each start at its bucket's end, so it's then moved back
+  // by one).
+  //
+  size_t max_size = 0;
+  for ( size_t i = 0; i < n; ++i ) {
+    h[i] = ht_frozen_mix( hashes[i] ^ frozen->seed );
+    size_t const len = ++bucket_start[ ht_frozen_bucket( frozen, h[i] ) + 1 ];
+    if ( len > max_size )
+      max_size = len;
+  } // for
+  for ( size_t b = 0; b < n_buckets; ++b )
+    bucket_start[ b + 1 ] += bucket_start[b];
+  for ( size_t i = 0; i < n; ++i )
+    keys[ bucket_start[ ht_frozen_bucket( frozen, h[i] ) ]++ ] = (uint32_t)i;
+  for ( size_t b = n_buckets; b > 0; --b )
+    bucket_start[b] = bucket_start[ b - 1 ];
+  bucket_start[0] = 0;
+
+  // Order buckets by decreasing size, again by counting sort.
+  by_size = malloc( n_buckets * sizeof(size_t) );
+  size_start = calloc( max_size + 2, sizeof(size_t) );
+  for ( size_t b = 0; b < n_buckets; ++b )
+    ++size_start[ max_size - (bucket_start[ b + 1 ] - bucket_start[b]) + 1 ];
+  for ( size_t s = 0; s <= max_size; ++s )
+    size_start[ s + 1 ] += size_start[s];
+  for ( size_t b = 0; b < n_buckets; ++b ) {
+    size_t const s = max_size - (bucket_start[ b + 1 ] - bucket_start[b]);
+    by_size[ size_start[s]++ ] = b;
+  } // for
+
+  positions = malloc( (max_size + 1) * sizeof(size_t) );
+  uint32_t max_pilot = 0;
+
+  for ( size_t i = 0; i < n_buckets; ++i ) {
+    size_t const b = by_size[i];
+    size_t const begin = bucket_start[b], len = bucket_start[ b + 1 ] - begin;
+    pilots[b] = 0;
+    if ( len == 0 )
+      continue;
+    uint32_t pilot = 0;
+    for ( ;; ++pilot ) {
+      if ( pilot == HT_FROZEN_PILOT_MAX )
+        goto done;
+      size_t j = 0;
+      for ( ; j < len; ++j ) {
+        size_t const s =
+          ht_frozen_slot( frozen, h[ keys[ begin + j ] ], pilot );
+        if ( (taken[ s / 64 ] >> (s % 64)) & 1 )
+          break;
+        size_t k = 0;
+        while ( k < j && positions[k] != s )
+          ++k;
+        if ( k < j )
+          break;
+        positions[j] = s;
+      } // for
+      if ( j == len )
+        break;
+    } // for
+    for ( size_t j = 0; j < len; ++j ) {
+      taken[ positions[j] / 64 ] |= (uint64_t)1 << (positions[j] % 64);
+      slots[ keys[ begin + j ] ] = (uint32_t)positions[j];
+    } // for
+    pilots[b] = pilot;
+    if ( pilot > max_pilot )
+      max_pilot = pilot;
+  } // for
+
+  //
+  // Each entry placed into [n, n_slots) is remapped to a free slot in
+  // [0, n): there are exactly as many of the latter as the former.  A miss
+  // can also land on a slot in [n, n_slots) no entry was placed into, so
+  // those are mapped to slot 0, which is as good as any.
+  //
+  frozen->remap = calloc( frozen->n_slots - n, sizeof(uint32_t) );
+  size_t free_s = 0;
+  for ( size_t s = n; s < frozen->n_slots; ++s ) {
+    if ( ((taken[ s / 64 ] >> (s % 64)) & 1) == 0 )
+      continue;
+    while ( (taken[ free_s / 64 ] >> (free_s % 64)) & 1 )
+      ++free_s;
+    frozen->remap[ s - n ] = (uint32_t)free_s++;
+  } // for
+  for ( size_t i = 0; i < n; ++i ) {
+    if ( slots[i] >= n )
+      slots[i] = frozen->remap[ slots[i] - n ];
+  } // for
+
+  frozen->pilot_bytes = max_pilot <= UINT8_MAX ? 1 :
+                        max_pilot <= UINT16_MAX ? 2 : 4;
+  frozen->pilots = malloc( n_buckets * frozen->pilot_bytes );
+  for ( size_t b = 0; b < n_buckets; ++b ) {
+    switch ( frozen->pilot_bytes ) {
+      case 1:
+        ((uint8_t*)frozen->pilots)[b] = (uint8_t)pilots[b];
+        break;
+      case 2:
+        ((uint16_t*)frozen->pilots)[b] = (uint16_t)pilots[b];
+        break;
+      default:
+        ((uint32_t*)frozen->pilots)[b] = pilots[b];
+        break;
+    } // switch
+  } // for
+  ok = true;
+
+done:
+  free( h );
+  free( bucket_start );
+  free( keys );
+  free( pilots );
+  free( taken );
+  free( by_size );
+  free( size_start );
+  free( positions );
+  return ok;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+bool ht_freeze( hash_table_t *table, ht_frozen_t *frozen ) {
+  assert( table != NULL );
+  assert( frozen != NULL );
+  assert( table->size < UINT32_MAX );
+
+  size_t const n = table->size;
+  *frozen = (ht_frozen_t){
+    .size = n,
+    .cmp_fn = table->cmp_fn,
+    .hash_fn = table->hash_fn
+  };
+  if ( n == 0 )
+    return true;
+
+  ht_entry_t const **const entries = malloc( n * sizeof(ht_entry_t*) );
+  ht_hash_val_t *const hashes = malloc( n * sizeof(ht_hash_val_t) );
+  uint32_t *const slots = malloc( n * sizeof(uint32_t) );
+  bool ok = false;
+
+  ht_iterator_t it;
+  ht_iterator_init( &it, table );
+  bool same_size = true;
+  size_t i = 0;
+  for ( ht_entry_t const *entry; (entry = ht_iterator_next( &it )) != NULL;
+        ++i ) {
+    entries[i] = entry;
+    hashes[i] = entry->hash;
+    same_size = same_size && entry->data_size == entries[0]->data_size;
+  } // for
+
+  // Entries having equal hash values can never be given distinct slots.
+  qsort( hashes, n, sizeof(ht_hash_val_t), &ht_hash_cmp );
+  for ( i = 1; i < n; ++i ) {
+    if ( hashes[i] == hashes[ i - 1 ] ) {
+      errno = EINVAL;
+      goto done;
+    }
+  } // for
+  for ( i = 0; i < n; ++i )
+    hashes[i] = entries[i]->hash;
+
+  size_t log2 = 1;
+  while ( ((size_t)1 << log2) < n )
+    ++log2;
+  frozen->n_slots = (size_t)((double)n / HT_FROZEN_ALPHA) + 1;
+  frozen->n_buckets = (size_t)(HT_FROZEN_C * (double)n / (double)log2) + 2;
+  frozen->n_dense =
+    (size_t)(HT_FROZEN_DENSE_BUCKETS * (double)frozen->n_buckets) + 1;
+
+  for ( unsigned s = 0; ; ++s ) {
+    if ( s == HT_FROZEN_SEEDS_MAX ) {
+      errno = EAGAIN;
+      goto done;
+    }
+    frozen->seed = ht_frozen_mix( s + 1 );
+    if ( ht_frozen_build( frozen, hashes, slots ) )
+      break;
+  } // for
+
+  if ( same_size ) {
+    frozen->stride = entries[0]->data_size;
+    frozen->payload = malloc( n * frozen->stride );
+    for ( i = 0; i < n; ++i ) {
+      memcpy( frozen->payload + (size_t)slots[i] * frozen->stride,
+              entries[i]->data, frozen->stride );
+    } // for
+  }
+  else {
+    size_t const align = alignof(max_align_t);
+    uint64_t *const sizes = calloc( n, sizeof(uint64_t) );
+    for ( i = 0; i < n; ++i )
+      sizes[ slots[i] ] = (entries[i]->data_size + align - 1) & ~(align - 1);
+    frozen->offsets = malloc( n * sizeof(uint64_t) );
+    uint64_t off = 0;
+    for ( i = 0; i < n; ++i ) {
+      frozen->offsets[i] = off;
+      off += sizes[i];
+    } // for
+    free( sizes );
+    frozen->payload = malloc( off );
+    for ( i = 0; i < n; ++i ) {
+      memcpy( frozen->payload + frozen->offsets[ slots[i] ],
+              entries[i]->data, entries[i]->data_size );
+    } // for
+  }
+  ok = true;
+
+done:
+  free( entries );
+  free( hashes );
+  free( slots );
+  if ( !ok ) {
+    int const saved_errno = errno;
+    ht_frozen_cleanup( frozen );
+    errno = saved_errno;
+  }
+  return ok;
+}
+
+void ht_frozen_cleanup( ht_frozen_t *frozen ) {
+  if ( frozen == NULL )
+    return;
+  free( frozen->pilots );
+  free( frozen->remap );
+  free( frozen->payload );
+  free( frozen->offsets );
+  *frozen = (ht_frozen_t){ 0 };
+}
+
+void const* ht_frozen_find( ht_frozen_t const *frozen, void const *data ) {
+  assert( frozen != NULL );
+  assert( data != NULL );
+
+  if ( frozen->size == 0 )
+    return NULL;
+
+  uint64_t const h = ht_frozen_mix( (*frozen->hash_fn)( data ) ^ frozen->seed );
+  size_t s = ht_frozen_slot(
+    frozen, h, ht_frozen_pilot( frozen, ht_frozen_bucket( frozen, h ) )
+  );
+  if ( s >= frozen->size )
+    s = frozen->remap[ s - frozen->size ];
+
+  char const *const found = frozen->stride != 0 ?
+    frozen->payload + s * frozen->stride :
+    frozen->payload + frozen->offsets[s];
+  return (*frozen->cmp_fn)( data, found ) == 0 ? found : NULL;
+}
+
+size_t ht_frozen_index_bytes( ht_frozen_t const *frozen ) {
+  assert( frozen != NULL );
+  if ( frozen->size == 0 )
+    return 0;
+  return frozen->n_buckets * frozen->pilot_bytes +
+         (frozen->n_slots - frozen->size) * sizeof(uint32_t) +
+         (frozen->stride == 0 ? frozen->size * sizeof(uint64_t) : 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,139 @@
+/*
+**      PJL Library
+**      src/ht_frozen.h
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef pjl_ht_frozen_H
+#define pjl_ht_frozen_H
+
+/**
+ * @file
+ * Declares an immutable hash index made from a populated \ref hash_table
+ * "hash_table" by ht_freeze() for tables that are built once, then only read.
+ *
+ * It's a minimal perfect hash function in the style of PTHash that maps each
+ * of the _n_ entries' hash values to a distinct index in [0, _n_) plus the
+ * entries' data in a contiguous array in that order.  A lookup is then
+ * exactly one probe of the array and one call of the comparison function.
+ *
+ * The function itself takes a few bits per entry:
+ *
+ *  + Hash values are distributed among about 6<i>n</i>/log<sub>2</sub><i>n</i>
+ *    buckets such that 60% of them are in 30% of the buckets.
+ *  + Largest buckets first, each bucket gets the smallest "pilot" value that
+ *    places all its hash values in free slots of [0, _n_/0.97).
+ *  + The 3% of entries placed in [_n_, _n_/0.97) are remapped to the free
+ *    slots in [0, _n_).
+ *
+ * Pilots are stored using 1, 2, or 4 bytes each, whichever is enough for the
+ * largest.
+ */
+
+// local
+#include "hash_table.h"
+
+// standard
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+////////// typedefs ///////////////////////////////////////////////////////////
+
+typedef struct ht_frozen      ht_frozen_t;
+
+////////// structures /////////////////////////////////////////////////////////
+
+/**
+ * An immutable hash index.
+ */
+struct ht_frozen {
+  size_t        size;                   ///< Number of entries.
+  size_t        n_slots;                ///< Slots pilots place into.
+  size_t        n_buckets;              ///< Number of buckets.
+  size_t        n_dense;                ///< Buckets for 60% of entries.
+  uint64_t      seed;                   ///< Seed that succeeded.
+  void         *pilots;                 ///< Pilot of each bucket.
+  unsigned      pilot_bytes;            ///< Bytes per pilot: 1, 2, or 4.
+  uint32_t     *remap;                  ///< Slots for [size, n_slots).
+  char         *payload;                ///< Entries' data by index.
+  size_t        stride;                 ///< Size of all data or 0.
+  uint64_t     *offsets;                ///< If !stride, data offsets.
+  ht_cmp_fn_t   cmp_fn;                 ///< Comparison function.
+  ht_hash_fn_t  hash_fn;                ///< Hash function.
+};
+
+////////// extern functions ///////////////////////////////////////////////////
+
+/**
+ * Makes an immutable hash index of all the entries of \a table.
+ *
+ * If all entries' data are the same size, the data are stored with no space
+ * between them and each is aligned to the largest power of 2 that divides
+ * its size (up to `alignof(max_align_t)`); otherwise, each is aligned to
+ * `alignof(max_align_t)` and found via an array of offsets.
+ *
+ * @param table The hash table to freeze.  It isn't modified.  Since the data
+ * of its entries are copied byte for byte, if they contain pointers to other
+ * memory, \a table should be cleaned up without freeing it.
+ * @param frozen The hash index to initialize.
+ * @return Returns `true` only if successful.  If two entries of \a table have
+ * equal hash values, returns `false` with \c errno set to \c EINVAL.
+ *
+ * @sa ht_frozen_cleanup()
+ */
+bool ht_freeze( hash_table_t *table, ht_frozen_t *frozen );
+
+/**
+ * Cleans-up a hash index.
+ *
+ * @param frozen The hash index to clean up.  If NULL, does nothing.
+ *
+ * @sa ht_freeze()
+ */
+void ht_frozen_cleanup( ht_frozen_t *frozen );
+
+/**
+ * Attempts to find \a data within a hash index.
+ *
+ * @param frozen The hash index to search.
+ * @param data The data to search for.
+ * @return Returns a pointer to the data equal to \a data or NULL if not
+ * found.
+ */
+void const* ht_frozen_find( ht_frozen_t const *frozen, void const *data );
+
+/**
+ * Gets the number of bytes used by a hash index other than for its data.
+ *
+ * @param frozen The hash index.
+ * @return Returns said number.
+ */
+size_t ht_frozen_index_bytes( ht_frozen_t const *frozen );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef __cplusplus
+} // extern "C"
+#endif /* __cplusplus */
+
+#endif /* pjl_ht_frozen_H */
+/* vim:set et sw=2 ts=2: */
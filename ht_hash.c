@@ -0,0 +1,235 @@
+/*
+**      PJL Library
+**      src/ht_hash.c
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// local
+#include "ht_hash.h"
+
+// standard
+#include <assert.h>
+#include <string.h>
+
+#ifdef __GNUC__
+# define likely(EXPR)             __builtin_expect( !!(EXPR), 1 )
+# define unlikely(EXPR)           __builtin_expect( !!(EXPR), 0 )
+#else
+# define likely(EXPR)             (EXPR)
+# define unlikely(EXPR)           (EXPR)
+#endif /* __GNUC__ */
+
+////////// local constants ////////////////////////////////////////////////////
+
+/**
+ * wyhash's default secret: four 64-bit odd numbers each having 32 bits set.
+ */
+static uint64_t const HT_WYP[] = {
+  0x2D358DCCAA6C78A5ull, 0x8BB84B93962EACC9ull,
+  0x4B33A62ED433D4A3ull, 0x4D5A2DA51DE1AA47ull
+};
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Multiplies \a a by \a b yielding a 128-bit product.
+ *
+ * @param a A pointer to the first factor; set to the low 64 bits.
+ * @param b A pointer to the second factor; set to the high 64 bits.
+ */
+static inline void ht_mum( uint64_t *a, uint64_t *b ) {
+#ifdef __SIZEOF_INT128__
+  __uint128_t const r = (__uint128_t)*a * *b;
+  *a = (uint64_t)r;
+  *b = (uint64_t)(r >> 64);
+#else
+  uint64_t const ha = *a >> 32, la = (uint32_t)*a;
+  uint64_t const hb = *b >> 32, lb = (uint32_t)*b;
+  uint64_t const rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t const t = rl + (rm0 << 32);
+  uint64_t const lo = t + (rm1 << 32);
+  uint64_t const c = (t < rl) + (lo < t);
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif /* __SIZEOF_INT128__ */
+}
+
+/**
+ * Multiplies \a a by \a b and folds the 128-bit product to 64 bits.
+ *
+ * @param a The first factor.
+ * @param b The second factor.
+ * @return Returns the high and low 64 bits of the product XOR'd.
+ */
+static inline uint64_t ht_mix( uint64_t a, uint64_t b ) {
+  ht_mum( &a, &b );
+  return a ^ b;
+}
+
+/**
+ * Reads 1 to 3 bytes into the low 24 bits of a value.
+ *
+ * @param p A pointer to the bytes.
+ * @param n The number of bytes: 1-3.
+ * @return Returns said value.
+ */
+static inline uint64_t ht_read3( uint8_t const *p, size_t n ) {
+  return ((uint64_t)p[0] << 16) | ((uint64_t)p[ n >> 1 ] << 8) | p[ n - 1 ];
+}
+
+/**
+ * Reads 4 bytes without regard to alignment.
+ *
+ * @param p A pointer to the bytes.
+ * @return Returns said bytes as a value.
+ */
+static inline uint64_t ht_read4( uint8_t const *p ) {
+  uint32_t v;
+  memcpy( &v, p, sizeof v );
+  return v;
+}
+
+/**
+ * Reads 8 bytes without regard to alignment.
+ *
+ * @param p A pointer to the bytes.
+ * @return Returns said bytes as a value.
+ */
+static inline uint64_t ht_read8( uint8_t const *p ) {
+  uint64_t v;
+  memcpy( &v, p, sizeof v );
+  return v;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+int ht_cmp_span( void const *i_data, void const *j_data ) {
+  ht_span_t const *const i = i_data;
+  ht_span_t const *const j = j_data;
+  size_t const n = i->len < j->len ? i->len : j->len;
+  int const cmp = n > 0 ? memcmp( i->ptr, j->ptr, n ) : 0;
+  return cmp != 0 ? cmp : (i->len > j->len) - (i->len < j->len);
+}
+
+int ht_cmp_span_str( void const *i_data, void const *j_data ) {
+  ht_span_t const *const i = i_data;
+  // Reading at most one byte past the span's length stops at a shorter string.
+  size_t const j_len = strnlen( j_data, i->len + 1 );
+  size_t const n = i->len < j_len ? i->len : j_len;
+  int const cmp = n > 0 ? memcmp( i->ptr, j_data, n ) : 0;
+  return cmp != 0 ? cmp : (i->len > j_len) - (i->len < j_len);
+}
+
+int ht_cmp_str( void const *i_data, void const *j_data ) {
+  return strcmp( i_data, j_data );
+}
+
+int ht_cmp_u32( void const *i_data, void const *j_data ) {
+  uint32_t i, j;
+  memcpy( &i, i_data, sizeof i );
+  memcpy( &j, j_data, sizeof j );
+  return (i > j) - (i < j);
+}
+
+int ht_cmp_u64( void const *i_data, void const *j_data ) {
+  uint64_t i, j;
+  memcpy( &i, i_data, sizeof i );
+  memcpy( &j, j_data, sizeof j );
+  return (i > j) - (i < j);
+}
+
+ht_hash_val_t ht_hash_bytes( void const *p, size_t n, uint64_t seed ) {
+  assert( p != NULL || n == 0 );
+  uint8_t const *b = p;
+  uint64_t x, y;
+
+  seed ^= ht_mix( seed ^ HT_WYP[0], HT_WYP[1] );
+
+  if ( likely( n <= 16 ) ) {
+    if ( likely( n >= 4 ) ) {
+      // Two overlapping 4-byte reads from each end cover 4-16 bytes.
+      size_t const d = (n >> 3) << 2;
+      x = (ht_read4( b ) << 32) | ht_read4( b + d );
+      y = (ht_read4( b + n - 4 ) << 32) | ht_read4( b + n - 4 - d );
+    } else if ( likely( n > 0 ) ) {
+      x = ht_read3( b, n );
+      y = 0;
+    } else {
+      x = y = 0;
+    }
+  } else {
+    size_t i = n;
+    if ( unlikely( i > 48 ) ) {
+      uint64_t seed1 = seed, seed2 = seed;
+      do {
+        seed  = ht_mix( ht_read8( b      ) ^ HT_WYP[1],
+                        ht_read8( b +  8 ) ^ seed );
+        seed1 = ht_mix( ht_read8( b + 16 ) ^ HT_WYP[2],
+                        ht_read8( b + 24 ) ^ seed1 );
+        seed2 = ht_mix( ht_read8( b + 32 ) ^ HT_WYP[3],
+                        ht_read8( b + 40 ) ^ seed2 );
+        b += 48;
+        i -= 48;
+      } while ( likely( i > 48 ) );
+      seed ^= seed1 ^ seed2;
+    }
+    for ( ; unlikely( i > 16 ); b += 16, i -= 16 )
+      seed = ht_mix( ht_read8( b ) ^ HT_WYP[1], ht_read8( b + 8 ) ^ seed );
+    // The last 16 bytes, possibly overlapping bytes already hashed.
+    x = ht_read8( b + i - 16 );
+    y = ht_read8( b + i - 8 );
+  }
+
+  x ^= HT_WYP[1];
+  y ^= seed;
+  ht_mum( &x, &y );
+  return ht_mix( x ^ HT_WYP[0] ^ n, y ^ HT_WYP[1] );
+}
+
+ht_hash_val_t ht_hash_mix( uint64_t k ) {
+  // murmur3's 64-bit finalizer.
+  k ^= k >> 33;
+  k *= 0xFF51AFD7ED558CCDull;
+  k ^= k >> 33;
+  k *= 0xC4CEB9FE1A85EC53ull;
+  k ^= k >> 33;
+  return k;
+}
+
+ht_hash_val_t ht_hash_span( void const *data ) {
+  ht_span_t const *const span = data;
+  return ht_hash_bytes( span->ptr, span->len, 0 );
+}
+
+ht_hash_val_t ht_hash_str( void const *data ) {
+  return ht_hash_bytes( data, strlen( data ), 0 );
+}
+
+ht_hash_val_t ht_hash_u32( void const *data ) {
+  uint32_t k;
+  memcpy( &k, data, sizeof k );
+  return ht_hash_mix( k );
+}
+
+ht_hash_val_t ht_hash_u64( void const *data ) {
+  uint64_t k;
+  memcpy( &k, data, sizeof k );
+  return ht_hash_mix( k );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
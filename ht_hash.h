@@ -0,0 +1,196 @@
+/*
+**      PJL Library
+**      src/ht_hash.h
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef pjl_ht_hash_H
+#define pjl_ht_hash_H
+
+/**
+ * @file
+ * Declares ready-made hash and comparison functions for \ref hash_table
+ * "hash_table" keys that are fixed-width integers, NUL-terminated strings, or
+ * byte spans.
+ *
+ * Every hash function is built on ht_hash_bytes() or ht_hash_mix() and so has
+ * well distributed high _and_ low bits: they can be used with either
+ * #HT_SIZING_PRIME or #HT_SIZING_POW2 and with ht_sharded.
+ *
+ * @remarks Hash values depend on the machine's endianness.
+ */
+
+// local
+#include "hash_table.h"
+
+// standard
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+////////// typedefs ///////////////////////////////////////////////////////////
+
+typedef struct ht_span        ht_span_t;
+
+////////// structures /////////////////////////////////////////////////////////
+
+/**
+ * A span of bytes used as a key by ht_cmp_span() and ht_hash_span().  The
+ * span (not the bytes) is what's stored as an entry's data.
+ */
+struct ht_span {
+  void const *ptr;                      ///< Pointer to the bytes.
+  size_t      len;                      ///< Number of bytes.
+};
+
+////////// extern functions ///////////////////////////////////////////////////
+
+/**
+ * Compares the spans \a i_data and \a j_data (each an ht_span) by their bytes.
+ *
+ * @param i_data A pointer to the first span.
+ * @param j_data A pointer to the second span.
+ * @return Returns a number less than 0, 0, or greater than 0 if the bytes of
+ * \a i_data are less than, equal to, or greater than those of \a j_data,
+ * respectively.  A span that's a prefix of another is less.
+ *
+ * @sa ht_hash_span()
+ */
+int ht_cmp_span( void const *i_data, void const *j_data );
+
+/**
+ * Compares the span \a i_data (an ht_span) with the NUL-terminated string \a
+ * j_data by their bytes.  It can be passed to ht_find_key() to look up a span
+ * in a table of strings that uses ht_cmp_str() and ht_hash_str(), with
+ * ht_hash_span() of the span as its hash value.
+ *
+ * @param i_data A pointer to the span.
+ * @param j_data A pointer to the string.
+ * @return Returns a number less than 0, 0, or greater than 0 if the bytes of
+ * \a i_data are less than, equal to, or greater than those of \a j_data,
+ * respectively.
+ */
+int ht_cmp_span_str( void const *i_data, void const *j_data );
+
+/**
+ * Compares the NUL-terminated strings \a i_data and \a j_data.
+ *
+ * @param i_data A pointer to the first string.
+ * @param j_data A pointer to the second string.
+ * @return Returns the same as strcmp(3).
+ *
+ * @sa ht_hash_str()
+ */
+int ht_cmp_str( void const *i_data, void const *j_data );
+
+/**
+ * Compares the `uint32_t` values pointed to by \a i_data and \a j_data.
+ *
+ * @param i_data A pointer to the first value.
+ * @param j_data A pointer to the second value.
+ * @return Returns a number less than 0, 0, or greater than 0 if \a i_data is
+ * less than, equal to, or greater than \a j_data, respectively.
+ *
+ * @sa ht_hash_u32()
+ */
+int ht_cmp_u32( void const *i_data, void const *j_data );
+
+/**
+ * Compares the `uint64_t` values pointed to by \a i_data and \a j_data.
+ *
+ * @param i_data A pointer to the first value.
+ * @param j_data A pointer to the second value.
+ * @return Returns a number less than 0, 0, or greater than 0 if \a i_data is
+ * less than, equal to, or greater than \a j_data, respectively.
+ *
+ * @sa ht_hash_u64()
+ */
+int ht_cmp_u64( void const *i_data, void const *j_data );
+
+/**
+ * Hashes \a n bytes.  The algorithm is wyhash: it consumes 48 bytes per
+ * iteration in three independent lanes, each combined with a 64&times;64
+ * &rarr; 128-bit multiply, and reads keys of at most 16 bytes with at most
+ * four (possibly overlapping) loads and no loop.
+ *
+ * @param p A pointer to the bytes to hash.  It need not be aligned.
+ * @param n The number of bytes.
+ * @param seed The seed.
+ * @return Returns said hash value.
+ */
+ht_hash_val_t ht_hash_bytes( void const *p, size_t n, uint64_t seed );
+
+/**
+ * Mixes the bits of \a k so that every bit of the result depends on every bit
+ * of \a k.  It's a bijection.
+ *
+ * @param k The value to mix.
+ * @return Returns said value.
+ */
+ht_hash_val_t ht_hash_mix( uint64_t k );
+
+/**
+ * Hashes the span pointed to by \a data (an ht_span).
+ *
+ * @param data A pointer to the span.
+ * @return Returns said hash value.
+ *
+ * @sa ht_cmp_span()
+ */
+ht_hash_val_t ht_hash_span( void const *data );
+
+/**
+ * Hashes the NUL-terminated string pointed to by \a data.
+ *
+ * @param data A pointer to the string.
+ * @return Returns said hash value.
+ *
+ * @sa ht_cmp_str()
+ */
+ht_hash_val_t ht_hash_str( void const *data );
+
+/**
+ * Hashes the `uint32_t` value pointed to by \a data.
+ *
+ * @param data A pointer to the value.
+ * @return Returns said hash value.
+ *
+ * @sa ht_cmp_u32()
+ */
+ht_hash_val_t ht_hash_u32( void const *data );
+
+/**
+ * Hashes the `uint64_t` value pointed to by \a data.
+ *
+ * @param data A pointer to the value.
+ * @return Returns said hash value.
+ *
+ * @sa ht_cmp_u64()
+ */
+ht_hash_val_t ht_hash_u64( void const *data );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef __cplusplus
+} // extern "C"
+#endif /* __cplusplus */
+
+#endif /* pjl_ht_hash_H */
+/* vim:set et sw=2 ts=2: */
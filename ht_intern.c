@@ -0,0 +1,252 @@
+/*
+**      PJL Library
+**      src/ht_intern.c
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// local
+#include "ht_intern.h"
+#include "ht_hash.h"
+#include "ht_mt.h"
+
+// standard
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+////////// local constants ////////////////////////////////////////////////////
+
+/**
+ * Number of bytes of an arena block.
+ */
+#define HT_INTERN_BLOCK_SIZE      (64u * 1024)
+
+/**
+ * Strings (including their NUL) of more than this many bytes get a block of
+ * their own so that the rest of the current block isn't wasted.
+ */
+#define HT_INTERN_LARGE           (HT_INTERN_BLOCK_SIZE / 4)
+
+////////// local types ////////////////////////////////////////////////////////
+
+typedef struct ht_intern_block  ht_intern_block_t;
+
+/**
+ * A block of an arena.
+ */
+struct ht_intern_block {
+  ht_intern_block_t  *next;             ///< Next older block, if any.
+  char                bytes[];          ///< Strings.
+};
+
+/**
+ * A string interning pool.  The data of every entry of \ref table or \ref mt
+ * is an ht_span of an interned string.
+ */
+struct ht_intern {
+  hash_table_t        table;            ///< Strings if not concurrent.
+  ht_mt_t            *mt;               ///< Strings if concurrent or NULL.
+  pthread_mutex_t     mutex;            ///< If concurrent, guards interning.
+  ht_intern_block_t  *blocks;           ///< Blocks, newest first.
+  char               *next;             ///< Next free byte of newest block.
+  char               *end;              ///< End of newest block.
+  _Atomic size_t      n_bytes;          ///< Bytes of all blocks.
+};
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Allocates a new arena block.
+ *
+ * @param size The number of bytes of the block.
+ * @return Returns a pointer to said block.
+ */
+static ht_intern_block_t* ht_intern_block_new( size_t size ) {
+  ht_intern_block_t *const block = malloc( sizeof(ht_intern_block_t) + size );
+  block->next = NULL;
+  return block;
+}
+
+/**
+ * Copies a string into the arena of \a pool.
+ *
+ * @param pool The pool.
+ * @param s A pointer to the bytes of the string.
+ * @param len The number of bytes of \a s.
+ * @return Returns a pointer to the NUL-terminated copy.
+ */
+static char* ht_intern_copy( ht_intern_t *pool, char const *s, size_t len ) {
+  size_t const n = len + 1;
+  char *copy;
+
+  if ( n > HT_INTERN_LARGE ) {
+    //
+    // Link a block of its own after the newest block so the newest block
+    // stays the one being carved.
+    //
+    ht_intern_block_t *const block = ht_intern_block_new( n );
+    if ( pool->blocks == NULL ) {
+      pool->blocks = block;
+    }
+    else {
+      block->next = pool->blocks->next;
+      pool->blocks->next = block;
+    }
+    copy = block->bytes;
+    atomic_fetch_add_explicit( &pool->n_bytes, n, memory_order_relaxed );
+  }
+  else {
+    if ( (size_t)(pool->end - pool->next) < n ) {
+      ht_intern_block_t *const block =
+        ht_intern_block_new( HT_INTERN_BLOCK_SIZE );
+      block->next = pool->blocks;
+      pool->blocks = block;
+      pool->next = block->bytes;
+      pool->end = block->bytes + HT_INTERN_BLOCK_SIZE;
+      atomic_fetch_add_explicit(
+        &pool->n_bytes, HT_INTERN_BLOCK_SIZE, memory_order_relaxed
+      );
+    }
+    copy = pool->next;
+    pool->next += n;
+  }
+
+  if ( len > 0 )
+    memcpy( copy, s, len );
+  copy[ len ] = '\0';
+  return copy;
+}
+
+/**
+ * Gets the copy of a string in a concurrent pool, if any.
+ *
+ * @param pool The pool.
+ * @param span The span of the string.
+ * @return Returns a pointer to the copy or NULL if none.
+ */
+static char const* ht_intern_mt_find( ht_intern_t const *pool,
+                                      ht_span_t const *span ) {
+  ht_mt_read_begin( pool->mt );
+  ht_span_t const *const found = ht_mt_find( pool->mt, span );
+  // The string itself is in the arena, so it outlives the read section.
+  char const *const s = found != NULL ? found->ptr : NULL;
+  ht_mt_read_end( pool->mt );
+  return s;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+char const* ht_intern( ht_intern_t *pool, char const *s, size_t len ) {
+  assert( pool != NULL );
+  assert( s != NULL || len == 0 );
+
+  ht_span_t span = { s, len };
+
+  if ( pool->mt == NULL ) {
+    ht_insert_rv_t const rv = ht_find_or_insert(
+      &pool->table, &span, sizeof span, ht_hash_span( &span )
+    );
+    ht_span_t *const data = (ht_span_t*)rv.entry->data;
+    // The bytes are equal, so pointing to the copy changes neither the hash
+    // value nor comparisons.
+    if ( rv.inserted )
+      data->ptr = ht_intern_copy( pool, s, len );
+    return data->ptr;
+  }
+
+  char const *interned = ht_intern_mt_find( pool, &span );
+  if ( interned != NULL )
+    return interned;
+
+  // The lock guards only the arena, not the (already thread-safe) table.
+  pthread_mutex_lock( &pool->mutex );
+  span.ptr = interned = ht_intern_copy( pool, s, len );
+  pthread_mutex_unlock( &pool->mutex );
+
+  if ( ht_mt_insert( pool->mt, &span, sizeof span ) )
+    return interned;
+  //
+  // Another thread interned an equal string since it wasn't found, so that
+  // thread's copy is the one; this copy is wasted until the pool is freed.
+  //
+  return ht_intern_mt_find( pool, &span );
+}
+
+size_t ht_intern_bytes( ht_intern_t const *pool ) {
+  assert( pool != NULL );
+  return atomic_load_explicit( &pool->n_bytes, memory_order_relaxed );
+}
+
+char const* ht_intern_find( ht_intern_t const *pool, char const *s,
+                            size_t len ) {
+  assert( pool != NULL );
+  assert( s != NULL || len == 0 );
+
+  ht_span_t const span = { s, len };
+  if ( pool->mt != NULL )
+    return ht_intern_mt_find( pool, &span );
+  ht_entry_t const *const entry =
+    ht_find_hash( &pool->table, &span, ht_hash_span( &span ) );
+  return entry != NULL ? ((ht_span_t const*)entry->data)->ptr : NULL;
+}
+
+void ht_intern_free( ht_intern_t *pool ) {
+  if ( pool == NULL )
+    return;
+  if ( pool->mt != NULL ) {
+    ht_mt_free( pool->mt, NULL );
+    pthread_mutex_destroy( &pool->mutex );
+  }
+  else {
+    ht_cleanup( &pool->table, NULL );
+  }
+  for ( ht_intern_block_t *block = pool->blocks, *next; block != NULL;
+        block = next ) {
+    next = block->next;
+    free( block );
+  } // for
+  free( pool );
+}
+
+ht_intern_t* ht_intern_new( size_t est_size, bool concurrent ) {
+  ht_intern_t *const pool = malloc( sizeof(ht_intern_t) );
+  *pool = (ht_intern_t){ .mt = NULL };
+  atomic_init( &pool->n_bytes, 0 );
+  if ( concurrent ) {
+    pool->mt = ht_mt_new( 1.0, est_size, &ht_cmp_span, &ht_hash_span );
+    pthread_mutex_init( &pool->mutex, NULL );
+  }
+  else {
+    ht_init( &pool->table, 1.0, est_size, &ht_cmp_span, &ht_hash_span );
+  }
+  return pool;
+}
+
+size_t ht_intern_size( ht_intern_t const *pool ) {
+  assert( pool != NULL );
+  return pool->mt != NULL ? ht_mt_size( pool->mt ) : pool->table.size;
+}
+
+char const* ht_intern_str( ht_intern_t *pool, char const *s ) {
+  assert( s != NULL );
+  return ht_intern( pool, s, strlen( s ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,156 @@
+/*
+**      PJL Library
+**      src/ht_intern.h
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef pjl_ht_intern_H
+#define pjl_ht_intern_H
+
+/**
+ * @file
+ * Declares a string interning pool built on \ref hash_table "hash_table": it
+ * keeps exactly one copy of each distinct string so that interned strings
+ * can be compared for equality by pointer.
+ *
+ * The bytes of interned strings are copied into an arena of large blocks
+ * carved sequentially, so memory is allocated only when a block fills and a
+ * string never moves nor is freed until the pool is freed.  The pool's table
+ * stores only an ht_span (pointer and length) per string.
+ *
+ * A pool is either:
+ *
+ *  + Single-threaded: interning a string is one probe of a \ref hash_table
+ *    "hash_table" via ht_find_or_insert().
+ *  + Concurrent: interning is thread-safe.  Finding an already interned
+ *    string is a lock-free ht_mt_find(); only copying a new string into the
+ *    arena takes the pool's lock.  If threads race to intern equal new
+ *    strings, all but one copy are wasted until the pool is freed.
+ */
+
+// local
+#include "hash_table.h"
+
+// standard
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+////////// typedefs ///////////////////////////////////////////////////////////
+
+typedef struct ht_intern      ht_intern_t;
+
+////////// extern functions ///////////////////////////////////////////////////
+
+/**
+ * Interns a string: gets the pool's copy of it, copying it into the pool
+ * first if necessary.
+ *
+ * @param pool The pool to intern into.
+ * @param s A pointer to the bytes of the string.  It need not be
+ * NUL-terminated.
+ * @param len The number of bytes of \a s.
+ * @return Returns a pointer to the pool's NUL-terminated copy of \a s.  It
+ * remains valid until \a pool is freed.  Interning equal strings returns the
+ * same pointer.
+ *
+ * @sa ht_intern_find()
+ * @sa ht_intern_str()
+ */
+char const* ht_intern( ht_intern_t *pool, char const *s, size_t len );
+
+/**
+ * Gets the number of bytes of the pool's arena, i.e., of all interned strings
+ * (including their NUL bytes) plus unused space at the ends of blocks.
+ *
+ * @param pool The pool.
+ * @return Returns said number.  If other threads are interning strings, it's
+ * only approximate.
+ */
+size_t ht_intern_bytes( ht_intern_t const *pool );
+
+/**
+ * Gets the pool's copy of a string, if any, without interning it.
+ *
+ * @param pool The pool to search.
+ * @param s A pointer to the bytes of the string.  It need not be
+ * NUL-terminated.
+ * @param len The number of bytes of \a s.
+ * @return Returns a pointer to the pool's NUL-terminated copy of \a s or NULL
+ * if \a s hasn't been interned.
+ *
+ * @note If \a pool is concurrent, this never locks.
+ *
+ * @sa ht_intern()
+ */
+char const* ht_intern_find( ht_intern_t const *pool, char const *s,
+                            size_t len );
+
+/**
+ * Frees a pool including all interned strings.
+ *
+ * @param pool The pool to free.  If NULL, does nothing.  No other thread may
+ * be using it.
+ *
+ * @sa ht_intern_new()
+ */
+void ht_intern_free( ht_intern_t *pool );
+
+/**
+ * Creates a new pool.
+ *
+ * @param est_size The estimated number of distinct strings.
+ * @param concurrent If `true`, all `ht_intern_` functions may be called
+ * concurrently on the pool; if `false`, no function may be called
+ * concurrently with ht_intern() or ht_intern_str() on it.
+ * @return Returns a pointer to a new pool.
+ *
+ * @sa ht_intern_free()
+ */
+ht_intern_t* ht_intern_new( size_t est_size, bool concurrent );
+
+/**
+ * Gets the number of distinct strings interned.
+ *
+ * @param pool The pool.
+ * @return Returns said number.  If other threads are interning strings, it's
+ * only approximate.
+ */
+size_t ht_intern_size( ht_intern_t const *pool );
+
+/**
+ * Interns a NUL-terminated string.
+ *
+ * @param pool The pool to intern into.
+ * @param s The string to intern.
+ * @return Returns the same as ht_intern().
+ *
+ * @sa ht_intern()
+ */
+char const* ht_intern_str( ht_intern_t *pool, char const *s );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef __cplusplus
+} // extern "C"
+#endif /* __cplusplus */
+
+#endif /* pjl_ht_intern_H */
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,452 @@
+/*
+**      PJL Library
+**      src/ht_lru.c
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// local
+#include "ht_lru.h"
+
+// standard
+#include <assert.h>
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+////////// local constants ////////////////////////////////////////////////////
+
+/**
+ * Assumed size of a cache line.
+ */
+#define HT_LRU_CACHE_LINE         64u
+
+////////// local types ////////////////////////////////////////////////////////
+
+typedef struct ht_clock_shard ht_clock_shard_t;
+typedef struct ht_lru_link    ht_lru_link_t;
+
+/**
+ * The recency links of an entry.  They follow the caller's data within the
+ * entry's \ref ht_entry::data "data" so that the table's comparison and hash
+ * functions see only the caller's data.
+ */
+struct ht_lru_link {
+  /// For ht_lru, the next more recently used entry, if any; for ht_clock,
+  /// the previous entry in the ring.
+  ht_entry_t   *prev;
+
+  /// For ht_lru, the next less recently used entry, if any; for ht_clock,
+  /// the next entry in the ring.
+  ht_entry_t   *next;
+
+  size_t        data_size;              ///< Size of the caller's data.
+  atomic_bool   referenced;             ///< ht_clock only: hit since swept?
+};
+
+/**
+ * A shard of an ht_clock.
+ */
+struct ht_clock_shard {
+  alignas(HT_LRU_CACHE_LINE)
+  pthread_rwlock_t  lock;               ///< Guards the following.
+  hash_table_t      table;              ///< Entries.
+  ht_entry_t       *hand;               ///< Next entry to sweep, if any.
+  size_t            n_bytes;            ///< Bytes of data.
+};
+
+/**
+ * A thread-safe cache that approximates LRU by CLOCK.
+ */
+struct ht_clock {
+  ht_hash_fn_t      hash_fn;            ///< Hash function.
+  ht_free_fn_t      evict_fn;           ///< Called for evicted data, if any.
+  size_t            max_entries;        ///< Per-shard maximum entries or 0.
+  size_t            max_bytes;          ///< Per-shard maximum bytes or 0.
+  unsigned          log2;               ///< Base-2 logarithm of n_shards.
+  unsigned          n_shards;           ///< Number of shards; power of 2.
+  ht_clock_shard_t  shards[];           ///< Shards.
+};
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Gets the recency links of an entry.
+ *
+ * @param entry The entry.
+ * @return Returns a pointer to said links.
+ */
+static inline ht_lru_link_t* ht_link( ht_entry_t const *entry ) {
+  return (ht_lru_link_t*)(
+    (char*)entry->data + entry->data_size - sizeof(ht_lru_link_t)
+  );
+}
+
+/**
+ * Gets the size of an entry's data including its recency links.
+ *
+ * @param data_size The size of the caller's data.
+ * @return Returns said size.
+ */
+static inline size_t ht_link_data_size( size_t data_size ) {
+  return ((data_size + alignof(ht_lru_link_t) - 1)
+          & ~(alignof(ht_lru_link_t) - 1)) + sizeof(ht_lru_link_t);
+}
+
+/**
+ * Checks whether either limit is exceeded.
+ *
+ * @param size The number of entries.
+ * @param n_bytes The bytes of data.
+ * @param max_entries The maximum number of entries or 0.
+ * @param max_bytes The maximum bytes of data or 0.
+ * @return Returns `true` only if over either limit.
+ */
+static inline bool ht_over( size_t size, size_t n_bytes, size_t max_entries,
+                            size_t max_bytes ) {
+  return (max_entries > 0 && size > max_entries) ||
+         (max_bytes > 0 && n_bytes > max_bytes);
+}
+
+/**
+ * Gets the shard for a hash value.
+ *
+ * @param cache The cache.
+ * @param hash The hash value.
+ * @return Returns said shard.
+ */
+static inline ht_clock_shard_t* ht_clock_shard( ht_clock_t *cache,
+                                                ht_hash_val_t hash ) {
+  // Shift twice since shifting a 64-bit value by 64 is undefined.
+  return &cache->shards[ (hash >> (63 - cache->log2)) >> 1 ];
+}
+
+/**
+ * Adds an entry to a shard's ring just behind its hand, i.e., where the hand
+ * will reach it last.
+ *
+ * @param shard The shard.
+ * @param entry The entry to add.
+ */
+static void ht_clock_ring_add( ht_clock_shard_t *shard, ht_entry_t *entry ) {
+  ht_lru_link_t *const link = ht_link( entry );
+  if ( shard->hand == NULL ) {
+    link->prev = link->next = entry;
+    shard->hand = entry;
+    return;
+  }
+  ht_lru_link_t *const hand_link = ht_link( shard->hand );
+  link->prev = hand_link->prev;
+  link->next = shard->hand;
+  ht_link( hand_link->prev )->next = entry;
+  hand_link->prev = entry;
+}
+
+/**
+ * Removes an entry from a shard's ring.
+ *
+ * @param shard The shard.
+ * @param entry The entry to remove.
+ */
+static void ht_clock_ring_remove( ht_clock_shard_t *shard,
+                                  ht_entry_t *entry ) {
+  ht_lru_link_t *const link = ht_link( entry );
+  if ( link->next == entry ) {
+    shard->hand = NULL;
+    return;
+  }
+  ht_link( link->prev )->next = link->next;
+  ht_link( link->next )->prev = link->prev;
+  if ( shard->hand == entry )
+    shard->hand = link->next;
+}
+
+/**
+ * Makes an entry the most recently used.
+ *
+ * @param cache The cache.
+ * @param entry The entry to add.  It must not be in the list.
+ */
+static void ht_lru_push( ht_lru_t *cache, ht_entry_t *entry ) {
+  ht_lru_link_t *const link = ht_link( entry );
+  link->prev = NULL;
+  link->next = cache->mru;
+  if ( cache->mru != NULL )
+    ht_link( cache->mru )->prev = entry;
+  else
+    cache->lru = entry;
+  cache->mru = entry;
+}
+
+/**
+ * Removes an entry from a cache's recency list.
+ *
+ * @param cache The cache.
+ * @param entry The entry to remove.
+ */
+static void ht_lru_unlink( ht_lru_t *cache, ht_entry_t *entry ) {
+  ht_lru_link_t const *const link = ht_link( entry );
+  if ( link->prev != NULL )
+    ht_link( link->prev )->next = link->next;
+  else
+    cache->mru = link->next;
+  if ( link->next != NULL )
+    ht_link( link->next )->prev = link->prev;
+  else
+    cache->lru = link->prev;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+bool ht_clock_delete( ht_clock_t *cache, void const *data ) {
+  assert( cache != NULL );
+  assert( data != NULL );
+
+  ht_hash_val_t const hash = (*cache->hash_fn)( data );
+  ht_clock_shard_t *const shard = ht_clock_shard( cache, hash );
+
+  pthread_rwlock_wrlock( &shard->lock );
+  ht_entry_t *const entry = ht_find_hash( &shard->table, data, hash );
+  if ( entry != NULL ) {
+    ht_clock_ring_remove( shard, entry );
+    shard->n_bytes -= ht_link( entry )->data_size;
+    ht_delete( &shard->table, entry );
+  }
+  pthread_rwlock_unlock( &shard->lock );
+  return entry != NULL;
+}
+
+bool ht_clock_find( ht_clock_t *cache, void const *data, void *buf,
+                    size_t buf_size ) {
+  assert( cache != NULL );
+  assert( data != NULL );
+  assert( buf != NULL || buf_size == 0 );
+
+  ht_hash_val_t const hash = (*cache->hash_fn)( data );
+  ht_clock_shard_t *const shard = ht_clock_shard( cache, hash );
+
+  pthread_rwlock_rdlock( &shard->lock );
+  ht_entry_t const *const entry = ht_find_hash( &shard->table, data, hash );
+  if ( entry != NULL ) {
+    ht_lru_link_t *const link = ht_link( entry );
+    // Check first so an already referenced entry's line isn't written.
+    if ( !atomic_load_explicit( &link->referenced, memory_order_relaxed ) )
+      atomic_store_explicit( &link->referenced, true, memory_order_relaxed );
+    memcpy( buf, entry->data,
+            buf_size < link->data_size ? buf_size : link->data_size );
+  }
+  pthread_rwlock_unlock( &shard->lock );
+  return entry != NULL;
+}
+
+void ht_clock_free( ht_clock_t *cache, ht_free_fn_t free_fn ) {
+  if ( cache == NULL )
+    return;
+  for ( unsigned i = 0; i < cache->n_shards; ++i ) {
+    ht_cleanup( &cache->shards[i].table, free_fn );
+    pthread_rwlock_destroy( &cache->shards[i].lock );
+  } // for
+  free( cache );
+}
+
+bool ht_clock_insert( ht_clock_t *cache, void const *data,
+                      size_t data_size ) {
+  assert( cache != NULL );
+  assert( data != NULL );
+  assert( data_size > 0 );
+
+  ht_hash_val_t const hash = (*cache->hash_fn)( data );
+  ht_clock_shard_t *const shard = ht_clock_shard( cache, hash );
+
+  pthread_rwlock_wrlock( &shard->lock );
+  ht_insert_rv_t const rv = ht_insert_hash(
+    &shard->table, data, ht_link_data_size( data_size ), hash
+  );
+  if ( rv.inserted ) {
+    memcpy( rv.entry->data, data, data_size );
+    ht_lru_link_t *const link = ht_link( rv.entry );
+    link->data_size = data_size;
+    atomic_init( &link->referenced, false );
+    ht_clock_ring_add( shard, rv.entry );
+    shard->n_bytes += data_size;
+
+    while ( ht_over( shard->table.size, shard->n_bytes, cache->max_entries,
+                     cache->max_bytes ) && shard->table.size > 1 ) {
+      ht_entry_t *const victim = shard->hand;
+      ht_lru_link_t *const victim_link = ht_link( victim );
+      if ( victim == rv.entry ||
+           atomic_load_explicit( &victim_link->referenced,
+                                 memory_order_relaxed ) ) {
+        atomic_store_explicit( &victim_link->referenced, false,
+                               memory_order_relaxed );
+        shard->hand = victim_link->next;
+        continue;
+      }
+      ht_clock_ring_remove( shard, victim );
+      shard->n_bytes -= victim_link->data_size;
+      if ( cache->evict_fn != NULL )
+        (*cache->evict_fn)( victim->data );
+      ht_delete( &shard->table, victim );
+    } // while
+  }
+  pthread_rwlock_unlock( &shard->lock );
+  return rv.inserted;
+}
+
+ht_clock_t* ht_clock_new( unsigned n_shards, size_t max_entries,
+                          size_t max_bytes, ht_cmp_fn_t cmp_fn,
+                          ht_hash_fn_t hash_fn, ht_free_fn_t evict_fn ) {
+  assert( n_shards > 0 && (n_shards & (n_shards - 1)) == 0 );
+  assert( cmp_fn != NULL );
+  assert( hash_fn != NULL );
+
+  unsigned log2 = 0;
+  while ( (1u << log2) < n_shards )
+    ++log2;
+
+  size_t const size = sizeof(ht_clock_t) + n_shards * sizeof(ht_clock_shard_t);
+  ht_clock_t *const cache = aligned_alloc(
+    alignof(ht_clock_t),
+    (size + alignof(ht_clock_t) - 1) & ~(alignof(ht_clock_t) - 1)
+  );
+  *cache = (ht_clock_t){
+    .hash_fn = hash_fn,
+    .evict_fn = evict_fn,
+    // Round up so the shards' limits add up to at least the whole's.
+    .max_entries = (max_entries + n_shards - 1) / n_shards,
+    .max_bytes = (max_bytes + n_shards - 1) / n_shards,
+    .log2 = log2,
+    .n_shards = n_shards
+  };
+
+  for ( unsigned i = 0; i < n_shards; ++i ) {
+    ht_clock_shard_t *const shard = &cache->shards[i];
+    pthread_rwlock_init( &shard->lock, NULL );
+    ht_init( &shard->table, 1.0, cache->max_entries, cmp_fn, hash_fn );
+    shard->hand = NULL;
+    shard->n_bytes = 0;
+  } // for
+  return cache;
+}
+
+size_t ht_clock_size( ht_clock_t *cache ) {
+  assert( cache != NULL );
+  size_t size = 0;
+  for ( unsigned i = 0; i < cache->n_shards; ++i ) {
+    ht_clock_shard_t *const shard = &cache->shards[i];
+    pthread_rwlock_rdlock( &shard->lock );
+    size += shard->table.size;
+    pthread_rwlock_unlock( &shard->lock );
+  } // for
+  return size;
+}
+
+void ht_lru_cleanup( ht_lru_t *cache, ht_free_fn_t free_fn ) {
+  if ( cache == NULL )
+    return;
+  ht_cleanup( &cache->table, free_fn );
+  *cache = (ht_lru_t){ 0 };
+}
+
+bool ht_lru_delete( ht_lru_t *cache, void const *data ) {
+  assert( cache != NULL );
+  assert( data != NULL );
+
+  ht_entry_t *const entry = ht_find( &cache->table, data );
+  if ( entry == NULL )
+    return false;
+  ht_lru_unlink( cache, entry );
+  cache->n_bytes -= ht_link( entry )->data_size;
+  ht_delete( &cache->table, entry );
+  return true;
+}
+
+void* ht_lru_find( ht_lru_t *cache, void const *data ) {
+  assert( cache != NULL );
+  assert( data != NULL );
+
+  ht_entry_t *const entry = ht_find( &cache->table, data );
+  if ( entry == NULL )
+    return NULL;
+  if ( entry != cache->mru ) {
+    ht_lru_unlink( cache, entry );
+    ht_lru_push( cache, entry );
+  }
+  return entry->data;
+}
+
+void ht_lru_init( ht_lru_t *cache, size_t max_entries, size_t max_bytes,
+                  ht_cmp_fn_t cmp_fn, ht_hash_fn_t hash_fn,
+                  ht_free_fn_t evict_fn ) {
+  assert( cache != NULL );
+  assert( cmp_fn != NULL );
+  assert( hash_fn != NULL );
+
+  *cache = (ht_lru_t){
+    .max_entries = max_entries,
+    .max_bytes = max_bytes,
+    .evict_fn = evict_fn
+  };
+  // A full cache stays full, so size its buckets for that from the start.
+  ht_init( &cache->table, 1.0, max_entries, cmp_fn, hash_fn );
+}
+
+ht_lru_rv_t ht_lru_insert( ht_lru_t *cache, void const *data,
+                           size_t data_size ) {
+  assert( cache != NULL );
+  assert( data != NULL );
+
+  ht_insert_rv_t const rv = ht_insert_hash(
+    &cache->table, data, ht_link_data_size( data_size ),
+    (*cache->table.hash_fn)( data )
+  );
+  if ( !rv.inserted ) {
+    if ( rv.entry != cache->mru ) {
+      ht_lru_unlink( cache, rv.entry );
+      ht_lru_push( cache, rv.entry );
+    }
+    return (ht_lru_rv_t){ rv.entry->data, false };
+  }
+
+  memcpy( rv.entry->data, data, data_size );
+  ht_link( rv.entry )->data_size = data_size;
+  ht_lru_push( cache, rv.entry );
+  cache->n_bytes += data_size;
+
+  while ( ht_over( cache->table.size, cache->n_bytes, cache->max_entries,
+                   cache->max_bytes ) && cache->lru != rv.entry ) {
+    ht_entry_t *const victim = cache->lru;
+    ht_lru_unlink( cache, victim );
+    cache->n_bytes -= ht_link( victim )->data_size;
+    if ( cache->evict_fn != NULL )
+      (*cache->evict_fn)( victim->data );
+    ht_delete( &cache->table, victim );
+  } // while
+
+  return (ht_lru_rv_t){ rv.entry->data, true };
+}
+
+void* ht_lru_peek( ht_lru_t const *cache, void const *data ) {
+  assert( cache != NULL );
+  assert( data != NULL );
+  ht_entry_t *const entry = ht_find( &cache->table, data );
+  return entry != NULL ? entry->data : NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,248 @@
+/*
+**      PJL Library
+**      src/ht_lru.h
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef pjl_ht_lru_H
+#define pjl_ht_lru_H
+
+/**
+ * @file
+ * Declares bounded caches built on \ref hash_table "hash_table":
+ *
+ *  + ht_lru: a single-threaded cache that evicts the least recently used
+ *    entry exactly.
+ *  + ht_clock: a thread-safe cache that approximates LRU using the CLOCK
+ *    algorithm: a hit only sets a "referenced" flag, so readers share a lock
+ *    and never modify any list.
+ *
+ * Either way, each entry's recency links are stored in the same \ref ht_entry
+ * "entry" as its data (after it), so an entry is one allocation and a hit is
+ * one lookup.
+ */
+
+// local
+#include "hash_table.h"
+
+// standard
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+////////// typedefs ///////////////////////////////////////////////////////////
+
+typedef struct ht_clock       ht_clock_t;
+typedef struct ht_lru         ht_lru_t;
+typedef struct ht_lru_rv      ht_lru_rv_t;
+
+////////// structures /////////////////////////////////////////////////////////
+
+/**
+ * A bounded cache that evicts the least recently used entry.
+ *
+ * @note The data of every entry of \ref table is followed by its recency
+ * links, so \ref table should be used only via the `ht_lru_` functions.
+ */
+struct ht_lru {
+  hash_table_t  table;                  ///< Entries.
+  ht_entry_t   *mru;                    ///< Most recently used, if any.
+  ht_entry_t   *lru;                    ///< Least recently used, if any.
+  size_t        max_entries;            ///< Maximum number of entries or 0.
+  size_t        max_bytes;              ///< Maximum bytes of data or 0.
+  size_t        n_bytes;                ///< Bytes of data.
+  ht_free_fn_t  evict_fn;               ///< Called for evicted data, if any.
+};
+
+/**
+ * The return value of ht_lru_insert().
+ */
+struct ht_lru_rv {
+  void         *data;                   ///< Data found or inserted.
+  bool          inserted;               ///< Was \ref data inserted?
+};
+
+////////// extern functions ///////////////////////////////////////////////////
+
+/**
+ * Deletes the entry having data equal to \a data, if any.  The cache's
+ * eviction function is _not_ called.
+ *
+ * @param cache The cache to delete from.
+ * @param data The data to delete.
+ * @return Returns `true` only if an entry was deleted.
+ */
+bool ht_clock_delete( ht_clock_t *cache, void const *data );
+
+/**
+ * Attempts to find \a data within a cache and, if found, marks it as
+ * referenced and copies its data.  Concurrent calls lock the same shard only
+ * for reading.
+ *
+ * @param cache The cache to search.
+ * @param data The data to search for.
+ * @param buf The buffer to copy the found data into.
+ * @param buf_size The size of \a buf.  At most this many bytes are copied.
+ * @return Returns `true` only if found.
+ */
+bool ht_clock_find( ht_clock_t *cache, void const *data, void *buf,
+                    size_t buf_size );
+
+/**
+ * Frees a cache.
+ *
+ * @param cache The cache to free.  If NULL, does nothing.  No other thread
+ * may be using it.
+ * @param free_fn A pointer to a function used to free data associated with
+ * each entry or NULL if unnecessary.
+ *
+ * @sa ht_clock_new()
+ */
+void ht_clock_free( ht_clock_t *cache, ht_free_fn_t free_fn );
+
+/**
+ * Attempts to insert \a data into \a cache.  If the data's shard is then over
+ * either limit, entries of that shard are evicted: the CLOCK hand sweeps its
+ * entries clearing their referenced flags and evicts the first whose flag was
+ * already clear.
+ *
+ * @param cache The cache to insert into.
+ * @param data The data to insert.  It's copied into the new entry.
+ * @param data_size The size of \a data; must be &gt; 0.
+ * @return Returns `true` only if \a data was inserted, i.e., no entry having
+ * equal data already existed.
+ */
+bool ht_clock_insert( ht_clock_t *cache, void const *data, size_t data_size );
+
+/**
+ * Creates a new thread-safe cache.  Entries are divided among \a n_shards
+ * shards by hash value, each with its own lock and CLOCK hand, and each
+ * limited to 1/\a n_shards of \a max_entries and \a max_bytes.
+ *
+ * @param n_shards The number of shards; must be a power of 2.
+ * @param max_entries The maximum number of entries or 0 for no limit.
+ * @param max_bytes The maximum number of bytes of data or 0 for no limit.
+ * @param cmp_fn The comparison function to use.
+ * @param hash_fn The hash function to use.  Its high bits select a shard.
+ * @param evict_fn A pointer to a function called with the data of every
+ * evicted entry or NULL if unnecessary.  It's called with the shard locked.
+ * @return Returns a pointer to a new cache.
+ *
+ * @sa ht_clock_free()
+ */
+ht_clock_t* ht_clock_new( unsigned n_shards, size_t max_entries,
+                          size_t max_bytes, ht_cmp_fn_t cmp_fn,
+                          ht_hash_fn_t hash_fn, ht_free_fn_t evict_fn );
+
+/**
+ * Gets the number of entries in a cache.
+ *
+ * @param cache The cache.
+ * @return Returns said number.  If other threads are modifying \a cache, it's
+ * only approximate.
+ */
+size_t ht_clock_size( ht_clock_t *cache );
+
+/**
+ * Cleans-up a cache.
+ *
+ * @param cache The cache to clean up.  If NULL, does nothing.
+ * @param free_fn A pointer to a function used to free data associated with
+ * each entry or NULL if unnecessary.
+ *
+ * @sa ht_lru_init()
+ */
+void ht_lru_cleanup( ht_lru_t *cache, ht_free_fn_t free_fn );
+
+/**
+ * Deletes the entry having data equal to \a data, if any.  The cache's
+ * eviction function is _not_ called.
+ *
+ * @param cache The cache to delete from.
+ * @param data The data to delete.
+ * @return Returns `true` only if an entry was deleted.
+ */
+bool ht_lru_delete( ht_lru_t *cache, void const *data );
+
+/**
+ * Attempts to find \a data within a cache and, if found, makes it the most
+ * recently used.  This takes constant time.
+ *
+ * @param cache The cache to search.
+ * @param data The data to search for.
+ * @return Returns a pointer to the data of the entry equal to \a data or NULL
+ * if not found.
+ *
+ * @sa ht_lru_peek()
+ */
+void* ht_lru_find( ht_lru_t *cache, void const *data );
+
+/**
+ * Initializes a cache.
+ *
+ * @param cache The cache to initialize.
+ * @param max_entries The maximum number of entries or 0 for no limit.
+ * @param max_bytes The maximum number of bytes of data or 0 for no limit.
+ * @param cmp_fn The comparison function to use.
+ * @param hash_fn The hash function to use.
+ * @param evict_fn A pointer to a function called with the data of every
+ * evicted entry or NULL if unnecessary.
+ *
+ * @sa ht_lru_cleanup()
+ */
+void ht_lru_init( ht_lru_t *cache, size_t max_entries, size_t max_bytes,
+                  ht_cmp_fn_t cmp_fn, ht_hash_fn_t hash_fn,
+                  ht_free_fn_t evict_fn );
+
+/**
+ * Attempts to insert \a data into \a cache making it the most recently used.
+ * If the cache is then over either limit, least recently used entries are
+ * evicted until it's not, except that the entry for \a data is never
+ * evicted.
+ *
+ * @param cache The cache to insert into.
+ * @param data The data to insert.  Unlike ht_insert(), it's copied into the
+ * new entry.
+ * @param data_size The size of \a data.
+ * @return Returns the data of the entry either found or inserted.
+ */
+ht_lru_rv_t ht_lru_insert( ht_lru_t *cache, void const *data,
+                           size_t data_size );
+
+/**
+ * Attempts to find \a data within a cache without changing its recency.
+ *
+ * @param cache The cache to search.
+ * @param data The data to search for.
+ * @return Returns a pointer to the data of the entry equal to \a data or NULL
+ * if not found.
+ *
+ * @sa ht_lru_find()
+ */
+void* ht_lru_peek( ht_lru_t const *cache, void const *data );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef __cplusplus
+} // extern "C"
+#endif /* __cplusplus */
+
+#endif /* pjl_ht_lru_H */
+/* vim:set et sw=2 ts=2: */
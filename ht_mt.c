@@ -0,0 +1,609 @@
+/*
+**      PJL Library
+**      src/ht_mt.c
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// local
+#include "ht_mt.h"
+
+// standard
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+////////// local constants ////////////////////////////////////////////////////
+
+/**
+ * Assumed size of a cache line.
+ */
+#define HT_MT_CACHE_LINE          64u
+
+/**
+ * Number of lock stripes; must be a power of 2.  A bucket's stripe is the low
+ * bits of its index, so every bucket is guarded by exactly one stripe.
+ */
+#define HT_MT_N_STRIPES           64u
+
+/**
+ * Minimum number of buckets; must be a power of 2 that is at least
+ * #HT_MT_N_STRIPES.
+ */
+#define HT_MT_N_BUCKETS_MIN       64u
+
+/**
+ * Number of retirements between attempts at reclamation.
+ */
+#define HT_MT_RECLAIM_N           64u
+
+/**
+ * Maximum number of threads that can concurrently be registered.
+ */
+#define HT_MT_THREADS_MAX         1024u
+
+////////// local types ////////////////////////////////////////////////////////
+
+typedef struct ht_mt_array    ht_mt_array_t;
+typedef struct ht_mt_node     ht_mt_node_t;
+typedef struct ht_mt_retired  ht_mt_retired_t;
+typedef struct ht_mt_slot     ht_mt_slot_t;
+typedef struct ht_mt_stripe   ht_mt_stripe_t;
+
+/**
+ * An array of buckets.
+ */
+struct ht_mt_array {
+  size_t                  n_buckets;    ///< Number of buckets; power of 2.
+  _Atomic(ht_mt_node_t*)  buckets[];    ///< Bucket heads.
+};
+
+/**
+ * An entry.
+ */
+struct ht_mt_node {
+  _Atomic(ht_mt_node_t*)  next;         ///< Next node, if any.
+  ht_hash_val_t           hash;         ///< Node hash.
+  size_t                  data_size;    ///< Size of \ref data.
+  alignas(max_align_t) char data[];     ///< Node data.
+};
+
+/**
+ * Memory that has been unlinked, but may still be being read.
+ */
+struct ht_mt_retired {
+  void     *ptr;                        ///< Memory to free.
+  uint64_t  epoch;                      ///< Global epoch when retired.
+  bool      is_array;                   ///< Is \ref ptr an ht_mt_array?
+};
+
+/**
+ * A thread's read-section announcement.
+ */
+struct ht_mt_slot {
+  alignas(HT_MT_CACHE_LINE)
+  _Atomic uint64_t  epoch;              ///< Epoch entered or 0 if none.
+  atomic_bool       in_use;             ///< Claimed by a thread?
+};
+
+/**
+ * A lock stripe.
+ */
+struct ht_mt_stripe {
+  alignas(HT_MT_CACHE_LINE)
+  pthread_mutex_t   mutex;              ///< Guards this stripe's buckets.
+  _Atomic size_t    size;               ///< Entries in this stripe's buckets.
+};
+
+/**
+ * A thread-safe hash table.
+ */
+struct ht_mt {
+  _Atomic(ht_mt_array_t*) array;        ///< Current buckets.
+  ht_cmp_fn_t             cmp_fn;       ///< Comparison function.
+  ht_hash_fn_t            hash_fn;      ///< Hash function.
+  double                  max_lf;       ///< Maximum load factor.
+  ht_mt_stripe_t          stripes[ HT_MT_N_STRIPES ];
+
+  pthread_mutex_t         retired_mutex;  ///< Guards the following.
+  ht_mt_retired_t        *retired;        ///< Retired memory.
+  size_t                  n_retired;      ///< Number of retired.
+  size_t                  cap_retired;    ///< Capacity of retired.
+  size_t                  n_since_reclaim;///< Retired since last reclaim.
+};
+
+////////// local variables ////////////////////////////////////////////////////
+
+/**
+ * The global epoch.  It starts at 2 so that `epoch - 2` never underflows.
+ */
+static _Atomic uint64_t       ebr_epoch = 2;
+
+/**
+ * Key used only to release a thread's slot when the thread exits.
+ */
+static pthread_key_t          ebr_key;
+
+/**
+ * Ensures \ref ebr_key is created only once.
+ */
+static pthread_once_t         ebr_key_once = PTHREAD_ONCE_INIT;
+
+/**
+ * One more than the index of the highest slot ever claimed.
+ */
+static _Atomic unsigned       ebr_n_slots;
+
+/**
+ * Read-section announcements, one per registered thread.
+ */
+static ht_mt_slot_t           ebr_slots[ HT_MT_THREADS_MAX ];
+
+/**
+ * Nesting depth of the calling thread's read sections.
+ */
+static _Thread_local unsigned ebr_nesting;
+
+/**
+ * The calling thread's slot, if any.
+ */
+static _Thread_local ht_mt_slot_t *ebr_slot;
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Releases a thread's slot when it exits.
+ *
+ * @param slot The slot to release.
+ */
+static void ebr_slot_release( void *slot ) {
+  atomic_store_explicit(
+    &((ht_mt_slot_t*)slot)->in_use, false, memory_order_release
+  );
+}
+
+/**
+ * Creates \ref ebr_key.
+ */
+static void ebr_key_create( void ) {
+  pthread_key_create( &ebr_key, &ebr_slot_release );
+}
+
+/**
+ * Gets the calling thread's slot, claiming a free one if necessary.  If all
+ * #HT_MT_THREADS_MAX slots are in use, waits for one to be released.
+ *
+ * @return Returns said slot.
+ */
+static ht_mt_slot_t* ebr_slot_get( void ) {
+  if ( ebr_slot != NULL )
+    return ebr_slot;
+
+  pthread_once( &ebr_key_once, &ebr_key_create );
+  for (;;) {
+    for ( unsigned i = 0; i < HT_MT_THREADS_MAX; ++i ) {
+      bool expected = false;
+      if ( atomic_compare_exchange_strong( &ebr_slots[i].in_use, &expected,
+                                           true ) ) {
+        unsigned n = atomic_load( &ebr_n_slots );
+        while ( n < i + 1 &&
+                !atomic_compare_exchange_weak( &ebr_n_slots, &n, i + 1 ) )
+          ;
+        ebr_slot = &ebr_slots[i];
+        pthread_setspecific( ebr_key, ebr_slot );
+        return ebr_slot;
+      }
+    } // for
+    sched_yield();
+  } // for
+}
+
+/**
+ * Attempts to advance the global epoch: it can be advanced only if every
+ * thread in a read section has entered it during the current epoch.
+ *
+ * @return Returns the global epoch, advanced or not.
+ */
+static uint64_t ebr_try_advance( void ) {
+  uint64_t epoch = atomic_load( &ebr_epoch );
+  unsigned const n_slots = atomic_load( &ebr_n_slots );
+  for ( unsigned i = 0; i < n_slots; ++i ) {
+    uint64_t const slot_epoch = atomic_load( &ebr_slots[i].epoch );
+    if ( slot_epoch != 0 && slot_epoch != epoch )
+      return epoch;
+  } // for
+  if ( atomic_compare_exchange_strong( &ebr_epoch, &epoch, epoch + 1 ) )
+    return epoch + 1;
+  return epoch;                         // another thread advanced it
+}
+
+/**
+ * Frees an array of buckets and all the nodes in it.
+ *
+ * @param array The array to free.
+ */
+static void ht_mt_array_free( ht_mt_array_t *array ) {
+  for ( size_t b = 0; b < array->n_buckets; ++b ) {
+    for ( ht_mt_node_t *node = atomic_load_explicit(
+            &array->buckets[b], memory_order_relaxed ), *next;
+          node != NULL; node = next ) {
+      next = atomic_load_explicit( &node->next, memory_order_relaxed );
+      free( node );
+    } // for
+  } // for
+  free( array );
+}
+
+/**
+ * Frees retired memory.
+ *
+ * @param retired The retired memory to free.
+ */
+static void ht_mt_retired_free( ht_mt_retired_t const *retired ) {
+  if ( retired->is_array )
+    ht_mt_array_free( retired->ptr );
+  else
+    free( retired->ptr );
+}
+
+/**
+ * Frees retired memory that no thread can still be reading.
+ *
+ * @param table The hash table.  Its \ref ht_mt::retired_mutex "retired_mutex"
+ * must be locked.
+ */
+static void ht_mt_reclaim( ht_mt_t *table ) {
+  //
+  // Memory retired during epoch E may still be read by threads that entered
+  // their read sections during E (or before); once the global epoch reaches
+  // E + 2, every such thread must have left.
+  //
+  uint64_t const epoch = ebr_try_advance();
+  size_t kept = 0;
+  for ( size_t i = 0; i < table->n_retired; ++i ) {
+    if ( table->retired[i].epoch + 2 <= epoch )
+      ht_mt_retired_free( &table->retired[i] );
+    else
+      table->retired[ kept++ ] = table->retired[i];
+  } // for
+  table->n_retired = kept;
+  table->n_since_reclaim = 0;
+}
+
+/**
+ * Retires \a ptr: it will be freed once no thread can still be reading it.
+ *
+ * @param table The hash table.
+ * @param ptr The memory to retire.  It must already be unreachable by any
+ * thread that begins a read section from now on.
+ * @param is_array If `true`, \a ptr is an ht_mt_array whose nodes are to be
+ * freed along with it.
+ */
+static void ht_mt_retire( ht_mt_t *table, void *ptr, bool is_array ) {
+  pthread_mutex_lock( &table->retired_mutex );
+  if ( table->n_retired == table->cap_retired ) {
+    table->cap_retired = table->cap_retired == 0 ? 64 : table->cap_retired * 2;
+    table->retired = realloc(
+      table->retired, table->cap_retired * sizeof(ht_mt_retired_t)
+    );
+  }
+  table->retired[ table->n_retired++ ] =
+    (ht_mt_retired_t){ ptr, atomic_load( &ebr_epoch ), is_array };
+  if ( ++table->n_since_reclaim >= HT_MT_RECLAIM_N )
+    ht_mt_reclaim( table );
+  pthread_mutex_unlock( &table->retired_mutex );
+}
+
+/**
+ * Mixes a hash value so its low bits, which select both bucket and stripe,
+ * are usable even when a table's hash function is weak.
+ *
+ * @param hash The hash value to mix.
+ * @return Returns the mixed hash value.
+ */
+static inline uint64_t ht_mt_mix( ht_hash_val_t hash ) {
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+/**
+ * Gets the stripe that guards the bucket for \a hash.
+ *
+ * @param table The hash table.
+ * @param hash The hash value.
+ * @return Returns said stripe.
+ */
+static inline ht_mt_stripe_t* ht_mt_stripe( ht_mt_t *table,
+                                            ht_hash_val_t hash ) {
+  return &table->stripes[ ht_mt_mix( hash ) & (HT_MT_N_STRIPES - 1) ];
+}
+
+/**
+ * Gets the bucket for \a hash.
+ *
+ * @param array The array of buckets.
+ * @param hash The hash value.
+ * @return Returns said bucket.
+ */
+static inline _Atomic(ht_mt_node_t*)* ht_mt_bucket( ht_mt_array_t *array,
+                                                   ht_hash_val_t hash ) {
+  return &array->buckets[ ht_mt_mix( hash ) & (array->n_buckets - 1) ];
+}
+
+/**
+ * Allocates a new array of buckets.
+ *
+ * @param n_buckets The number of buckets; must be a power of 2.
+ * @return Returns said array having all buckets empty.
+ */
+static ht_mt_array_t* ht_mt_array_new( size_t n_buckets ) {
+  ht_mt_array_t *const array =
+    calloc( 1, sizeof(ht_mt_array_t) + n_buckets * sizeof(ht_mt_node_t*) );
+  array->n_buckets = n_buckets;
+  return array;
+}
+
+/**
+ * Grows a hash table, if necessary.
+ *
+ * @remarks Since readers may be traversing the current chains, nodes can't be
+ * relinked in place.  Instead, every node is copied into the new array, the
+ * new array is published, and the old array is retired along with its nodes
+ * (which remain linked as they were for the sake of those readers).
+ *
+ * @param table The hash table to grow.  No stripe may be locked by the
+ * calling thread.
+ */
+static void ht_mt_grow( ht_mt_t *table ) {
+  for ( unsigned i = 0; i < HT_MT_N_STRIPES; ++i )
+    pthread_mutex_lock( &table->stripes[i].mutex );
+
+  ht_mt_array_t *old_array =
+    atomic_load_explicit( &table->array, memory_order_relaxed );
+  // Another thread may have grown it while we were locking.
+  if ( ht_mt_size( table ) < old_array->n_buckets * table->max_lf ) {
+    old_array = NULL;
+  }
+  else {
+    ht_mt_array_t *const new_array =
+      ht_mt_array_new( old_array->n_buckets * 2 );
+
+    for ( size_t b = 0; b < old_array->n_buckets; ++b ) {
+      for ( ht_mt_node_t *node = atomic_load_explicit(
+              &old_array->buckets[b], memory_order_relaxed ), *next;
+            node != NULL; node = next ) {
+        next = atomic_load_explicit( &node->next, memory_order_relaxed );
+        ht_mt_node_t *const copy =
+          malloc( sizeof(ht_mt_node_t) + node->data_size );
+        memcpy( copy, node, sizeof(ht_mt_node_t) + node->data_size );
+        _Atomic(ht_mt_node_t*) *const head =
+          ht_mt_bucket( new_array, node->hash );
+        atomic_init( &copy->next, atomic_load_explicit(
+          head, memory_order_relaxed
+        ) );
+        atomic_init( head, copy );
+      } // for
+    } // for
+
+    atomic_store_explicit( &table->array, new_array, memory_order_release );
+  }
+
+  for ( unsigned i = HT_MT_N_STRIPES; i-- > 0; )
+    pthread_mutex_unlock( &table->stripes[i].mutex );
+  if ( old_array != NULL )
+    ht_mt_retire( table, old_array, /*is_array=*/true );
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+bool ht_mt_delete( ht_mt_t *table, void const *data ) {
+  assert( table != NULL );
+  assert( data != NULL );
+
+  ht_hash_val_t const hash = (*table->hash_fn)( data );
+  ht_mt_stripe_t *const stripe = ht_mt_stripe( table, hash );
+  ht_mt_node_t *deleted = NULL;
+
+  pthread_mutex_lock( &stripe->mutex );
+  ht_mt_array_t *const array =
+    atomic_load_explicit( &table->array, memory_order_relaxed );
+  _Atomic(ht_mt_node_t*) *link = ht_mt_bucket( array, hash );
+  for ( ht_mt_node_t *node; (node = atomic_load_explicit(
+          link, memory_order_relaxed )) != NULL; link = &node->next ) {
+    if ( node->hash == hash && (*table->cmp_fn)( data, node->data ) == 0 ) {
+      //
+      // Readers currently at node can still follow its next pointer, which
+      // is left intact.
+      //
+      atomic_store_explicit(
+        link, atomic_load_explicit( &node->next, memory_order_relaxed ),
+        memory_order_release
+      );
+      atomic_fetch_sub_explicit( &stripe->size, 1, memory_order_relaxed );
+      deleted = node;
+      break;
+    }
+  } // for
+  pthread_mutex_unlock( &stripe->mutex );
+
+  if ( deleted == NULL )
+    return false;
+  ht_mt_retire( table, deleted, /*is_array=*/false );
+  return true;
+}
+
+void const* ht_mt_find( ht_mt_t const *table, void const *data ) {
+  assert( table != NULL );
+  assert( data != NULL );
+  assert( ebr_nesting > 0 );
+
+  ht_hash_val_t const hash = (*table->hash_fn)( data );
+  ht_mt_array_t *const array =
+    atomic_load_explicit( &table->array, memory_order_acquire );
+  for ( ht_mt_node_t const *node = atomic_load_explicit(
+          ht_mt_bucket( array, hash ), memory_order_acquire );
+        node != NULL;
+        node = atomic_load_explicit( &node->next, memory_order_acquire ) ) {
+    if ( node->hash == hash && (*table->cmp_fn)( data, node->data ) == 0 )
+      return node->data;
+  } // for
+
+  return NULL;
+}
+
+void ht_mt_free( ht_mt_t *table, ht_free_fn_t free_fn ) {
+  if ( table == NULL )
+    return;
+
+  ht_mt_array_t *const array = atomic_load( &table->array );
+  if ( free_fn != NULL ) {
+    for ( size_t b = 0; b < array->n_buckets; ++b ) {
+      for ( ht_mt_node_t *node = atomic_load( &array->buckets[b] );
+            node != NULL; node = atomic_load( &node->next ) ) {
+        (*free_fn)( node->data );
+      } // for
+    } // for
+  }
+  ht_mt_array_free( array );
+
+  // Since no thread may be using the table, all retired memory can be freed.
+  for ( size_t i = 0; i < table->n_retired; ++i )
+    ht_mt_retired_free( &table->retired[i] );
+  free( table->retired );
+
+  for ( unsigned i = 0; i < HT_MT_N_STRIPES; ++i )
+    pthread_mutex_destroy( &table->stripes[i].mutex );
+  pthread_mutex_destroy( &table->retired_mutex );
+  free( table );
+}
+
+bool ht_mt_insert( ht_mt_t *table, void const *data, size_t data_size ) {
+  assert( table != NULL );
+  assert( data != NULL );
+
+  ht_hash_val_t const hash = (*table->hash_fn)( data );
+  ht_mt_stripe_t *const stripe = ht_mt_stripe( table, hash );
+  bool inserted = true;
+
+  pthread_mutex_lock( &stripe->mutex );
+  ht_mt_array_t *const array =
+    atomic_load_explicit( &table->array, memory_order_relaxed );
+  // The array may be retired once the stripe is unlocked, so copy this.
+  size_t const n_buckets = array->n_buckets;
+  _Atomic(ht_mt_node_t*) *const head = ht_mt_bucket( array, hash );
+  ht_mt_node_t *const first =
+    atomic_load_explicit( head, memory_order_relaxed );
+
+  for ( ht_mt_node_t const *node = first; node != NULL;
+        node = atomic_load_explicit( &node->next, memory_order_relaxed ) ) {
+    if ( node->hash == hash && (*table->cmp_fn)( data, node->data ) == 0 ) {
+      inserted = false;
+      break;
+    }
+  } // for
+
+  if ( inserted ) {
+    ht_mt_node_t *const node = malloc( sizeof(ht_mt_node_t) + data_size );
+    atomic_init( &node->next, first );
+    node->hash = hash;
+    node->data_size = data_size;
+    memcpy( node->data, data, data_size );
+    // Release so readers that see node also see its data.
+    atomic_store_explicit( head, node, memory_order_release );
+    atomic_fetch_add_explicit( &stripe->size, 1, memory_order_relaxed );
+  }
+  pthread_mutex_unlock( &stripe->mutex );
+
+  if ( inserted && ht_mt_size( table ) >= n_buckets * table->max_lf )
+    ht_mt_grow( table );
+  return inserted;
+}
+
+ht_mt_t* ht_mt_new( double max_lf, size_t est_size, ht_cmp_fn_t cmp_fn,
+                    ht_hash_fn_t hash_fn ) {
+  assert( max_lf > 0.0 );
+  assert( cmp_fn != NULL );
+  assert( hash_fn != NULL );
+
+  size_t n_buckets = HT_MT_N_BUCKETS_MIN;
+  while ( n_buckets * max_lf < est_size )
+    n_buckets <<= 1;
+
+  ht_mt_t *const table = aligned_alloc(
+    alignof(ht_mt_t),
+    (sizeof(ht_mt_t) + alignof(ht_mt_t) - 1) & ~(alignof(ht_mt_t) - 1)
+  );
+  *table = (ht_mt_t){
+    .cmp_fn = cmp_fn,
+    .hash_fn = hash_fn,
+    .max_lf = max_lf
+  };
+  atomic_init( &table->array, ht_mt_array_new( n_buckets ) );
+  for ( unsigned i = 0; i < HT_MT_N_STRIPES; ++i ) {
+    pthread_mutex_init( &table->stripes[i].mutex, NULL );
+    atomic_init( &table->stripes[i].size, 0 );
+  }
+  pthread_mutex_init( &table->retired_mutex, NULL );
+  return table;
+}
+
+void ht_mt_read_begin( ht_mt_t const *table ) {
+  (void)table;
+  if ( ebr_nesting++ == 0 ) {
+    ht_mt_slot_t *const slot = ebr_slot_get();
+    //
+    // The announcement must be visible to writers before any bucket is read,
+    // hence sequentially consistent operations.  If the epoch advanced
+    // between loading and announcing it, the announcement is stale and an
+    // advancing thread may not have seen it, so announce again.
+    //
+    for ( uint64_t epoch = atomic_load( &ebr_epoch ), announced; ;
+          epoch = announced ) {
+      atomic_store( &slot->epoch, epoch );
+      announced = atomic_load( &ebr_epoch );
+      if ( announced == epoch )
+        break;
+    } // for
+  }
+}
+
+void ht_mt_read_end( ht_mt_t const *table ) {
+  (void)table;
+  assert( ebr_nesting > 0 );
+  if ( --ebr_nesting == 0 )
+    atomic_store_explicit( &ebr_slot->epoch, 0, memory_order_release );
+}
+
+size_t ht_mt_size( ht_mt_t const *table ) {
+  assert( table != NULL );
+  size_t size = 0;
+  for ( unsigned i = 0; i < HT_MT_N_STRIPES; ++i ) {
+    size += atomic_load_explicit(
+      &table->stripes[i].size, memory_order_relaxed
+    );
+  } // for
+  return size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
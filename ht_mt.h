@@ -0,0 +1,144 @@
+/*
+**      PJL Library
+**      src/ht_mt.h
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef pjl_ht_mt_H
+#define pjl_ht_mt_H
+
+/**
+ * @file
+ * Declares a thread-safe ("multi-threaded") hash table.  Writers (inserts and
+ * deletes) lock only one of several stripes of buckets; readers never lock.
+ * Memory of deleted entries and of buckets replaced by growing is reclaimed
+ * using epoch-based reclamation: it's freed only once every thread that could
+ * have been reading it has left its read section.
+ */
+
+// local
+#include "hash_table.h"
+
+// standard
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+////////// typedefs ///////////////////////////////////////////////////////////
+
+typedef struct ht_mt          ht_mt_t;
+
+////////// extern functions ///////////////////////////////////////////////////
+
+/**
+ * Deletes the entry having data equal to \a data, if any.
+ *
+ * @param table The hash table to delete from.
+ * @param data The data to delete.
+ * @return Returns `true` only if an entry was deleted.
+ */
+bool ht_mt_delete( ht_mt_t *table, void const *data );
+
+/**
+ * Attempts to find \a data within a hash table.
+ *
+ * @param table The hash table to search.
+ * @param data The data to search for.
+ * @return Returns a pointer to the data of the entry equal to \a data or NULL
+ * if not found.
+ *
+ * @warning This function must be called between ht_mt_read_begin() and
+ * ht_mt_read_end(); the pointer returned is valid only until the latter.
+ */
+void const* ht_mt_find( ht_mt_t const *table, void const *data );
+
+/**
+ * Frees a hash table.
+ *
+ * @param table The hash table to free.  If NULL, does nothing.  No other
+ * thread may be using it.
+ * @param free_fn A pointer to a function used to free data associated with
+ * each entry or NULL if unnecessary.
+ *
+ * @sa ht_mt_new()
+ */
+void ht_mt_free( ht_mt_t *table, ht_free_fn_t free_fn );
+
+/**
+ * Attempts to insert \a data into \a table.
+ *
+ * @param table The hash table to insert into.
+ * @param data The data to insert.  It's copied into the new entry _before_
+ * the entry is visible to readers.
+ * @param data_size The size of \a data.
+ * @return Returns `true` only if \a data was inserted, i.e., no entry having
+ * equal data already existed.
+ */
+bool ht_mt_insert( ht_mt_t *table, void const *data, size_t data_size );
+
+/**
+ * Creates a new hash table.
+ *
+ * @param max_lf The maximum load factor.
+ * @param est_size The estimated number of entries.
+ * @param cmp_fn The comparison function to use.
+ * @param hash_fn The hash function to use.
+ * @return Returns a pointer to a new hash table.
+ *
+ * @sa ht_mt_free()
+ */
+ht_mt_t* ht_mt_new( double max_lf, size_t est_size, ht_cmp_fn_t cmp_fn,
+                    ht_hash_fn_t hash_fn );
+
+/**
+ * Begins a read section for the calling thread.  Read sections may nest.
+ *
+ * @param table The hash table to read.
+ *
+ * @sa ht_mt_read_end()
+ */
+void ht_mt_read_begin( ht_mt_t const *table );
+
+/**
+ * Ends a read section for the calling thread.
+ *
+ * @param table The hash table that was read.
+ *
+ * @sa ht_mt_read_begin()
+ */
+void ht_mt_read_end( ht_mt_t const *table );
+
+/**
+ * Gets the number of entries in a hash table.
+ *
+ * @param table The hash table.
+ * @return Returns said number.  If other threads are modifying \a table, it's
+ * only approximate.
+ */
+size_t ht_mt_size( ht_mt_t const *table );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef __cplusplus
+} // extern "C"
+#endif /* __cplusplus */
+
+#endif /* pjl_ht_mt_H */
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,247 @@
+/*
+**      PJL Library
+**      src/ht_sharded.c
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// local
+#include "ht_sharded.h"
+
+// standard
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+////////// local types ////////////////////////////////////////////////////////
+
+/**
+ * State shared by all threads of ht_sharded_merge().
+ */
+struct ht_merge_job {
+  ht_sharded_t     *dst;                ///< Table to merge into.
+  ht_sharded_t     *src;                ///< Tables to merge from.
+  unsigned          n_src;              ///< Number of \ref src tables.
+  ht_merge_fn_t     merge_fn;           ///< Merge function, if any.
+  atomic_uint       next_shard;         ///< Next shard to merge.
+};
+typedef struct ht_merge_job ht_merge_job_t;
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Checks whether two hash tables were initialized with the same functions
+ * and options.
+ *
+ * @param i_table The first hash table.
+ * @param j_table The second hash table.
+ * @return Returns `true` only if they were.
+ */
+static bool ht_same_options( hash_table_t const *i_table,
+                             hash_table_t const *j_table ) {
+  if ( i_table->engine != j_table->engine ||
+       i_table->cmp_fn != j_table->cmp_fn ||
+       i_table->hash_fn != j_table->hash_fn ||
+       i_table->max_lf != j_table->max_lf ||
+       i_table->min_lf != j_table->min_lf ||
+       (i_table->filter != NULL) != (j_table->filter != NULL) ||
+       i_table->allocator != j_table->allocator ) {
+    return false;
+  }
+  switch ( i_table->engine ) {
+    case HT_ENGINE_CHAINED:
+      return (i_table->shift == 0) == (j_table->shift == 0) &&
+             i_table->incremental == j_table->incremental;
+    case HT_ENGINE_SMALL:
+      return i_table->small_sizing == j_table->small_sizing &&
+             i_table->small_incremental == j_table->small_incremental;
+    default:
+      return true;
+  } // switch
+}
+
+/**
+ * Merges shard \a s of every source table into shard \a s of the destination
+ * table.
+ *
+ * @param job The merge job.
+ * @param s The index of the shard to merge.
+ */
+static void ht_merge_shard( ht_merge_job_t *job, unsigned s ) {
+  hash_table_t *const dst = &job->dst->shards[s];
+
+  //
+  // If the destination shard is empty, rather than copy every entry of the
+  // first source shard into it, just take that shard over wholesale -- but
+  // only if it was made with the same options so dst's aren't lost.  Since
+  // the first source shard is merged first anyway, which data are kept (or
+  // the order they're merged in) is the same either way.
+  //
+  hash_table_t *adopted = NULL;
+  if ( job->n_src > 0 && ht_empty( dst ) &&
+       ht_same_options( dst, &job->src[0].shards[s] ) ) {
+    adopted = &job->src[0].shards[s];
+    ht_cleanup( dst, NULL );
+    *dst = *adopted;
+  }
+
+  for ( unsigned i = 0; i < job->n_src; ++i ) {
+    hash_table_t *const src = &job->src[i].shards[s];
+    if ( src == adopted )
+      continue;
+    ht_iterator_t it;
+    ht_iterator_init( &it, src );
+    for ( ht_entry_t *entry; (entry = ht_iterator_next( &it )) != NULL; ) {
+      ht_insert_rv_t const rv =
+        ht_insert_hash( dst, entry->data, entry->data_size, entry->hash );
+      if ( rv.inserted )
+        memcpy( rv.entry->data, entry->data, entry->data_size );
+      else if ( job->merge_fn != NULL )
+        (*job->merge_fn)( rv.entry->data, entry->data );
+    } // for
+    ht_cleanup( src, NULL );
+  } // for
+
+  // The adopted shard's memory now belongs to dst, so just forget it.
+  if ( adopted != NULL )
+    memset( adopted, 0, sizeof *adopted );
+}
+
+/**
+ * Thread main for ht_sharded_merge(): merges shards until none remain.
+ *
+ * @param arg A pointer to the ht_merge_job.
+ * @return Always returns NULL.
+ */
+static void* ht_merge_thread( void *arg ) {
+  ht_merge_job_t *const job = arg;
+  for ( unsigned s; (s = atomic_fetch_add( &job->next_shard, 1 )) <
+        job->dst->n_shards; ) {
+    ht_merge_shard( job, s );
+  } // for
+  return NULL;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+void ht_sharded_cleanup( ht_sharded_t *table, ht_free_fn_t free_fn ) {
+  if ( table == NULL )
+    return;
+  for ( unsigned s = 0; s < table->n_shards; ++s )
+    ht_cleanup( &table->shards[s], free_fn );
+  free( table->shards );
+  *table = (ht_sharded_t){ 0 };
+}
+
+ht_entry_t* ht_sharded_find( ht_sharded_t const *table, void const *data ) {
+  assert( table != NULL );
+  assert( data != NULL );
+  ht_hash_val_t const hash = (*table->hash_fn)( data );
+  return ht_find_hash( ht_sharded_shard( table, hash ), data, hash );
+}
+
+void ht_sharded_init( ht_sharded_t *table, unsigned n_shards, double max_lf,
+                      size_t est_size, ht_cmp_fn_t cmp_fn,
+                      ht_hash_fn_t hash_fn, ht_options_t const *opt ) {
+  assert( table != NULL );
+  assert( n_shards > 0 && (n_shards & (n_shards - 1)) == 0 );
+
+  unsigned log2 = 0;
+  while ( (1u << log2) < n_shards )
+    ++log2;
+
+  *table = (ht_sharded_t){
+    .shards = malloc( n_shards * sizeof(hash_table_t) ),
+    .n_shards = n_shards,
+    .log2 = log2,
+    .hash_fn = hash_fn
+  };
+  for ( unsigned s = 0; s < n_shards; ++s ) {
+    ht_init_opt(
+      &table->shards[s], max_lf, est_size / n_shards, cmp_fn, hash_fn, opt
+    );
+  } // for
+}
+
+ht_insert_rv_t ht_sharded_insert( ht_sharded_t *table, void *data,
+                                  size_t data_size ) {
+  assert( table != NULL );
+  assert( data != NULL );
+  ht_hash_val_t const hash = (*table->hash_fn)( data );
+  return ht_insert_hash(
+    ht_sharded_shard( table, hash ), data, data_size, hash
+  );
+}
+
+void ht_sharded_merge( ht_sharded_t *dst, ht_sharded_t *src, unsigned n_src,
+                       ht_merge_fn_t merge_fn, unsigned n_threads ) {
+  assert( dst != NULL );
+  assert( src != NULL || n_src == 0 );
+
+  ht_merge_job_t job = {
+    .dst = dst,
+    .src = src,
+    .n_src = n_src,
+    .merge_fn = merge_fn
+  };
+  atomic_init( &job.next_shard, 0 );
+
+  for ( unsigned i = 0; i < n_src; ++i ) {
+    assert( src[i].n_shards == dst->n_shards );
+    assert( src[i].hash_fn == dst->hash_fn );
+  } // for
+
+  if ( n_threads == 0 || n_threads > dst->n_shards )
+    n_threads = dst->n_shards;
+
+  // The calling thread is one of the threads.
+  pthread_t *const threads = malloc( n_threads * sizeof(pthread_t) );
+  unsigned n_started = 0;
+  for ( ; n_started < n_threads - 1; ++n_started ) {
+    if ( pthread_create( &threads[ n_started ], NULL, &ht_merge_thread,
+                         &job ) != 0 ) {
+      break;                            // the remaining threads do the work
+    }
+  } // for
+  ht_merge_thread( &job );
+  for ( unsigned i = 0; i < n_started; ++i )
+    pthread_join( threads[i], NULL );
+  free( threads );
+
+  for ( unsigned i = 0; i < n_src; ++i )
+    ht_sharded_cleanup( &src[i], NULL );
+}
+
+size_t ht_sharded_size( ht_sharded_t const *table ) {
+  assert( table != NULL );
+  size_t size = 0;
+  for ( unsigned s = 0; s < table->n_shards; ++s )
+    size += table->shards[s].size;
+  return size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/// @cond DOXYGEN_IGNORE
+
+extern inline hash_table_t* ht_sharded_shard( ht_sharded_t const*,
+                                              ht_hash_val_t );
+
+/// @endcond
+
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,174 @@
+/*
+**      PJL Library
+**      src/ht_sharded.h
+**
+**      Copyright (C) 2026  Paul J. Lucas
+**
+**      This program is free software: you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation, either version 3 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef pjl_ht_sharded_H
+#define pjl_ht_sharded_H
+
+/**
+ * @file
+ * Declares a sharded hash table: a hash table partitioned by the high bits of
+ * entries' hash values into a power-of-2 number of independent \ref
+ * hash_table "hash_table" shards.
+ *
+ * The intended use is for each of several worker threads to build its own
+ * sharded table (with no synchronization since no table is shared), then
+ * merge them all with ht_sharded_merge(): since an entry's shard depends only
+ * on its hash value, shard _i_ of the result is the union of shard _i_ of
+ * every table, so each shard can be merged by its own thread.
+ */
+
+// local
+#include "hash_table.h"
+
+// standard
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+////////// typedefs ///////////////////////////////////////////////////////////
+
+typedef struct ht_sharded     ht_sharded_t;
+
+/**
+ * The signature for a function passed to ht_sharded_merge() used to merge the
+ * data of an entry into the data of an existing, equal entry.
+ *
+ * @param dst_data The data of the existing entry.
+ * @param src_data The data of the entry being merged.  It's discarded
+ * afterwards, so anything it owns must either be moved into \a dst_data or
+ * freed.
+ */
+typedef void (*ht_merge_fn_t)( void *dst_data, void *src_data );
+
+////////// structures /////////////////////////////////////////////////////////
+
+/**
+ * A sharded hash table.
+ */
+struct ht_sharded {
+  hash_table_t *shards;                 ///< Shards.
+  unsigned      n_shards;               ///< Number of shards; power of 2.
+  unsigned      log2;                   ///< Base-2 logarithm of \ref n_shards.
+  ht_hash_fn_t  hash_fn;                ///< Hash function.
+};
+
+////////// extern functions ///////////////////////////////////////////////////
+
+/**
+ * Cleans-up a sharded hash table.
+ *
+ * @param table The sharded hash table to clean up.  If NULL, does nothing.
+ * @param free_fn A pointer to a function used to free data associated with
+ * each entry or NULL if unnecessary.
+ *
+ * @sa ht_sharded_init()
+ */
+void ht_sharded_cleanup( ht_sharded_t *table, ht_free_fn_t free_fn );
+
+/**
+ * Attempts to find \a data within a sharded hash table.
+ *
+ * @param table The sharded hash table to search.
+ * @param data The data to search for.
+ * @return Returns a pointer to the entry containing \a data or NULL if not
+ * found.
+ */
+ht_entry_t* ht_sharded_find( ht_sharded_t const *table, void const *data );
+
+/**
+ * Initializes a sharded hash table.
+ *
+ * @param table The sharded hash table to initialize.
+ * @param n_shards The number of shards; must be a power of 2.
+ * @param max_lf The maximum load factor of each shard.
+ * @param est_size The estimated number of entries of all shards.
+ * @param cmp_fn The comparison function to use.
+ * @param hash_fn The hash function to use.  Since shards are selected by the
+ * high bits of its values, those bits must be well distributed.
+ * @param opt The options each shard uses.
+ *
+ * @sa ht_sharded_cleanup()
+ */
+void ht_sharded_init( ht_sharded_t *table, unsigned n_shards, double max_lf,
+                      size_t est_size, ht_cmp_fn_t cmp_fn,
+                      ht_hash_fn_t hash_fn, ht_options_t const *opt );
+
+/**
+ * Attempts to insert \a data into \a table.
+ *
+ * @param table The sharded hash table to insert into.
+ * @param data The data to insert.
+ * @param data_size The size of \a data.
+ * @return Returns the same as ht_insert().
+ */
+ht_insert_rv_t ht_sharded_insert( ht_sharded_t *table, void *data,
+                                  size_t data_size );
+
+/**
+ * Merges sharded hash tables into \a dst, one thread per shard.
+ *
+ * @param dst The sharded hash table to merge into.  It may be non-empty.
+ * @param src The sharded hash tables to merge from.  Each must have the same
+ * number of shards and the same functions as \a dst.  Their entries' data are
+ * moved into \a dst and each is cleaned up.
+ * @param n_src The number of \a src tables.
+ * @param merge_fn A pointer to a function used to merge the data of an entry
+ * into an existing, equal entry, or NULL to keep the existing data.  Data are
+ * merged in order: those of \a dst (if any), then of `src[0]`, `src[1]`,
+ * etc.; hence, if NULL, of equal data, those of \a dst win, else those of
+ * the first \a src having them.
+ * @param n_threads The maximum number of threads to use or 0 for one per
+ * shard.
+ */
+void ht_sharded_merge( ht_sharded_t *dst, ht_sharded_t *src, unsigned n_src,
+                       ht_merge_fn_t merge_fn, unsigned n_threads );
+
+/**
+ * Gets the shard of a sharded hash table for \a hash.
+ *
+ * @param table The sharded hash table.
+ * @param hash The hash value.
+ * @return Returns said shard.
+ */
+inline hash_table_t* ht_sharded_shard( ht_sharded_t const *table,
+                                       ht_hash_val_t hash ) {
+  // Two shifts so that log2 == 0 (one shard) doesn't shift by 64.
+  return &table->shards[ (hash >> (63 - table->log2)) >> 1 ];
+}
+
+/**
+ * Gets the number of entries in a sharded hash table.
+ *
+ * @param table The sharded hash table.
+ * @return Returns said number.
+ */
+size_t ht_sharded_size( ht_sharded_t const *table );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef __cplusplus
+} // extern "C"
+#endif /* __cplusplus */
+
+#endif /* pjl_ht_sharded_H */
+/* vim:set et sw=2 ts=2: */